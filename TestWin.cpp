@@ -12,6 +12,11 @@
 
 TestWin::TestWin(QWidget *parent) : QWidget(parent)
 {
+    m_recorder = new QTelemetryRecorder();
+    m_replayer = new QTelemetryReplayer(this);
+    m_mavlink  = new QMavlinkSource(this);
+    m_stream   = new QInstrumentStreamServer(this);
+
     // setup layout
     setupLayout();
 
@@ -28,17 +33,20 @@ TestWin::TestWin(QWidget *parent) : QWidget(parent)
             QString("W     - Alt +\n") +
             QString("S     - Alt -\n") +
             QString("J     - H +\n") +
-            QString("K     - H -\n");
+            QString("K     - H -\n") +
+            QString("P     - Perf overlay\n") +
+            QString("G     - Frame budget 2 ms\n") +
+            QString("H     - HSI (heading-up)\n");
     m_helpMsg->setText(szHelp);
     m_helpMsg->setFont(QFont("DejaVu Sans YuanTi Mono", 10));
 
     // set default info
-    m_infoList->getData()["roll"]  = QString("%1").arg(m_ADI->getRoll());
-    m_infoList->getData()["pitch"] = QString("%1").arg(m_ADI->getPitch());
-    m_infoList->getData()["yaw"]   = QString("%1").arg(m_Compass->getYaw());
-    m_infoList->getData()["alt"]   = QString("%1").arg(m_Compass->getAlt());
-    m_infoList->getData()["H"]     = QString("%1").arg(m_Compass->getH());
-    m_infoList->listReload();
+    m_infoList->setValue("roll",  m_ADI->getRoll());
+    m_infoList->setValue("pitch", m_ADI->getPitch());
+    m_infoList->setValue("yaw",   m_Compass->getYaw());
+    m_infoList->setValue("alt",   m_Compass->getAlt());
+    m_infoList->setValue("H",     m_Compass->getH());
+    m_infoList->setValue("mode",  compassModeName());
 
     // set window minimum size
     this->setMinimumSize(800, 600);
@@ -52,7 +60,7 @@ TestWin::TestWin(QWidget *parent) : QWidget(parent)
 
 TestWin::~TestWin()
 {
-
+    delete m_recorder;
 }
 
 int TestWin::setupLayout(void)
@@ -62,17 +70,48 @@ int TestWin::setupLayout(void)
     m_helpMsg->setReadOnly(true);
     m_helpMsg->setFocusPolicy(Qt::NoFocus);
 
+    QVBoxLayout *rl = new QVBoxLayout();
+    rl->addWidget(m_helpMsg, 1);
+    rl->setMargin(0);
+    rl->setSpacing(4);
+
     // left pannel
     QWidget *wLeftPanel = new QWidget(this);
     QVBoxLayout *vl = new QVBoxLayout(wLeftPanel);
     wLeftPanel->setLayout(vl);
     wLeftPanel->setFocusPolicy(Qt::NoFocus);
 
-    m_ADI      = new QADI(this);
-    m_Compass  = new QCompass(this);
-    m_infoList = new QKeyValueListView(this);
+    m_ADI       = new QADI(this);
+    m_Compass   = new QCompass(this);
+    m_speedTape = new QTape(QTapeRenderer::AIRSPEED, this);
+    m_altTape   = new QTape(QTapeRenderer::ALTITUDE, this);
+    m_vsiTape   = new QTape(QTapeRenderer::VSI, this);
+    m_infoList  = new QKeyValueListView(this);
+
+    // paint the instruments off the GUI thread, the list may keep it busy
+    m_ADI->setThreadedRendering(true);
+    m_Compass->setThreadedRendering(true);
+
+    // roll, pitch, alt & H history below the help text
+    m_trend = new QTrend(this);
+    m_trend->attach(m_ADI);
+    m_trend->attach(m_Compass);
+    m_trend->setMinimumHeight(240);
+    rl->addWidget(m_trend, 1);
 
-    vl->addWidget(m_ADI,      0, Qt::AlignTop|Qt::AlignHCenter);
+    // PFD row: airspeed | ADI | altitude | vertical speed
+    QHBoxLayout *pfd = new QHBoxLayout();
+    pfd->addWidget(m_speedTape, 0);
+    pfd->addWidget(m_ADI,       0);
+    pfd->addWidget(m_altTape,   0);
+    pfd->addWidget(m_vsiTape,   0);
+    pfd->setSpacing(4);
+
+    m_speedTape->setFixedSize(70, m_ADI->minimumHeight());
+    m_altTape->setFixedSize(80, m_ADI->minimumHeight());
+    m_vsiTape->setFixedSize(60, m_ADI->minimumHeight());
+
+    vl->addLayout(pfd, 0);
     vl->addWidget(m_Compass,  0, Qt::AlignTop|Qt::AlignHCenter);
     vl->addWidget(m_infoList, 2, 0);
     vl->setMargin(0);
@@ -82,13 +121,65 @@ int TestWin::setupLayout(void)
     QHBoxLayout *hl = new QHBoxLayout(this);
     this->setLayout(hl);
 
-    hl->addWidget(m_helpMsg, 1);
+    hl->addLayout(rl, 1);
     hl->addWidget(wLeftPanel, 0);
 
     return 0;
 }
 
 
+int TestWin::startRecord(const QString &fname)
+{
+    if( m_recorder->open(fname) != 0 ) return -1;
+
+    m_recorder->recordRoll(m_ADI->getRoll());
+    m_recorder->recordPitch(m_ADI->getPitch());
+    m_recorder->recordYaw(m_Compass->getYaw());
+    m_recorder->recordAlt(m_Compass->getAlt());
+    m_recorder->recordH(m_Compass->getH());
+    m_recorder->recordKeyValue("mode", compassModeName());
+
+    return 0;
+}
+
+int TestWin::startReplay(const QString &fname, double speed)
+{
+    if( m_replayer->open(fname) != 0 ) return -1;
+
+    m_replayer->attach(m_ADI);
+    m_replayer->attach(m_Compass);
+    m_replayer->attach(m_infoList);
+    m_replayer->setSpeed(speed);
+    m_replayer->play();
+
+    return 0;
+}
+
+int TestWin::startMavlink(quint16 port)
+{
+    if( m_mavlink->open(port) != 0 ) return -1;
+
+    m_mavlink->attach(m_ADI);
+    m_mavlink->attach(m_Compass);
+    m_mavlink->attach(m_infoList);
+    m_mavlink->attach(m_speedTape, QMavlinkSource::KEY_AIRSPEED);
+    m_mavlink->attach(m_altTape,   QMavlinkSource::KEY_ALT);
+    m_mavlink->attach(m_vsiTape,   QMavlinkSource::KEY_CLIMB);
+
+    return 0;
+}
+
+int TestWin::startStream(const QString &address)
+{
+    if( m_stream->listen(address) != 0 ) return -1;
+
+    m_stream->attach(m_ADI);
+    m_stream->attach(m_Compass);
+    m_stream->attach(m_infoList);
+
+    return 0;
+}
+
 void TestWin::keyPressEvent(QKeyEvent *event)
 {
     int     key;
@@ -117,23 +208,57 @@ void TestWin::keyPressEvent(QKeyEvent *event)
     } else if ( key == Qt::Key_W ) {
         v = m_Compass->getAlt();
         m_Compass->setAlt(v+1.0);
+        m_altTape->setValue(v+1.0);
     } else if ( key == Qt::Key_S ) {
         v = m_Compass->getAlt();
         m_Compass->setAlt(v-1.0);
+        m_altTape->setValue(v-1.0);
     } else if ( key == Qt::Key_J ) {
         v = m_Compass->getH();
         m_Compass->setH(v+1.0);
     } else if ( key == Qt::Key_K ) {
         v = m_Compass->getH();
         m_Compass->setH(v-1.0);
+    } else if ( key == Qt::Key_P ) {
+        bool on = !m_ADI->getHudVisible();
+        m_ADI->setHudVisible(on);
+        m_Compass->setHudVisible(on);
+        m_infoList->setHudVisible(on);
+    } else if ( key == Qt::Key_G ) {
+        double ms = m_ADI->getFrameBudget() > 0 ? 0.0 : 2.0;
+        m_ADI->setFrameBudget(ms);
+        m_Compass->setFrameBudget(ms);
+    } else if ( key == Qt::Key_H ) {
+        if( m_Compass->getCardMode() == QCompassRenderer::NORTH_UP ) {
+            m_Compass->setCardMode(QCompassRenderer::HEADING_UP);
+            m_Compass->setCourse(45.0, 0.8);
+            m_Compass->setBearing(120.0);
+        } else {
+            m_Compass->setCardMode(QCompassRenderer::NORTH_UP);
+        }
+
+        m_infoList->setValue("mode", compassModeName());
+        if( m_recorder->isOpen() ) m_recorder->recordKeyValue("mode", compassModeName());
     }
 
-    m_infoList->getData()["roll"]  = QString("%1").arg(m_ADI->getRoll());
-    m_infoList->getData()["pitch"] = QString("%1").arg(m_ADI->getPitch());
-    m_infoList->getData()["yaw"]   = QString("%1").arg(m_Compass->getYaw());
-    m_infoList->getData()["alt"]   = QString("%1").arg(m_Compass->getAlt());
-    m_infoList->getData()["H"]     = QString("%1").arg(m_Compass->getH());
-    m_infoList->listReload();
+    m_infoList->setValue("roll",  m_ADI->getRoll());
+    m_infoList->setValue("pitch", m_ADI->getPitch());
+    m_infoList->setValue("yaw",   m_Compass->getYaw());
+    m_infoList->setValue("alt",   m_Compass->getAlt());
+    m_infoList->setValue("H",     m_Compass->getH());
+
+    if( m_recorder->isOpen() ) {
+        m_recorder->recordRoll(m_ADI->getRoll());
+        m_recorder->recordPitch(m_ADI->getPitch());
+        m_recorder->recordYaw(m_Compass->getYaw());
+        m_recorder->recordAlt(m_Compass->getAlt());
+        m_recorder->recordH(m_Compass->getH());
+    }
+}
+
+QString TestWin::compassModeName(void)
+{
+    return m_Compass->getCardMode() == QCompassRenderer::HEADING_UP ? "HSI" : "north-up";
 }
 
 void TestWin::mousePressEvent(QMouseEvent *event)
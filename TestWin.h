@@ -6,6 +6,9 @@
 #include <QTextEdit>
 
 #include "qFlightInstruments.h"
+#include "qTelemetryLog.h"
+#include "qMavlinkSource.h"
+#include "qInstrumentStream.h"
 
 
 class TestWin : public QWidget
@@ -16,18 +19,61 @@ public:
 
     virtual int setupLayout(void);
 
+    ///
+    /// \brief Record keyboard driven changes into a telemetry log
+    /// \param fname - log file name
+    /// \return 0 on success
+    ///
+    int startRecord(const QString &fname);
+
+    ///
+    /// \brief Replay a telemetry log into the instruments
+    /// \param fname - log file name
+    /// \param speed - 1 real time, N N-times faster, 0 as fast as possible
+    /// \return 0 on success
+    ///
+    int startReplay(const QString &fname, double speed);
+
+    ///
+    /// \brief Feed the instruments from MAVLink telemetry received over UDP
+    /// \param port - UDP port
+    /// \return 0 on success
+    ///
+    int startMavlink(quint16 port);
+
+    ///
+    /// \brief Stream the ADI & compass to remote viewers
+    /// \param address - "port", "host:port" (TCP) or a local socket name
+    /// \return 0 on success
+    ///
+    int startStream(const QString &address);
+
 
 protected:
     void keyPressEvent(QKeyEvent *event);
     void mousePressEvent(QMouseEvent *event);
     void resizeEvent(QResizeEvent *event);
 
+    ///
+    /// \brief Compass card mode as shown in the list & recorded in logs
+    ///
+    QString compassModeName(void);
+
 protected:
     QADI                *m_ADI;
     QCompass            *m_Compass;
+    QTape               *m_speedTape;
+    QTape               *m_altTape;
+    QTape               *m_vsiTape;
     QKeyValueListView   *m_infoList;
+    QTrend              *m_trend;
 
     QTextEdit           *m_helpMsg;
+
+    QTelemetryRecorder  *m_recorder;
+    QTelemetryReplayer  *m_replayer;
+    QMavlinkSource      *m_mavlink;
+    QInstrumentStreamServer *m_stream;
 };
 
 #endif // end of __TeST_WIN_H__
@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+#include <QtCore>
+#include <QtGui>
+#include <QApplication>
+
+#include "qFlightInstruments.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// allocation counter
+///     every malloc/calloc/realloc of the process (Qt's included) is counted,
+///     operator new ends up in malloc as well
+////////////////////////////////////////////////////////////////////////////////
+
+static std::atomic<long> g_allocCount(0);
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t n);
+void *__libc_calloc(size_t n, size_t s);
+void *__libc_realloc(void *p, size_t n);
+
+void *malloc(size_t n)
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(n);
+}
+
+void *calloc(size_t n, size_t s)
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, s);
+}
+
+void *realloc(void *p, size_t n)
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, n);
+}
+}
+#define BENCH_COUNT_ALLOCS 1
+#else
+#define BENCH_COUNT_ALLOCS 0
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Instrument state profile, value = base + amp*sin(frame*0.05)
+///
+struct BenchProfile
+{
+    const char  *name;
+    double      base[3];
+    double      amp[3];
+};
+
+// roll, pitch
+static const BenchProfile g_adiProfiles[] = {
+    { "level",  {   0.0,   0.0, 0 }, {  0.0,  0.0, 0 } },
+    { "banked", {  35.0, -12.0, 0 }, {  0.0,  0.0, 0 } },
+    { "sweep",  {   0.0,   0.0, 0 }, { 60.0, 30.0, 0 } },
+};
+
+// yaw, alt, h
+static const BenchProfile g_compassProfiles[] = {
+    { "level",  {   0.0,   0.0,  0.0 }, {   0.0,  0.0,  0.0 } },
+    { "cruise", { 123.0, 450.5, 87.3 }, {   0.0,  0.0,  0.0 } },
+    { "sweep",  { 180.0, 450.0, 80.0 }, { 179.0, 50.0, 20.0 } },
+};
+
+// altitude tape value
+static const BenchProfile g_tapeProfiles[] = {
+    { "cruise", { 450.5, 0, 0 }, {   0.0, 0, 0 } },
+    { "climb",  { 450.0, 0, 0 }, { 300.0, 0, 0 } },
+};
+
+struct BenchResult
+{
+    QString     instrument;
+    int         size;
+    bool        antialiasing;
+    QString     profile;
+
+    double      nsPerFrame;
+    double      fps;
+    qint64      p50, p99;
+    double      allocsPerFrame;
+};
+
+static double profileValue(const BenchProfile &p, int ch, int frame)
+{
+    return p.base[ch] + p.amp[ch]*sin(frame*0.05);
+}
+
+static void applyProfile(QWidget *w, const BenchProfile &p, int frame)
+{
+    QADI        *adi = qobject_cast<QADI*>(w);
+    QCompass    *compass = qobject_cast<QCompass*>(w);
+    QTape       *tape = qobject_cast<QTape*>(w);
+
+    if( adi )
+        adi->setData(profileValue(p, 0, frame), profileValue(p, 1, frame));
+    else if( compass )
+        compass->setData(profileValue(p, 0, frame),
+                         profileValue(p, 1, frame),
+                         profileValue(p, 2, frame));
+    else if( tape )
+        tape->setValue(profileValue(p, 0, frame));
+}
+
+static void setAntialiasing(QWidget *w, bool aa)
+{
+    QADI        *adi = qobject_cast<QADI*>(w);
+    QCompass    *compass = qobject_cast<QCompass*>(w);
+    QTape       *tape = qobject_cast<QTape*>(w);
+
+    if( adi )     adi->setAntialiasing(aa);
+    if( compass ) compass->setAntialiasing(aa);
+    if( tape )    tape->setAntialiasing(aa);
+}
+
+///
+/// \brief Render one case (instrument, size, aa, profile) and collect timings
+///
+static BenchResult runCase(QWidget *w, const QString &name, int size, bool aa,
+                           const BenchProfile &prof, int nWarmup, int nFrames)
+{
+    BenchResult         res;
+    QImage              img(size, size, QImage::Format_ARGB32_Premultiplied);
+    QElapsedTimer       timer;
+    std::vector<qint64> ns(nFrames);
+    qint64              total = 0;
+    long                allocs;
+
+    w->resize(size, size);
+    setAntialiasing(w, aa);
+    QCoreApplication::processEvents();
+
+    for(int i=0; i<nWarmup; i++) {
+        applyProfile(w, prof, i);
+        w->render(&img);
+    }
+
+    allocs = g_allocCount.load();
+
+    for(int i=0; i<nFrames; i++) {
+        applyProfile(w, prof, nWarmup+i);
+
+        timer.start();
+        w->render(&img);
+        ns[i] = timer.nsecsElapsed();
+
+        total += ns[i];
+    }
+
+    allocs = g_allocCount.load() - allocs;
+
+    // drop the update requests posted by the setters
+    QCoreApplication::processEvents();
+
+    std::sort(ns.begin(), ns.end());
+
+    res.instrument     = name;
+    res.size           = size;
+    res.antialiasing   = aa;
+    res.profile        = prof.name;
+    res.nsPerFrame     = (double) total / nFrames;
+    res.fps            = res.nsPerFrame > 0 ? 1e9 / res.nsPerFrame : 0;
+    res.p50            = ns[nFrames*50/100];
+    res.p99            = ns[qMin(nFrames-1, nFrames*99/100)];
+    res.allocsPerFrame = BENCH_COUNT_ALLOCS ? (double) allocs / nFrames : -1;
+
+    return res;
+}
+
+static QString caseKey(const QJsonObject &o)
+{
+    return QString("%1/%2/%3/%4")
+            .arg(o["instrument"].toString())
+            .arg(o["size"].toInt())
+            .arg(o["antialiasing"].toBool() ? 1 : 0)
+            .arg(o["profile"].toString());
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    // render without a display unless told otherwise
+    if( qgetenv("QT_QPA_PLATFORM").isEmpty() )
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless render benchmark for QADI, QCompass & QTape");
+    parser.addHelpOption();
+
+    QCommandLineOption optFrames("frames", "Measured frames per case.", "n", "300");
+    QCommandLineOption optWarmup("warmup", "Warm-up frames per case.", "n", "30");
+    QCommandLineOption optOut("out", "Write JSON report to file (default: stdout).", "file");
+    QCommandLineOption optBase("baseline", "Compare against a saved JSON report.", "file");
+    QCommandLineOption optMaxReg("max-regression",
+                                 "Exit with 2 if any case is slower than the baseline by more than pct.",
+                                 "pct");
+    QCommandLineOption optMaxAllocs("max-allocs",
+                                    "Exit with 3 if any case allocates more than n times per frame.",
+                                    "n");
+    parser.addOption(optFrames);
+    parser.addOption(optWarmup);
+    parser.addOption(optOut);
+    parser.addOption(optBase);
+    parser.addOption(optMaxReg);
+    parser.addOption(optMaxAllocs);
+    parser.process(app);
+
+    int     nFrames = qMax(1, parser.value(optFrames).toInt());
+    int     nWarmup = qMax(0, parser.value(optWarmup).toInt());
+
+    // load baseline
+    QMap<QString, double>   baseline;
+    if( parser.isSet(optBase) ) {
+        QFile f(parser.value(optBase));
+        if( !f.open(QIODevice::ReadOnly) ) {
+            fprintf(stderr, "ERR: can not open baseline file: %s\n",
+                    qPrintable(parser.value(optBase)));
+            return 1;
+        }
+
+        QJsonArray cases = QJsonDocument::fromJson(f.readAll()).object()["cases"].toArray();
+        for(int i=0; i<cases.size(); i++) {
+            QJsonObject o = cases[i].toObject();
+            baseline[caseKey(o)] = o["ns_per_frame"].toDouble();
+        }
+    }
+
+    // run case matrix
+    QADI        adi;
+    QCompass    compass;
+    QTape       tape(QTapeRenderer::ALTITUDE);
+
+    adi.setAttribute(Qt::WA_DontShowOnScreen);
+    compass.setAttribute(Qt::WA_DontShowOnScreen);
+    tape.setAttribute(Qt::WA_DontShowOnScreen);
+    adi.show();
+    compass.show();
+    tape.show();
+
+    const int   sizes[] = { 200, 300, 400, 500, 600 };
+    const int   nSizes = sizeof(sizes)/sizeof(sizes[0]);
+
+    QList<BenchResult>  results;
+
+    for(int si=0; si<nSizes; si++) {
+        for(int aa=1; aa>=0; aa--) {
+            for(size_t pi=0; pi<sizeof(g_adiProfiles)/sizeof(g_adiProfiles[0]); pi++)
+                results.append(runCase(&adi, "QADI", sizes[si], aa,
+                                       g_adiProfiles[pi], nWarmup, nFrames));
+
+            for(size_t pi=0; pi<sizeof(g_compassProfiles)/sizeof(g_compassProfiles[0]); pi++)
+                results.append(runCase(&compass, "QCompass", sizes[si], aa,
+                                       g_compassProfiles[pi], nWarmup, nFrames));
+
+            // tape: size is the height, the width is clamped to 120
+            for(size_t pi=0; pi<sizeof(g_tapeProfiles)/sizeof(g_tapeProfiles[0]); pi++)
+                results.append(runCase(&tape, "QTape", sizes[si], aa,
+                                       g_tapeProfiles[pi], nWarmup, nFrames));
+        }
+    }
+
+    // build report
+    QJsonArray  cases;
+    double      maxRegression = -1e30;
+    double      maxAllocs = 0;
+
+    for(int i=0; i<results.size(); i++) {
+        const BenchResult &r = results[i];
+        QJsonObject o;
+
+        o["instrument"]       = r.instrument;
+        o["size"]             = r.size;
+        o["antialiasing"]     = r.antialiasing;
+        o["profile"]          = r.profile;
+        o["ns_per_frame"]     = r.nsPerFrame;
+        o["fps"]              = r.fps;
+        o["p50_ns"]           = (double) r.p50;
+        o["p99_ns"]           = (double) r.p99;
+        o["allocs_per_frame"] = r.allocsPerFrame;
+
+        if( r.allocsPerFrame > maxAllocs ) maxAllocs = r.allocsPerFrame;
+
+        QString key = caseKey(o);
+        if( baseline.contains(key) && baseline[key] > 0 ) {
+            double d = 100.0*(r.nsPerFrame - baseline[key])/baseline[key];
+
+            o["baseline_ns_per_frame"] = baseline[key];
+            o["delta_pct"]             = d;
+
+            if( d > maxRegression ) maxRegression = d;
+        }
+
+        cases.append(o);
+    }
+
+    QJsonObject report;
+    report["qt_version"]  = QString(qVersion());
+    report["platform"]    = QGuiApplication::platformName();
+    report["frames"]      = nFrames;
+    report["warmup"]      = nWarmup;
+    report["alloc_count"] = BENCH_COUNT_ALLOCS ? true : false;
+    report["cases"]       = cases;
+
+    QByteArray json = QJsonDocument(report).toJson();
+
+    if( parser.isSet(optOut) ) {
+        QFile f(parser.value(optOut));
+        if( !f.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+            fprintf(stderr, "ERR: can not write report file: %s\n",
+                    qPrintable(parser.value(optOut)));
+            return 1;
+        }
+        f.write(json);
+    } else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+
+    if( parser.isSet(optMaxReg) && !baseline.isEmpty() &&
+        maxRegression > parser.value(optMaxReg).toDouble() ) {
+        fprintf(stderr, "ERR: regression %.1f%% exceeds %s%%\n",
+                maxRegression, qPrintable(parser.value(optMaxReg)));
+        return 2;
+    }
+
+    if( parser.isSet(optMaxAllocs) && BENCH_COUNT_ALLOCS &&
+        maxAllocs > parser.value(optMaxAllocs).toDouble() ) {
+        fprintf(stderr, "ERR: %.1f allocations per frame exceeds %s\n",
+                maxAllocs, qPrintable(parser.value(optMaxAllocs)));
+        return 3;
+    }
+
+    return 0;
+}
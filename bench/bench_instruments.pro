@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Headless render benchmark for QADI & QCompass
+#
+#-------------------------------------------------
+
+QT += core gui widgets
+
+TARGET = bench_instruments
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS += -std=c++11
+
+INCLUDEPATH += ..
+
+SOURCES += bench_instruments.cpp \
+        ../qFlightInstruments.cpp \
+
+
+HEADERS  += ../qFlightInstruments.h
@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <QtCore>
+#include <QtEndian>
+#include <QApplication>
+#include <QUdpSocket>
+
+#include "qFlightInstruments.h"
+#include "qMavlinkSource.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// loopback sender
+///     every datagram carries ATTITUDE, GLOBAL_POSITION_INT, VFR_HUD and
+///     SYS_STATUS, the way autopilots batch their telemetry streams
+////////////////////////////////////////////////////////////////////////////////
+
+static const int g_msgsPerDatagram = 4;
+
+class BenchSender : public QThread
+{
+public:
+    BenchSender(quint16 port, double seconds, double rate)
+        : m_port(port), m_seconds(seconds), m_rate(rate), m_sent(0) {}
+
+    quint64 getSent(void) { return m_sent; }
+
+protected:
+    void run(void) {
+        QUdpSocket      sock;
+        QElapsedTimer   clock;
+        uchar           pl[64], dgram[512];
+        quint8          seq = 0;
+        quint64         n = 0;
+
+        clock.start();
+
+        while( clock.nsecsElapsed() < (qint64) (m_seconds*1e9) ) {
+            double  t = n * 0.01;
+            int     len = 0;
+
+            memset(pl, 0, sizeof(pl));
+            putFloat(pl + 4,  0.5f*sin(t));
+            putFloat(pl + 8,  0.2f*sin(t*0.7));
+            putFloat(pl + 12, fmod(t, 6.28) - 3.14);
+            len += QMavlinkParser::pack(dgram + len, QMavlinkMessage::ATTITUDE, pl, 28, seq++);
+
+            memset(pl, 0, sizeof(pl));
+            qToLittleEndian<qint32>(473977420, pl + 4);
+            qToLittleEndian<qint32>(85455940, pl + 8);
+            qToLittleEndian<qint32>(450000 + (qint32) (50000*sin(t)), pl + 12);
+            qToLittleEndian<qint32>(80000 + (qint32) (20000*sin(t)), pl + 16);
+            len += QMavlinkParser::pack(dgram + len, QMavlinkMessage::GLOBAL_POSITION_INT, pl, 28, seq++);
+
+            memset(pl, 0, sizeof(pl));
+            putFloat(pl + 0,  22.5f);
+            putFloat(pl + 4,  21.0f);
+            putFloat(pl + 8,  450.0f);
+            putFloat(pl + 12, 1.5f*sin(t));
+            qToLittleEndian<qint16>(123, pl + 16);
+            qToLittleEndian<quint16>(55, pl + 18);
+            len += QMavlinkParser::pack(dgram + len, QMavlinkMessage::VFR_HUD, pl, 20, seq++);
+
+            memset(pl, 0, sizeof(pl));
+            qToLittleEndian<quint16>(12400, pl + 14);
+            qToLittleEndian<qint16>(850, pl + 16);
+            pl[30] = 76;
+            len += QMavlinkParser::pack(dgram + len, QMavlinkMessage::SYS_STATUS, pl, 31, seq++);
+
+            if( sock.writeDatagram((const char*) dgram, len, QHostAddress::LocalHost, m_port) == len )
+                m_sent += g_msgsPerDatagram;
+
+            n++;
+
+            // pace to the requested message rate
+            if( m_rate > 0 ) {
+                qint64 due = (qint64) (m_sent / m_rate * 1e9);
+                qint64 now = clock.nsecsElapsed();
+                if( due > now ) QThread::usleep((due - now)/1000);
+            }
+        }
+    }
+
+    static void putFloat(uchar *p, float f) {
+        quint32 u;
+        memcpy(&u, &f, sizeof(u));
+        qToLittleEndian<quint32>(u, p);
+    }
+
+protected:
+    quint16     m_port;
+    double      m_seconds;
+    double      m_rate;
+    quint64     m_sent;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    if( qgetenv("QT_QPA_PLATFORM").isEmpty() )
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("MAVLink UDP loopback throughput test for QMavlinkSource");
+    parser.addHelpOption();
+
+    QCommandLineOption optSeconds("seconds", "Send duration.", "s", "3");
+    QCommandLineOption optRate("rate", "Sent messages per second (0: as fast as possible).", "n", "0");
+    QCommandLineOption optOut("out", "Write JSON report to file (default: stdout).", "file");
+    QCommandLineOption optMinRate("min-rate",
+                                  "Exit with 2 if fewer messages per second are decoded.",
+                                  "n");
+    parser.addOption(optSeconds);
+    parser.addOption(optRate);
+    parser.addOption(optOut);
+    parser.addOption(optMinRate);
+    parser.process(app);
+
+    double  seconds = qMax(0.1, parser.value(optSeconds).toDouble());
+
+    // receiver feeds real instruments, they are just not shown
+    QADI                adi;
+    QCompass            compass;
+    QKeyValueListView   list;
+    QMavlinkSource      src;
+
+    src.attach(&adi);
+    src.attach(&compass);
+    src.attach(&list);
+
+    if( src.open(0) != 0 ) {
+        fprintf(stderr, "ERR: can not open MAVLink source\n");
+        return 1;
+    }
+
+    BenchSender sender(src.getPort(), seconds, parser.value(optRate).toDouble());
+    QElapsedTimer clock;
+
+    clock.start();
+    sender.start();
+
+    while( !sender.isFinished() )
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+
+    // let the receive thread catch up
+    qint64 tSend = clock.nsecsElapsed();
+    QElapsedTimer settle;
+    settle.start();
+    while( settle.elapsed() < 300 )
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+
+    src.close();
+
+    quint64 sent = sender.getSent();
+    quint64 recv = src.getMsgCount();
+    double  rate = recv * 1e9 / tSend;
+
+    QJsonObject report;
+    report["qt_version"]       = QString(qVersion());
+    report["port"]             = src.getPort();
+    report["seconds"]          = tSend / 1e9;
+    report["msgs_sent"]        = (double) sent;
+    report["msgs_received"]    = (double) recv;
+    report["msgs_per_s"]       = rate;
+    report["datagrams"]        = (double) src.getPacketCount();
+    report["errors"]           = (double) src.getErrorCount();
+    report["loss_pct"]         = sent ? 100.0*(sent - qMin(sent, recv))/sent : 0.0;
+    report["queue_overruns"]   = src.getOverrunCount();
+
+    QByteArray json = QJsonDocument(report).toJson();
+
+    if( parser.isSet(optOut) ) {
+        QFile f(parser.value(optOut));
+        if( !f.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+            fprintf(stderr, "ERR: can not write report file: %s\n",
+                    qPrintable(parser.value(optOut)));
+            return 1;
+        }
+        f.write(json);
+    } else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+
+    if( src.getErrorCount() > 0 ) {
+        fprintf(stderr, "ERR: %llu corrupted packets\n",
+                (unsigned long long) src.getErrorCount());
+        return 3;
+    }
+
+    if( parser.isSet(optMinRate) && rate < parser.value(optMinRate).toDouble() ) {
+        fprintf(stderr, "ERR: %.0f msgs/s is below %s\n",
+                rate, qPrintable(parser.value(optMinRate)));
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# MAVLink UDP loopback throughput test
+#
+#-------------------------------------------------
+
+QT += core gui widgets network
+
+TARGET = bench_mavlink
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS += -std=c++11
+
+INCLUDEPATH += ..
+
+SOURCES += bench_mavlink.cpp \
+        ../qFlightInstruments.cpp \
+        ../qMavlinkSource.cpp \
+
+
+HEADERS  += ../qFlightInstruments.h \
+            ../qMavlinkSource.h
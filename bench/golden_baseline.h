@@ -0,0 +1,69 @@
+#ifndef __GOLDEN_BASELINE_H__
+#define __GOLDEN_BASELINE_H__
+
+#include <QtCore>
+#include <QtGui>
+#include <QWidget>
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief The ADI as painted before the layer caches (reference renderer)
+///
+///     paintEvent is the original QADI::paintEvent, unchanged, so the golden
+///     references hold the original appearance and not the one of the paint
+///     paths they are meant to check.
+///
+class QBaselineADI : public QWidget
+{
+public:
+    QBaselineADI(QWidget *parent = 0);
+
+    void setData(double r, double p) {
+        m_roll  = qBound(-180.0, r, 180.0);
+        m_pitch = qBound(-90.0, p, 90.0);
+    }
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+
+protected:
+    int     m_size, m_offset;               ///< current size & offset
+
+    double  m_roll;                         ///< roll angle (in degree)
+    double  m_pitch;                        ///< pitch angle (in degree)
+};
+
+///
+/// \brief The north-up compass as painted before the layer caches
+///     (reference renderer, original QCompass::paintEvent)
+///
+class QBaselineCompass : public QWidget
+{
+public:
+    QBaselineCompass(QWidget *parent = 0);
+
+    void setData(double y, double a, double h) {
+        m_yaw = y;
+        m_alt = a;
+        m_h   = h;
+
+        if( m_yaw < 0   ) m_yaw = 360 + m_yaw;
+        if( m_yaw > 360 ) m_yaw = m_yaw - 360;
+    }
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+
+protected:
+    int     m_size, m_offset;                   ///< widget size and offset size
+
+    double  m_yaw;                              ///< yaw angle (in degree)
+    double  m_alt;                              ///< altitude (in m)
+    double  m_h;                                ///< height from ground (in m)
+};
+
+#endif // end of __GOLDEN_BASELINE_H__
@@ -0,0 +1,488 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <vector>
+#include <algorithm>
+
+#include <QtCore>
+#include <QtGui>
+#include <QApplication>
+
+#include "qFlightInstruments.h"
+#include "golden_baseline.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// case grid
+///     every combination is rendered at every size, the case name is also
+///     the reference file name
+////////////////////////////////////////////////////////////////////////////////
+
+static const int    g_sizes[]   = { 200, 320, 480 };
+
+static const double g_roll[]    = { -60.0, 0.0, 35.0, 170.0 };
+static const double g_pitch[]   = { -25.0, 0.0, 12.0 };
+
+static const double g_yaw[]     = { 0.0, 123.4, 271.0 };
+static const double g_altH[][2] = { { 0.0, 0.0 }, { 450.5, 87.3 } };
+
+#define N_OF(a) ((int) (sizeof(a)/sizeof(a[0])))
+
+struct GoldenCase
+{
+    QString     name;
+    QWidget     *widget;
+    QWidget     *baseline;              ///< renders the reference, NULL: widget (no baseline mode)
+    int         size;
+    double      v[3];                   ///< roll, pitch / yaw, alt, H
+    int         mode;                   ///< QCompassRenderer::CardMode
+};
+
+struct GoldenResult
+{
+    QString     name;
+    bool        hasRef;
+    int         diffPixels;             ///< pixels outside the tolerance
+    double      diffPct;
+    double      maxDelta;               ///< largest perceptual difference (0-255)
+    qint64      ns;                     ///< median render time
+    qint64      refNs;                  ///< reference render time (0: none)
+};
+
+static QList<GoldenCase> buildCases(QADI *adi, QCompass *compass,
+                                    QBaselineADI *baseAdi, QBaselineCompass *baseCompass)
+{
+    QList<GoldenCase>   cases;
+    GoldenCase          c;
+
+    for(int si=0; si<N_OF(g_sizes); si++) {
+        c.size = g_sizes[si];
+
+        c.widget   = adi;
+        c.baseline = baseAdi;
+        c.mode     = 0;
+        for(int ri=0; ri<N_OF(g_roll); ri++) {
+            for(int pi=0; pi<N_OF(g_pitch); pi++) {
+                c.v[0] = g_roll[ri];
+                c.v[1] = g_pitch[pi];
+                c.v[2] = 0;
+                c.name = QString::asprintf("adi_%d_r%.1f_p%.1f", c.size, c.v[0], c.v[1]);
+                cases.append(c);
+            }
+        }
+
+        c.widget = compass;
+        for(int mi=0; mi<2; mi++) {
+            c.mode = mi ? QCompassRenderer::HEADING_UP : QCompassRenderer::NORTH_UP;
+
+            // the original compass had no HSI, those references come from QCompass
+            c.baseline = mi ? NULL : baseCompass;
+
+            for(int yi=0; yi<N_OF(g_yaw); yi++) {
+                for(int ai=0; ai<N_OF(g_altH); ai++) {
+                    c.v[0] = g_yaw[yi];
+                    c.v[1] = g_altH[ai][0];
+                    c.v[2] = g_altH[ai][1];
+                    c.name = QString::asprintf("%s_%d_y%.1f_a%.1f_h%.1f",
+                                               mi ? "hsi" : "compass", c.size,
+                                               c.v[0], c.v[1], c.v[2]);
+                    cases.append(c);
+                }
+            }
+        }
+    }
+
+    return cases;
+}
+
+static void applyCase(const GoldenCase &c)
+{
+    QADI        *adi = qobject_cast<QADI*>(c.widget);
+    QCompass    *compass = qobject_cast<QCompass*>(c.widget);
+
+    c.widget->resize(c.size, c.size);
+    if( c.baseline ) c.baseline->resize(c.size, c.size);
+
+    if( adi ) {
+        adi->setData(c.v[0], c.v[1]);
+        ((QBaselineADI*) c.baseline)->setData(c.v[0], c.v[1]);
+    } else if( compass ) {
+        compass->setCardMode((QCompassRenderer::CardMode) c.mode);
+        if( c.mode == QCompassRenderer::HEADING_UP ) {
+            compass->setCourse(45.0, 0.8);
+            compass->setBearing(120.0);
+        } else {
+            compass->clearCourse();
+            compass->clearBearing();
+        }
+        compass->setData(c.v[0], c.v[1], c.v[2]);
+        if( c.baseline ) ((QBaselineCompass*) c.baseline)->setData(c.v[0], c.v[1], c.v[2]);
+    }
+}
+
+///
+/// \brief Render a case with the widget or its baseline
+/// \return median render time (in ns)
+///
+static qint64 renderCase(const GoldenCase &c, QWidget *w, int nFrames, QImage &img)
+{
+    QElapsedTimer       timer;
+    std::vector<qint64> ns(nFrames);
+
+    applyCase(c);
+    QCoreApplication::processEvents();
+
+    img = QImage(w->size(), QImage::Format_ARGB32_Premultiplied);
+
+    // first frame builds the cached layers, it is not timed
+    img.fill(Qt::transparent);
+    w->render(&img);
+
+    for(int i=0; i<nFrames; i++) {
+        img.fill(Qt::transparent);
+
+        timer.start();
+        w->render(&img);
+        ns[i] = timer.nsecsElapsed();
+    }
+
+    std::sort(ns.begin(), ns.end());
+
+    return ns[nFrames/2];
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// perceptual compare
+///     pixels are composited over mid grey and compared by luma-weighted
+///     RGB distance. A pixel only counts as different if no reference pixel
+///     in its 3x3 neighbourhood is within the tolerance, so antialiased
+///     edges shifted by a sub-pixel do not fail the case.
+////////////////////////////////////////////////////////////////////////////////
+
+static inline void overGrey(QRgb p, double *c)
+{
+    double a = qAlpha(p) / 255.0;
+
+    // premultiplied ARGB over (128, 128, 128)
+    c[0] = qRed(p)   + 128.0*(1 - a);
+    c[1] = qGreen(p) + 128.0*(1 - a);
+    c[2] = qBlue(p)  + 128.0*(1 - a);
+}
+
+static inline double pixelDelta(QRgb p, QRgb q)
+{
+    double  a[3], b[3];
+
+    overGrey(p, a);
+    overGrey(q, b);
+
+    return sqrt(0.299*(a[0]-b[0])*(a[0]-b[0]) +
+                0.587*(a[1]-b[1])*(a[1]-b[1]) +
+                0.114*(a[2]-b[2])*(a[2]-b[2]));
+}
+
+///
+/// \brief Compare an image with its reference
+/// \param diff - out: differing pixels in red over the dimmed image
+/// \return pixels outside the tolerance, -1 if the sizes differ
+///
+static int compareImages(const QImage &img, const QImage &ref, double tolerance,
+                         double *maxDelta, QImage *diff)
+{
+    int     w = img.width(), h = img.height();
+    int     n = 0;
+
+    *maxDelta = 0;
+
+    if( img.size() != ref.size() ) return -1;
+
+    *diff = QImage(w, h, QImage::Format_ARGB32);
+
+    for(int y=0; y<h; y++) {
+        const QRgb  *p = (const QRgb*) img.constScanLine(y);
+        QRgb        *o = (QRgb*) diff->scanLine(y);
+
+        for(int x=0; x<w; x++) {
+            double  d = pixelDelta(p[x], ((const QRgb*) ref.constScanLine(y))[x]);
+
+            if( d > tolerance ) {
+                for(int yy=qMax(0, y-1); yy<=qMin(h-1, y+1) && d > tolerance; yy++) {
+                    const QRgb *r = (const QRgb*) ref.constScanLine(yy);
+
+                    for(int xx=qMax(0, x-1); xx<=qMin(w-1, x+1) && d > tolerance; xx++)
+                        d = qMin(d, pixelDelta(p[x], r[xx]));
+                }
+            }
+
+            if( d > *maxDelta ) *maxDelta = d;
+
+            if( d > tolerance ) {
+                o[x] = qRgb(255, 0, 0);
+                n++;
+            } else {
+                int g = qGray(p[x]) / 3;
+                o[x] = qRgb(g, g, g);
+            }
+        }
+    }
+
+    return n;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef GOLDEN_DIR
+#define GOLDEN_DIR "golden"
+#endif
+
+int main(int argc, char *argv[])
+{
+    // render without a display unless told otherwise
+    if( qgetenv("QT_QPA_PLATFORM").isEmpty() )
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Golden-image regression test for QADI & QCompass");
+    parser.addHelpOption();
+
+    QCommandLineOption optRef("ref", "Reference directory (PNGs & timing.json).", "dir", GOLDEN_DIR);
+    QCommandLineOption optUpdate("update",
+                                 "Write the references instead of comparing, rendered by the "
+                                 "original paint code (HSI: by QCompass).");
+    QCommandLineOption optCurrent("from-current",
+                                  "With --update, render the references with the current "
+                                  "widgets (after an intended change of appearance).");
+    QCommandLineOption optDiff("diff", "Write diff images of failed cases to dir.", "dir");
+    QCommandLineOption optTol("tolerance", "Perceptual pixel tolerance (0-255).", "d", "12");
+    QCommandLineOption optMaxPct("max-diff-pct",
+                                 "Fail a case if more than pct of its pixels differ.",
+                                 "pct", "0.05");
+    QCommandLineOption optFrames("frames", "Timed frames per case (median).", "n", "15");
+    QCommandLineOption optMaxReg("max-regression",
+                                 "Exit with 3 if a case is slower than its reference by more than pct.",
+                                 "pct", "50");
+    QCommandLineOption optMinNs("min-ns",
+                                "Ignore timing regressions smaller than n ns (timer noise).",
+                                "n", "50000");
+    QCommandLineOption optOut("out", "Write JSON report to file (default: stdout).", "file");
+    parser.addOption(optRef);
+    parser.addOption(optUpdate);
+    parser.addOption(optCurrent);
+    parser.addOption(optDiff);
+    parser.addOption(optTol);
+    parser.addOption(optMaxPct);
+    parser.addOption(optFrames);
+    parser.addOption(optMaxReg);
+    parser.addOption(optMinNs);
+    parser.addOption(optOut);
+    parser.process(app);
+
+    QDir    refDir(parser.value(optRef));
+    bool    update    = parser.isSet(optUpdate);
+    bool    current   = parser.isSet(optCurrent);
+    double  tolerance = parser.value(optTol).toDouble();
+    double  maxPct    = parser.value(optMaxPct).toDouble();
+    double  maxReg    = parser.value(optMaxReg).toDouble();
+    qint64  minNs     = parser.value(optMinNs).toLongLong();
+    int     nFrames   = qMax(1, parser.value(optFrames).toInt());
+
+    if( update && !refDir.mkpath(".") ) {
+        fprintf(stderr, "ERR: can not create reference directory: %s\n",
+                qPrintable(refDir.path()));
+        return 1;
+    }
+
+    if( parser.isSet(optDiff) && !QDir().mkpath(parser.value(optDiff)) ) {
+        fprintf(stderr, "ERR: can not create diff directory: %s\n",
+                qPrintable(parser.value(optDiff)));
+        return 1;
+    }
+
+    // no baseline is a failure, not a pass: stop before rendering anything
+    if( !update && refDir.entryList(QStringList("*.png"), QDir::Files).isEmpty() ) {
+        fprintf(stderr, "ERR: no reference images in %s; render them with --update on the "
+                        "reference platform and commit them\n", qPrintable(refDir.path()));
+        return 1;
+    }
+
+    // reference timings
+    QJsonObject refTiming;
+    if( !update ) {
+        QFile f(refDir.filePath("timing.json"));
+        if( f.open(QIODevice::ReadOnly) )
+            refTiming = QJsonDocument::fromJson(f.readAll()).object();
+    }
+
+    QADI                adi;
+    QCompass            compass;
+    QBaselineADI        baseAdi;
+    QBaselineCompass    baseCompass;
+
+    adi.setAttribute(Qt::WA_DontShowOnScreen);
+    compass.setAttribute(Qt::WA_DontShowOnScreen);
+    baseAdi.setAttribute(Qt::WA_DontShowOnScreen);
+    baseCompass.setAttribute(Qt::WA_DontShowOnScreen);
+    adi.show();
+    compass.show();
+    baseAdi.show();
+    baseCompass.show();
+
+    QList<GoldenCase>   cases = buildCases(&adi, &compass, &baseAdi, &baseCompass);
+    QList<GoldenResult> results;
+    QJsonObject         timing;
+    int                 nMissing = 0, nDiff = 0, nSlow = 0;
+    QImage              img, diff;
+
+    for(int i=0; i<cases.size(); i++) {
+        const GoldenCase    &c = cases[i];
+        GoldenResult        r;
+        QString             fname = refDir.filePath(c.name + ".png");
+
+        r.name       = c.name;
+        r.ns         = renderCase(c, update && !current && c.baseline ? c.baseline : c.widget,
+                                  nFrames, img);
+        r.refNs      = (qint64) refTiming.value(c.name).toDouble();
+        r.hasRef     = false;
+        r.diffPixels = 0;
+        r.diffPct    = 0;
+        r.maxDelta   = 0;
+
+        timing[c.name] = (double) r.ns;
+
+        if( update ) {
+            if( !img.save(fname, "PNG") ) {
+                fprintf(stderr, "ERR: can not write reference: %s\n", qPrintable(fname));
+                return 1;
+            }
+            results.append(r);
+            continue;
+        }
+
+        QImage ref(fname);
+
+        if( ref.isNull() ) {
+            nMissing++;
+            results.append(r);
+            continue;
+        }
+
+        r.hasRef     = true;
+        r.diffPixels = compareImages(img,
+                                     ref.convertToFormat(QImage::Format_ARGB32_Premultiplied),
+                                     tolerance, &r.maxDelta, &diff);
+
+        if( r.diffPixels < 0 ) {
+            // size mismatch: everything differs
+            r.diffPixels = img.width()*img.height();
+            r.diffPct    = 100;
+        } else {
+            r.diffPct = 100.0 * r.diffPixels / (img.width()*img.height());
+        }
+
+        if( r.diffPct > maxPct ) {
+            nDiff++;
+
+            if( parser.isSet(optDiff) ) {
+                QDir d(parser.value(optDiff));
+                img.save(d.filePath(c.name + ".png"), "PNG");
+                if( !diff.isNull() && diff.size() == img.size() )
+                    diff.save(d.filePath(c.name + "_diff.png"), "PNG");
+            }
+        }
+
+        if( r.refNs > 0 && r.ns - r.refNs > minNs &&
+            100.0*(r.ns - r.refNs)/r.refNs > maxReg )
+            nSlow++;
+
+        results.append(r);
+    }
+
+    if( update ) {
+        QFile f(refDir.filePath("timing.json"));
+        if( !f.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+            fprintf(stderr, "ERR: can not write timing file: %s\n",
+                    qPrintable(f.fileName()));
+            return 1;
+        }
+        f.write(QJsonDocument(timing).toJson());
+    }
+
+    // build report
+    QJsonArray  jcases;
+
+    for(int i=0; i<results.size(); i++) {
+        const GoldenResult &r = results[i];
+        QJsonObject o;
+
+        o["case"]      = r.name;
+        o["ns"]        = (double) r.ns;
+
+        if( r.refNs > 0 ) {
+            o["ref_ns"]    = (double) r.refNs;
+            o["delta_pct"] = 100.0*(r.ns - r.refNs)/r.refNs;
+        }
+
+        if( !update ) {
+            o["has_ref"]     = r.hasRef;
+            o["diff_pixels"] = r.diffPixels;
+            o["diff_pct"]    = r.diffPct;
+            o["max_delta"]   = r.maxDelta;
+        }
+
+        jcases.append(o);
+    }
+
+    QJsonObject report;
+    report["qt_version"]    = QString(qVersion());
+    report["platform"]      = QGuiApplication::platformName();
+    report["update"]        = update;
+    if( update )
+        report["reference_source"] = current ? "current" : "baseline";
+    report["tolerance"]     = tolerance;
+    report["max_diff_pct"]  = maxPct;
+    report["missing"]       = nMissing;
+    report["failed_pixels"] = nDiff;
+    report["failed_timing"] = nSlow;
+    report["cases"]         = jcases;
+
+    QByteArray json = QJsonDocument(report).toJson();
+
+    if( parser.isSet(optOut) ) {
+        QFile f(parser.value(optOut));
+        if( !f.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+            fprintf(stderr, "ERR: can not write report file: %s\n",
+                    qPrintable(parser.value(optOut)));
+            return 1;
+        }
+        f.write(json);
+    } else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+
+    if( nMissing > 0 ) {
+        fprintf(stderr, "ERR: %d of %d references missing in %s (run with --update)\n",
+                nMissing, cases.size(), qPrintable(refDir.path()));
+        return 1;
+    }
+
+    if( nDiff > 0 ) {
+        fprintf(stderr, "ERR: %d of %d cases differ from the references\n",
+                nDiff, cases.size());
+        return 2;
+    }
+
+    if( nSlow > 0 ) {
+        fprintf(stderr, "ERR: %d of %d cases are more than %s%% slower than the references\n",
+                nSlow, cases.size(), qPrintable(parser.value(optMaxReg)));
+        return 3;
+    }
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Golden-image regression test for QADI & QCompass
+#
+#-------------------------------------------------
+
+QT += core gui widgets
+
+TARGET = golden_instruments
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS += -std=c++11
+
+INCLUDEPATH += ..
+
+# references live in the source tree (bench/golden), whatever the build directory
+DEFINES += GOLDEN_DIR=\\\"$$PWD/golden\\\"
+
+SOURCES += golden_instruments.cpp \
+        golden_baseline.cpp \
+        ../qFlightInstruments.cpp \
+
+
+HEADERS  += golden_baseline.h \
+        ../qFlightInstruments.h
@@ -1,17 +1,160 @@
+#include <stdio.h>
+#include <string.h>
+
 #include <QtCore>
 #include <QtGui>
 #include <QWidget>
 #include <QApplication>
 
 #include "qFlightInstruments.h"
+#include "qInstrumentExport.h"
+#include "qQuickInstruments.h"
+#include "qInstrumentStream.h"
 #include "TestWin.h"
 
+#include <QQmlApplicationEngine>
+
+///
+/// \brief Export instrument frames of a telemetry log, no window is shown
+///
+static int exportFrames(QCommandLineParser &parser, const QString &fname)
+{
+    QInstrumentExporter exporter;
+
+    exporter.setFps(parser.value("fps").toDouble());
+    exporter.setSize(parser.value("size").toInt());
+    exporter.setThreads(parser.value("threads").toInt());
+
+    if( exporter.open(fname) != 0 ) return 1;
+
+    QSize   fs = exporter.getFrameSize();
+    int     ret;
+
+    fprintf(stderr, "exporting %d frames of %dx%d at %g fps\n",
+            exporter.getFrameCount(), fs.width(), fs.height(), exporter.getFps());
+
+    if( parser.isSet("png") )
+        ret = exporter.exportPng(parser.value("png"));
+    else
+        ret = exporter.exportRaw(stdout);
+
+    if( ret != 0 ) {
+        fprintf(stderr, "ERR: can not write frames\n");
+        return 1;
+    }
+
+    fprintf(stderr, "done in %.1f s, %.0f frames/s (%.1fx real time)\n",
+            exporter.getElapsed() / 1000.0,
+            exporter.getFrameCount() * 1000.0 / qMax((qint64) 1, exporter.getElapsed()),
+            exporter.getFrameCount() / exporter.getFps() * 1000.0 / qMax((qint64) 1, exporter.getElapsed()));
+
+    return 0;
+}
+
+///
+/// \brief Qt Quick demo: ADI & Compass items driven by a QML timer
+///
+static const char *g_qmlDemo =
+    "import QtQuick 2.0\n"
+    "import QtQuick.Window 2.0\n"
+    "import FlightInstruments 1.0\n"
+    "Window {\n"
+    "    visible: true; width: 620; height: 320; color: \"#303030\"\n"
+    "    title: \"qFlightInstruments - Qt Quick\"\n"
+    "    property real t: 0\n"
+    "    Row {\n"
+    "        x: 10; y: 10; spacing: 10\n"
+    "        ADI { width: 295; height: 295\n"
+    "              roll: 30*Math.sin(t*0.7); pitch: 15*Math.sin(t) }\n"
+    "        Compass { width: 295; height: 295\n"
+    "                  yaw: (t*20) % 360; alt: 450 + 50*Math.sin(t*0.3); h: 80 + 20*Math.sin(t*0.5) }\n"
+    "    }\n"
+    "    Timer { interval: 16; running: true; repeat: true; onTriggered: t += 0.016 }\n"
+    "}\n";
+
 int main(int argc, char *argv[])
 {
+    // exporting needs no display
+    for(int i=1; i<argc; i++) {
+        if( strcmp(argv[i], "--export") == 0 && qgetenv("QT_QPA_PLATFORM").isEmpty() )
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+
+        // Qt Quick without a GPU: 2D renderer (Qt < 5.8) / software backend
+        if( strcmp(argv[i], "--software") == 0 ) {
+            qputenv("QMLSCENE_DEVICE", "softwarecontext");
+            qputenv("QT_QUICK_BACKEND", "software");
+        }
+    }
+
     QApplication a(argc, argv);
 
+    QCommandLineParser parser;
+    QCommandLineOption optRecord("record", "Record keyboard input to a telemetry log.", "file");
+    QCommandLineOption optReplay("replay", "Replay a telemetry log.", "file");
+    QCommandLineOption optSpeed("speed", "Replay speed (0: as fast as possible).", "x", "1");
+    QCommandLineOption optMavlink("mavlink", "Receive MAVLink telemetry on a UDP port.", "port");
+    QCommandLineOption optExport("export", "Export instrument frames of a telemetry log (raw RGBA to stdout).", "file");
+    QCommandLineOption optPng("png", "Export as PNG files, e.g. out/%06d.png.", "pattern");
+    QCommandLineOption optFps("fps", "Export frame rate.", "n", "30");
+    QCommandLineOption optSize("size", "Export instrument size (in pixel).", "n", "196");
+    QCommandLineOption optThreads("threads", "Export render threads (0: one per core).", "n", "0");
+    QCommandLineOption optQml("qml", "Show the Qt Quick instruments instead of the widgets.");
+    QCommandLineOption optSoftware("software", "Render Qt Quick without OpenGL.");
+    QCommandLineOption optStream("stream", "Stream the instruments to viewers (port, host:port or socket name).", "address");
+    QCommandLineOption optView("view", "View a remote instrument stream.", "address");
+    parser.addHelpOption();
+    parser.addOption(optRecord);
+    parser.addOption(optReplay);
+    parser.addOption(optSpeed);
+    parser.addOption(optMavlink);
+    parser.addOption(optExport);
+    parser.addOption(optPng);
+    parser.addOption(optFps);
+    parser.addOption(optSize);
+    parser.addOption(optThreads);
+    parser.addOption(optQml);
+    parser.addOption(optSoftware);
+    parser.addOption(optStream);
+    parser.addOption(optView);
+    parser.process(a);
+
+    if( parser.isSet(optExport) )
+        return exportFrames(parser, parser.value(optExport));
+
+    if( parser.isSet(optQml) ) {
+        QQmlApplicationEngine engine;
+
+        registerQuickInstruments();
+        engine.loadData(g_qmlDemo);
+
+        if( engine.rootObjects().isEmpty() ) {
+            fprintf(stderr, "ERR: can not load the QML demo\n");
+            return 1;
+        }
+
+        return a.exec();
+    }
+
+    if( parser.isSet(optView) ) {
+        QInstrumentStreamViewer viewer;
+
+        if( viewer.connectTo(parser.value(optView)) != 0 ) return 1;
+
+        viewer.show();
+        return a.exec();
+    }
+
     TestWin testWin;
 
+    if( parser.isSet(optRecord) )
+        testWin.startRecord(parser.value(optRecord));
+    if( parser.isSet(optReplay) )
+        testWin.startReplay(parser.value(optReplay), parser.value(optSpeed).toDouble());
+    if( parser.isSet(optMavlink) )
+        testWin.startMavlink(parser.value(optMavlink).toUShort());
+    if( parser.isSet(optStream) )
+        testWin.startStream(parser.value(optStream));
+
     testWin.show();
 
     return a.exec();
@@ -1,560 +1,3893 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+
+#include <chrono>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ADI_DISC_SSE2 1
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ADI_DISC_AVX2 1                         // compiled for AVX2, used if the CPU has it
+#endif
 
 #include <QtCore>
 #include <QtGui>
 #include <QDebug>
-#include <QTableWidget>
+#include <QTableView>
 #include <QHeaderView>
 
 #include "qFlightInstruments.h"
 
 
+///
+/// \brief Device pixel ratio of a widget (fractional when Qt supports it)
+///
+static qreal widgetDpr(const QWidget *w)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    return w->devicePixelRatioF();
+#else
+    return w->devicePixelRatio();
+#endif
+}
+
+///
+/// \brief Create a transparent cache layer of w x h logical pixels
+///
+static QImage makeLayer(int w, int h, qreal dpr)
+{
+    QImage img(qCeil(w*dpr), qCeil(h*dpr), QImage::Format_ARGB32_Premultiplied);
+    img.setDevicePixelRatio(dpr);
+    img.fill(Qt::transparent);
+
+    return img;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
+/// Dial tick geometry
+///     roll/yaw rings have a tick every 10 deg, so their directions come from
+///     a fixed table; ticks are batched into line lists (one drawLines per
+///     pen) and labels get their transform set directly
 ////////////////////////////////////////////////////////////////////////////////
 
+///
+/// \brief sin(i*10 deg), i = 0..35 (cos(i*10 deg) = g_tickSin[(i+9) % 36])
+///
+static const double g_tickSin[36] = {
+     0,                    0.17364817766693035,  0.34202014332566873,  0.5,
+     0.64278760968653933,  0.76604444311897804,  0.86602540378443865,  0.93969262078590838,
+     0.98480775301220806,  1,                    0.98480775301220806,  0.93969262078590838,
+     0.86602540378443865,  0.76604444311897804,  0.64278760968653933,  0.5,
+     0.34202014332566873,  0.17364817766693035,  0,                   -0.17364817766693035,
+    -0.34202014332566873, -0.5,                 -0.64278760968653933, -0.76604444311897804,
+    -0.86602540378443865, -0.93969262078590838, -0.98480775301220806, -1,
+    -0.98480775301220806, -0.93969262078590838, -0.86602540378443865, -0.76604444311897804,
+    -0.64278760968653933, -0.5,                 -0.34202014332566873, -0.17364817766693035
+};
+
+///
+/// \brief Radial tick i of a 10 deg ring, from radius r0 inwards by len
+/// \param dir - +1 clockwise (roll ring), -1 counter-clockwise (yaw ring)
+///
+static QLineF ringTick(int i, double r0, double len, int dir)
+{
+    double  s = dir*g_tickSin[i], c = g_tickSin[(i+9) % 36];
+
+    return QLineF(s*r0, -c*r0, s*(r0 - len), -c*(r0 - len));
+}
 
-QADI::QADI(QWidget *parent)
-    : QWidget(parent)
+///
+/// \brief Transform which rotates the ring's top to tick i, on top of base
+///
+static QTransform ringTransform(int i, int dir, const QTransform &base)
 {
-    connect(this, SIGNAL(canvasReplot(void)), this, SLOT(canvasReplot_slot(void)));
+    double  s = dir*g_tickSin[i], c = g_tickSin[(i+9) % 36];
 
-    m_sizeMin = 200;
-    m_sizeMax = 600;
-    m_offset = 2;
-    m_size = m_sizeMin - 2*m_offset;
+    return QTransform(c, s, -s, c, 0, 0) * base;
+}
 
-    setMinimumSize(m_sizeMin, m_sizeMin);
-    setMaximumSize(m_sizeMax, m_sizeMax);
-    resize(m_sizeMin, m_sizeMin);
 
-    setFocusPolicy(Qt::NoFocus);
+////////////////////////////////////////////////////////////////////////////////
+/// ADI sky/ground disc rasterizer
+///     the disc is a circle split by a rotated half-plane, so every pixel's
+///     coverage is computed analytically (scalar, SSE2 and AVX2 kernels give
+///     identical results)
+////////////////////////////////////////////////////////////////////////////////
 
-    m_roll  = 0.0;
-    m_pitch = 0.0;
+///
+/// \brief ADI disc parameters (in device pixels)
+///
+///     Sky/ground are split by the horizon d = nx*x + ny*y - off (ground
+///     where d > 0), a line of lineHalf half width is drawn on the horizon.
+///     Coverage of the horizon, line & rim edges is analytic: edge = 1 for
+///     a one pixel ramp (antialiased), large for hard edges.
+///
+struct DiscRaster
+{
+    float   cx, cy, r;                          ///< disc center & radius
+    float   nx, ny, off;                        ///< horizon
+    float   lineHalf;                           ///< horizon line half width
+    float   edge;                               ///< edge sharpness
+    float   sky[3], ground[3], line[3];         ///< r, g, b
+};
+
+static inline float clamp01(float v)
+{
+    return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
 }
 
-QADI::~QADI()
+///
+/// \brief Fill pixels [x0, x1) of scanline y (premultiplied ARGB32)
+///
+static void discSpanScalar(quint32 *dst, int y, int x0, int x1, const DiscRaster &p)
 {
+    float   fy  = y + 0.5f - p.cy;
+    float   nyf = p.ny*fy;
+    float   fy2 = fy*fy;
+
+    for(int x=x0; x<x1; x++) {
+        float   fx = (float) x + 0.5f - p.cx;
+        float   d  = (p.nx*fx + nyf) - p.off;
+        float   ad = d < 0.0f ? -d : d;
+        float   g  = clamp01(d*p.edge + 0.5f);
+        float   l  = clamp01((p.lineHalf - ad)*p.edge + 0.5f);
+        float   a  = clamp01((p.r - sqrtf(fx*fx + fy2))*p.edge + 0.5f);
+        float   c[3];
+
+        for(int i=0; i<3; i++) {
+            float v = p.sky[i] + (p.ground[i] - p.sky[i])*g;
+            c[i] = (v + (p.line[i] - v)*l)*a + 0.5f;
+        }
 
+        dst[x] = ((quint32) (int) (a*255.0f + 0.5f) << 24) |
+                 ((quint32) (int) c[0] << 16) |
+                 ((quint32) (int) c[1] << 8) |
+                  (quint32) (int) c[2];
+    }
 }
 
+#if defined(ADI_DISC_SSE2)
+static void discSpanSse2(quint32 *dst, int y, int x0, int x1, const DiscRaster &p)
+{
+    const __m128    zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f);
+    const __m128    absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128    ramp = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const __m128    edge = _mm_set1_ps(p.edge), nx = _mm_set1_ps(p.nx);
+    float           fy = y + 0.5f - p.cy;
+    const __m128    nyf = _mm_set1_ps(p.ny*fy), fy2 = _mm_set1_ps(fy*fy);
+    __m128          cs[3], cd[3], cl[3];
+    int             x = x0;
+
+    for(int i=0; i<3; i++) {
+        cs[i] = _mm_set1_ps(p.sky[i]);
+        cd[i] = _mm_set1_ps(p.ground[i] - p.sky[i]);
+        cl[i] = _mm_set1_ps(p.line[i]);
+    }
+
+    for(; x + 4 <= x1; x += 4) {
+        __m128  fx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps((float) x), ramp), _mm_set1_ps(p.cx));
+        __m128  d  = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(nx, fx), nyf), _mm_set1_ps(p.off));
+        __m128  ad = _mm_and_ps(d, absMask);
+        __m128  g  = _mm_add_ps(_mm_mul_ps(d, edge), half);
+        __m128  l  = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(p.lineHalf), ad), edge), half);
+        __m128  a  = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(fx, fx), fy2));
+
+        a = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(p.r), a), edge), half);
+        g = _mm_min_ps(_mm_max_ps(g, zero), one);
+        l = _mm_min_ps(_mm_max_ps(l, zero), one);
+        a = _mm_min_ps(_mm_max_ps(a, zero), one);
+
+        __m128i c[3];
+        for(int i=0; i<3; i++) {
+            __m128 v = _mm_add_ps(cs[i], _mm_mul_ps(cd[i], g));
+            v = _mm_add_ps(v, _mm_mul_ps(_mm_sub_ps(cl[i], v), l));
+            c[i] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, a), half));
+        }
+
+        __m128i px = _mm_slli_epi32(_mm_cvttps_epi32(
+                         _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(255.0f)), half)), 24);
+        px = _mm_or_si128(px, _mm_slli_epi32(c[0], 16));
+        px = _mm_or_si128(px, _mm_slli_epi32(c[1], 8));
+        px = _mm_or_si128(px, c[2]);
 
-void QADI::canvasReplot_slot(void)
+        _mm_storeu_si128((__m128i*) (dst + x), px);
+    }
+
+    discSpanScalar(dst, y, x, x1, p);
+}
+#endif
+
+#if defined(ADI_DISC_AVX2)
+__attribute__((target("avx2")))
+static void discSpanAvx2(quint32 *dst, int y, int x0, int x1, const DiscRaster &p)
 {
-    update();
+    const __m256    zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), half = _mm256_set1_ps(0.5f);
+    const __m256    absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256    ramp = _mm256_set_ps(7.5f, 6.5f, 5.5f, 4.5f, 3.5f, 2.5f, 1.5f, 0.5f);
+    const __m256    edge = _mm256_set1_ps(p.edge), nx = _mm256_set1_ps(p.nx);
+    float           fy = y + 0.5f - p.cy;
+    const __m256    nyf = _mm256_set1_ps(p.ny*fy), fy2 = _mm256_set1_ps(fy*fy);
+    __m256          cs[3], cd[3], cl[3];
+    int             x = x0;
+
+    for(int i=0; i<3; i++) {
+        cs[i] = _mm256_set1_ps(p.sky[i]);
+        cd[i] = _mm256_set1_ps(p.ground[i] - p.sky[i]);
+        cl[i] = _mm256_set1_ps(p.line[i]);
+    }
+
+    for(; x + 8 <= x1; x += 8) {
+        __m256  fx = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float) x), ramp), _mm256_set1_ps(p.cx));
+        __m256  d  = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(nx, fx), nyf), _mm256_set1_ps(p.off));
+        __m256  ad = _mm256_and_ps(d, absMask);
+        __m256  g  = _mm256_add_ps(_mm256_mul_ps(d, edge), half);
+        __m256  l  = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(p.lineHalf), ad), edge), half);
+        __m256  a  = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(fx, fx), fy2));
+
+        a = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(p.r), a), edge), half);
+        g = _mm256_min_ps(_mm256_max_ps(g, zero), one);
+        l = _mm256_min_ps(_mm256_max_ps(l, zero), one);
+        a = _mm256_min_ps(_mm256_max_ps(a, zero), one);
+
+        __m256i c[3];
+        for(int i=0; i<3; i++) {
+            __m256 v = _mm256_add_ps(cs[i], _mm256_mul_ps(cd[i], g));
+            v = _mm256_add_ps(v, _mm256_mul_ps(_mm256_sub_ps(cl[i], v), l));
+            c[i] = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, a), half));
+        }
+
+        __m256i px = _mm256_slli_epi32(_mm256_cvttps_epi32(
+                         _mm256_add_ps(_mm256_mul_ps(a, _mm256_set1_ps(255.0f)), half)), 24);
+        px = _mm256_or_si256(px, _mm256_slli_epi32(c[0], 16));
+        px = _mm256_or_si256(px, _mm256_slli_epi32(c[1], 8));
+        px = _mm256_or_si256(px, c[2]);
+
+        _mm256_storeu_si256((__m256i*) (dst + x), px);
+    }
+
+    discSpanScalar(dst, y, x, x1, p);
 }
+#endif
 
+typedef void (*DiscSpanFunc)(quint32 *dst, int y, int x0, int x1, const DiscRaster &p);
 
-void QADI::resizeEvent(QResizeEvent *event)
+static DiscSpanFunc discSpanFunc(void)
 {
-    m_size = qMin(width(),height()) - 2*m_offset;
+#if defined(ADI_DISC_AVX2)
+    if( __builtin_cpu_supports("avx2") ) return discSpanAvx2;
+#endif
+#if defined(ADI_DISC_SSE2)
+    return discSpanSse2;
+#else
+    return discSpanScalar;
+#endif
 }
 
-void QADI::paintEvent(QPaintEvent *)
+///
+/// \brief Rasterize the disc into img (premultiplied ARGB32), pixels
+///     outside the disc are cleared
+///
+static void rasterDisc(QImage &img, const DiscRaster &p)
 {
-    QPainter painter(this);
+    static const DiscSpanFunc   span = discSpanFunc();
 
-    QBrush bgSky(QColor(48,172,220));
-    QBrush bgGround(QColor(247,168,21));
+    int     w = img.width(), h = img.height();
+    float   rm = p.r + 1.0f;
 
-    QPen   whitePen(Qt::white);
-    QPen   blackPen(Qt::black);
-    QPen   pitchPen(Qt::white);
-    QPen   pitchZero(Qt::green);
+    for(int y=0; y<h; y++) {
+        quint32 *line = (quint32*) img.scanLine(y);
+        float   fy = y + 0.5f - p.cy;
+        int     x0 = 0, x1 = 0;
 
-    whitePen.setWidth(2);
-    blackPen.setWidth(2);
-    pitchZero.setWidth(3);
+        if( fabsf(fy) < rm ) {
+            float hx = sqrtf(rm*rm - fy*fy);
 
-    painter.setRenderHint(QPainter::Antialiasing);
+            x0 = qBound(0, (int) floorf(p.cx - hx), w);
+            x1 = qBound(x0, (int) ceilf(p.cx + hx), w);
+        }
 
-    painter.translate(width() / 2, height() / 2);
-    painter.rotate(m_roll);
+        memset(line, 0, x0*4);
+        span(line, y, x0, x1, p);
+        memset(line + x1, 0, (w - x1)*4);
+    }
+}
 
-    // FIXME: AHRS output left-hand values
-    double pitch_tem = -m_pitch;
 
-    // draw background
-    {
-        int y_min, y_max;
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
 
-        y_min = m_size/2*-40.0/45.0;
-        y_max = m_size/2* 40.0/45.0;
 
-        int y = m_size/2*pitch_tem/45.;
-        if( y < y_min ) y = y_min;
-        if( y > y_max ) y = y_max;
+QInstrumentScheduler::QInstrumentScheduler(QObject *parent)
+    : QObject(parent)
+{
+    m_rate = 60.0;
 
-        int x = sqrt(m_size*m_size/4 - y*y);
-        qreal gr = atan((double)(y)/x);
-        gr = gr * 180./3.1415926;
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setInterval(qRound(1000.0/m_rate));
+    connect(m_timer, SIGNAL(timeout(void)), this, SLOT(frameTick_slot(void)));
 
-        painter.setPen(blackPen);
-        painter.setBrush(bgSky);
-        painter.drawChord(-m_size/2, -m_size/2, m_size, m_size,
-                          gr*16, (180-2*gr)*16);
+    resetCounters();
+}
+
+QPointer<QInstrumentScheduler> QInstrumentScheduler::s_instance;
+
+QInstrumentScheduler* QInstrumentScheduler::instance(void)
+{
+    if( s_instance.isNull() )
+        s_instance = new QInstrumentScheduler(QCoreApplication::instance());
+
+    return s_instance;
+}
+
+void QInstrumentScheduler::registerWidget(QWidget *w)
+{
+    DirtyState ds;
+    ds.dirty = false;
+    ds.full  = false;
+
+    m_widgets.insert(w, ds);
+}
+
+void QInstrumentScheduler::unregisterWidget(QWidget *w)
+{
+    m_widgets.remove(w);
+    m_dirtyList.removeAll(w);
+}
+
+void QInstrumentScheduler::markDirty(QWidget *w)
+{
+    addDirty(w, 0);
+}
+
+void QInstrumentScheduler::markDirty(QWidget *w, const QRegion &r)
+{
+    addDirty(w, &r);
+}
+
+void QInstrumentScheduler::addDirty(QWidget *w, const QRegion *r)
+{
+    QHash<QWidget*, DirtyState>::iterator it = m_widgets.find(w);
+
+    m_nRequest++;
+
+    if( it == m_widgets.end() || !m_timer->isActive() ) {
+        // not registered, or idle: repaint at once (and pace the following ones)
+        m_nRepaint++;
+        if( r ) w->update(*r);
+        else    w->update();
+
+        if( it != m_widgets.end() ) m_timer->start();
+        return;
+    }
+
+    DirtyState &ds = it.value();
+
+    if( ds.dirty ) {
+        m_nMerged++;
+        if( !ds.full ) {
+            if( r ) ds.region += *r;
+            else    ds.full = true;
+        }
+        return;
+    }
+
+    ds.dirty  = true;
+    ds.full   = (r == 0);
+    ds.region = r ? *r : QRegion();
+    m_dirtyList.append(w);
+}
+
+void QInstrumentScheduler::setTargetRate(double hz)
+{
+    if( hz < 1 )    hz = 1;
+    if( hz > 1000 ) hz = 1000;
+
+    m_rate = hz;
+    m_timer->setInterval(qRound(1000.0/m_rate));
+}
+
+void QInstrumentScheduler::resetCounters(void)
+{
+    m_nRequest = 0;
+    m_nRepaint = 0;
+    m_nMerged  = 0;
+    m_nDropped = 0;
+}
+
+void QInstrumentScheduler::frameTick_slot(void)
+{
+    if( m_dirtyList.isEmpty() ) {
+        m_timer->stop();
+        return;
+    }
+
+    for(int i=0; i<m_dirtyList.size(); i++) {
+        QWidget     *w = m_dirtyList[i];
+        DirtyState  &ds = m_widgets[w];
+
+        if( w->isVisible() ) {
+            m_nRepaint++;
+            if( ds.full ) w->update();
+            else          w->update(ds.region);
+        } else {
+            m_nDropped++;
+        }
+
+        ds.dirty  = false;
+        ds.region = QRegion();
+    }
+
+    m_dirtyList.clear();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+int QPaintHistogram::bucket(qint64 ns)
+{
+    int     e = 0;
+
+    if( ns < SUB ) return ns > 0 ? (int) ns : 0;
+
+    // e = floor(log2(ns)), the next SUB_BITS bits select the sub-bucket
+    while( (ns >> (e+1)) != 0 ) e++;
+
+    int b = (e - SUB_BITS + 1)*SUB + (int) ((ns >> (e - SUB_BITS)) & (SUB - 1));
+
+    return b < BUCKETS ? b : BUCKETS - 1;
+}
+
+qint64 QPaintHistogram::bucketValue(int b)
+{
+    if( b < SUB ) return b;
+
+    int     e = b / SUB + SUB_BITS - 1;
+    qint64  lo = (qint64) (SUB + b % SUB) << (e - SUB_BITS);
+
+    return lo + ((qint64) 1 << (e - SUB_BITS)) / 2;
+}
+
+qint64 QPaintHistogram::percentile(double p) const
+{
+    quint64     n = atomicLoad(m_count);
+    quint64     k, sum = 0;
+
+    if( n == 0 ) return 0;
+
+    k = (quint64) ceil(qBound(0.0, p, 100.0) / 100.0 * n);
+    if( k < 1 ) k = 1;
+
+    for(int b=0; b<BUCKETS; b++) {
+        sum += atomicLoad(m_bins[b]);
+        if( sum >= k ) return qMin(bucketValue(b), atomicLoad(m_max));
+    }
+
+    return atomicLoad(m_max);
+}
+
+void QPaintHistogram::reset(void)
+{
+    for(int b=0; b<BUCKETS; b++) atomicStore(m_bins[b], 0);
+
+    atomicStore(m_count, 0);
+    atomicStore(m_sum, 0);
+    atomicStore(m_max, 0);
+}
+
+
+QPaintStats::QPaintStats()
+{
+    atomicStore(m_requests, 0);
+
+    m_lastPaint = 0;
+    m_fpsStart  = 0;
+    m_fpsPaints = 0;
+    m_fps       = 0;
+}
+
+void QPaintStats::addPaint(qint64 t0, qint64 t1)
+{
+    m_paintTime.add(t1 - t0);
+    if( m_lastPaint > 0 ) m_interval.add(t0 - m_lastPaint);
+
+    // painting had stopped, do not keep showing the old rate
+    if( m_lastPaint > 0 && t0 - m_lastPaint >= 1000000000 ) {
+        m_fps       = 0;
+        m_fpsStart  = 0;
+        m_fpsPaints = 0;
+    }
+    m_lastPaint = t0;
+
+    // paints per second, over whole seconds
+    if( m_fpsStart == 0 ) m_fpsStart = t0;
+    m_fpsPaints++;
+
+    if( t1 - m_fpsStart >= 1000000000 ) {
+        m_fps       = m_fpsPaints * 1e9 / (t1 - m_fpsStart);
+        m_fpsStart  = t1;
+        m_fpsPaints = 0;
+    }
+}
+
+void QPaintStats::reset(void)
+{
+    m_paintTime.reset();
+    m_interval.reset();
+    atomicStore(m_requests, 0);
+
+    m_lastPaint = 0;
+    m_fpsStart  = 0;
+    m_fpsPaints = 0;
+    m_fps       = 0;
+}
+
+void QPaintStats::drawHud(QPainter &painter) const
+{
+    QRect   rc = hudRect();
+    QFont   font("Monospace");
+
+    font.setStyleHint(QFont::TypeWriter);
+    font.setPixelSize(11);
+
+    QString s = QString::asprintf("paint p50 %5.2f p99 %5.2f\n"
+                                  "max %6.2f ms %6.1f fps\n"
+                                  "req %-8llu paint %llu",
+                                  m_paintTime.percentile(50) / 1e6,
+                                  m_paintTime.percentile(99) / 1e6,
+                                  m_paintTime.getMax() / 1e6,
+                                  m_fps,
+                                  (unsigned long long) getRequestCount(),
+                                  (unsigned long long) getPaintCount());
+
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing, false);
+    painter.fillRect(rc, QColor(0, 0, 0, 160));
+    painter.setPen(QColor(0, 255, 0));
+    painter.setFont(font);
+    painter.drawText(rc.adjusted(4, 2, -2, -2), Qt::AlignLeft | Qt::AlignTop, s);
+    painter.restore();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QQualityGovernor::QQualityGovernor()
+{
+    m_budget    = 0;
+    m_avg       = 0;
+    m_level     = LEVEL_FULL;
+    m_samples   = 0;
+    m_headroom  = 0;
+    m_upDelay   = 30;
+    m_steppedUp = false;
+}
+
+void QQualityGovernor::setBudget(double ms)
+{
+    m_budget = ms > 0 ? (qint64) (ms*1e6) : 0;
+
+    m_upDelay   = 30;
+    m_steppedUp = false;
+    setLevel(LEVEL_FULL);
+}
+
+bool QQualityGovernor::setLevel(int level)
+{
+    if( level == m_level ) return false;
+
+    m_level    = level;
+    m_samples  = -1;
+    m_headroom = 0;
+
+    return true;
+}
+
+bool QQualityGovernor::addPaint(qint64 ns)
+{
+    if( m_budget <= 0 ) return false;
+
+    // the first paint at a new level rebuilds the layers, it says nothing
+    if( m_samples < 0 ) {
+        m_samples = 0;
+        return false;
+    }
+
+    m_avg = m_samples == 0 ? ns : m_avg + 0.2*(ns - m_avg);
+    m_samples++;
+
+    // a level which held for a while is not the one to blame any more
+    if( m_samples > 4*m_upDelay ) m_steppedUp = false;
+
+    if( m_samples < 3 ) return false;
+
+    if( m_avg > m_budget ) {
+        if( m_level >= LEVEL_NUM - 1 ) return false;
+
+        if( m_steppedUp ) m_upDelay = qMin(m_upDelay*2, 960);
+        m_steppedUp = false;
+
+        return setLevel(m_level + 1);
+    }
+
+    if( m_avg < m_budget/2 && m_level > LEVEL_FULL ) {
+        if( ++m_headroom < m_upDelay ) return false;
+
+        m_steppedUp = true;
+        return setLevel(m_level - 1);
+    }
+
+    m_headroom = 0;
+    return false;
+}
+
+bool QQualityGovernor::settle(void)
+{
+    m_upDelay   = 30;
+    m_steppedUp = false;
+
+    return setLevel(LEVEL_FULL);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+///
+/// \brief Index of a readout char in QInstrumentResources::glyphs
+///
+static int glyphIndex(char c)
+{
+    if( c >= '0' && c <= '9' ) return c - '0';
+    if( c == '.' ) return 10;
+    if( c == '-' ) return 11;
+    return 12;
+}
+
+///
+/// \brief Create a static text prepared for a font
+///
+static QStaticText makeStaticText(const QString &s, const QFont &font)
+{
+    QStaticText st(s);
+
+    st.setTextFormat(Qt::PlainText);
+    st.setPerformanceHint(QStaticText::AggressiveCaching);
+    st.prepare(QTransform(), font);
+
+    return st;
+}
 
-        painter.setBrush(bgGround);
-        painter.drawChord(-m_size/2, -m_size/2, m_size, m_size,
-                          gr*16, -(180+2*gr)*16);
+QInstrumentResources::QInstrumentResources(int s)
+{
+    int     offset = 2;                         // m_offset of QADI/QCompass
+
+    size = s;
+
+    // pens & brushes
+    blackPen     = QPen(Qt::black, 2);
+    blackPen1    = QPen(Qt::black, 1);
+    whitePen1    = QPen(Qt::white, 1);
+    pitchPen     = QPen(Qt::white, 2);
+    pitchZeroPen = QPen(Qt::green, 3);
+    bluePen      = QPen(Qt::blue,  2);
+    redPen       = QPen(Qt::red,   2);
+
+    skyBrush       = QBrush(QColor(48,172,220));
+    groundBrush    = QBrush(QColor(247,168,21));
+    compassBrush   = QBrush(QColor(48,172,220));
+    redBrush       = QBrush(Qt::red);
+    blueBrush      = QBrush(Qt::blue);
+    blackBrush     = QBrush(Qt::black);
+    whiteBrush     = QBrush(Qt::white);
+    yawMarkerBrush = QBrush(QColor(0xFF, 0x00, 0x00, 0xE0));
+
+    labelFont = QFont("", 8);
+    dirFont   = QFont("", 10);
+    altFont   = QFont("", 13);
+
+    // fixed labels
+    for(int i=-9; i<=9; i++)
+        pitchLabels[i+9] = makeStaticText(QString::number(-i*10), labelFont);
+
+    for(int i=0; i<36; i++) {
+        rollLabels[i] = makeStaticText(QString::number(i < 18 ? -i*10 : 360-i*10),
+                                       labelFont);
+
+        if     ( i == 0  ) yawLabels[i] = makeStaticText("N", dirFont);
+        else if( i == 9  ) yawLabels[i] = makeStaticText("W", dirFont);
+        else if( i == 18 ) yawLabels[i] = makeStaticText("S", dirFont);
+        else if( i == 27 ) yawLabels[i] = makeStaticText("E", dirFont);
+        else               yawLabels[i] = makeStaticText(QString::number(i*10), labelFont);
     }
 
-    // set mask
-    QRegion maskRegion(-m_size/2, -m_size/2, m_size, m_size, QRegion::Ellipse);
-    painter.setClipRegion(maskRegion);
+    // readout glyphs, digits get a common (tabular) advance
+    {
+        QFontMetricsF   fm(altFont);
+        const char      *gs = "0123456789.- ";
+
+        glyphWidth = 0;
+        for(int i=0; i<10; i++) glyphWidth = qMax(glyphWidth, fm.width(QChar(gs[i])));
+
+        for(int i=0; i<13; i++)
+            glyphs[i] = makeStaticText(QString(QChar(gs[i])), altFont);
 
+        altPrefix  = makeStaticText("ALT:", altFont);
+        hPrefix    = makeStaticText("H:",   altFont);
+        unitSuffix = makeStaticText("m",    altFont);
+    }
 
-    // draw pitch lines & marker
+    // ADI geometry
     {
-        int x, y, x1, y1;
-        int textWidth;
-        double p, r;
-        int ll = m_size/8, l;
+        int     markerSize = s/20;
+        int     rollMarkerSize = s/25;
+        double  fy1 = -s/2 + offset;
+
+        adiClip.addEllipse(-s/2, -s/2, s, s);
+
+        adiMarkerR << QPointF(markerSize, 0)
+                   << QPointF(2*markerSize, -markerSize/2)
+                   << QPointF(2*markerSize,  markerSize/2);
+        adiMarkerL << QPointF(-markerSize, 0)
+                   << QPointF(-2*markerSize, -markerSize/2)
+                   << QPointF(-2*markerSize,  markerSize/2);
+
+        rollMarker << QPointF(0, fy1)
+                   << QPointF(-rollMarkerSize/2, fy1 + rollMarkerSize)
+                   << QPointF( rollMarkerSize/2, fy1 + rollMarkerSize);
+    }
 
-        int     fontSize = 8;
-        QString s;
+    // compass geometry
+    {
+        int     yawMarkerSize = s/12;
+        double  fy1 = -s/2 + offset;
+        int     w = 130, h = 2*(13 + 8);
 
-        pitchPen.setWidth(2);
-        painter.setFont(QFont("", fontSize));
+        yawMarker << QPointF(0, fy1)
+                  << QPointF(-yawMarkerSize/2, fy1 + yawMarkerSize)
+                  << QPointF( yawMarkerSize/2, fy1 + yawMarkerSize);
 
+        altBox  = QRectF(-w/2, -h/2,       w, h);
+        altRect = QRectF(-w/2, -h/2 + 2,   w, h/2);
+        hRect   = QRectF(-w/2, -h/2 + h/2, w, h/2);
+    }
+}
 
-        // draw lines
-        for(int i=-9; i<=9; i++) {
-            p = i*10;
+///
+/// \brief Process-wide resource sets, referenced ones & a few idle ones
+///
+struct QInstrumentResourceCache
+{
+    struct Entry {
+        QInstrumentResources    *res;
+        int                     refs;
+
+        Entry() : res(NULL), refs(0) {}
+    };
+
+    enum { MAX_IDLE = 8 };                      ///< unreferenced sets kept
+
+    QMutex                  mutex;
+    QHash<int, Entry>       entries;
+    QList<int>              idle;               ///< unreferenced sizes, oldest first
+};
+
+static QInstrumentResourceCache& resourceCache(void)
+{
+    static QInstrumentResourceCache cache;
+    return cache;
+}
+
+const QInstrumentResources* QInstrumentResources::get(int size)
+{
+    QInstrumentResourceCache    &c = resourceCache();
+    QMutexLocker                locker(&c.mutex);
+
+    QInstrumentResourceCache::Entry &e = c.entries[size];
+    if( !e.res ) e.res = new QInstrumentResources(size);
+
+    if( e.refs++ == 0 ) c.idle.removeOne(size);
+
+    return e.res;
+}
+
+void QInstrumentResources::release(const QInstrumentResources *res)
+{
+    if( !res ) return;
+
+    QInstrumentResourceCache    &c = resourceCache();
+    QMutexLocker                locker(&c.mutex);
+
+    QInstrumentResourceCache::Entry &e = c.entries[res->size];
+    if( e.res != res || --e.refs > 0 ) return;
+
+    // keep the last few sizes (e.g. while a window is resized back and forth)
+    c.idle.append(res->size);
+
+    while( c.idle.size() > QInstrumentResourceCache::MAX_IDLE ) {
+        int s = c.idle.takeFirst();
+
+        delete c.entries[s].res;
+        c.entries.remove(s);
+    }
+}
+
+QInstrumentResources* QInstrumentResources::create(int size)
+{
+    return new QInstrumentResources(size);
+}
+
+int QInstrumentResources::formatFixed(char *buf, double v, int width, int prec)
+{
+    static const double scale[7] = { 1, 10, 100, 1e3, 1e4, 1e5, 1e6 };
+
+    char    tmp[32];
+    int     n = 0, len = 0;
+    bool    neg = v < 0;
+    double  a = neg ? -v : v;
+    quint64 q;
+
+    if( prec < 0 )   prec  = 0;
+    if( prec > 6 )   prec  = 6;
+    if( width > 30 ) width = 30;
+
+    if( qIsNaN(v) ) {
+        while( len < width - 3 ) buf[len++] = ' ';
+        buf[len++] = 'n'; buf[len++] = 'a'; buf[len++] = 'n';
+        buf[len] = 0;
+        return len;
+    }
+
+    if( a > 1e12 ) a = 1e12;
+    q = (quint64) (a*scale[prec] + 0.5);
+
+    // digits in reverse order
+    for(int i=0; i<prec; i++) {
+        tmp[n++] = '0' + q % 10;
+        q /= 10;
+    }
+    if( prec > 0 ) tmp[n++] = '.';
+    do {
+        tmp[n++] = '0' + q % 10;
+        q /= 10;
+    } while( q );
+    if( neg ) tmp[n++] = '-';
+
+    while( len < width - n ) buf[len++] = ' ';
+    while( n > 0 ) buf[len++] = tmp[--n];
+    buf[len] = 0;
+
+    return len;
+}
+
+void QInstrumentResources::drawText(QPainter &painter, const QRectF &rc, int flags,
+                                    const QStaticText &st) const
+{
+    QSizeF  sz = st.size();
+    qreal   x, y;
+
+    if     ( flags & Qt::AlignRight )   x = rc.right() - sz.width();
+    else if( flags & Qt::AlignHCenter ) x = rc.center().x() - sz.width()/2;
+    else                                x = rc.left();
+
+    if     ( flags & Qt::AlignBottom )  y = rc.bottom() - sz.height();
+    else if( flags & Qt::AlignVCenter ) y = rc.center().y() - sz.height()/2;
+    else                                y = rc.top();
+
+    painter.drawStaticText(QPointF(x, y), st);
+}
+
+void QInstrumentResources::drawReadout(QPainter &painter, const QRectF &rc,
+                                       const QStaticText &prefix, double v) const
+{
+    char    buf[32];
+    int     n = formatFixed(buf, v, 6, 1);
+    qreal   adv[13];
+    qreal   w, x, y;
+
+    // '.' & '-' keep their own advance, digits & blanks the tabular one
+    for(int i=0; i<13; i++)
+        adv[i] = (i == 10 || i == 11) ? glyphs[i].size().width() : glyphWidth;
+
+    w = prefix.size().width() + 2*glyphWidth + unitSuffix.size().width();
+    for(int i=0; i<n; i++)
+        w += adv[glyphIndex(buf[i])];
+
+    x = rc.center().x() - w/2;
+    y = rc.center().y() - prefix.size().height()/2;
+
+    painter.drawStaticText(QPointF(x, y), prefix);
+    x += prefix.size().width() + glyphWidth;
+
+    for(int i=0; i<n; i++) {
+        int g = glyphIndex(buf[i]);
+
+        if( g != 12 )
+            painter.drawStaticText(QPointF(x + (adv[g] - glyphs[g].size().width())/2, y),
+                                   glyphs[g]);
+        x += adv[g];
+    }
+
+    x += glyphWidth;
+    painter.drawStaticText(QPointF(x, y), unitSuffix);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QArtworkCache::QArtworkCache()
+{
+    m_cache.setMaxCost(32*1024*1024);
+
+    m_hits      = 0;
+    m_misses    = 0;
+    m_evictions = 0;
+}
+
+QArtworkCache* QArtworkCache::instance(void)
+{
+    static QArtworkCache cache;
+
+    return &cache;
+}
+
+bool QArtworkCache::find(Kind kind, int size, qreal dpr, int style, QImage &img)
+{
+    Key         key = { kind, size, style, dpr };
+    QMutexLocker locker(&m_mutex);
+
+    // object() also moves the entry to the front of the LRU list
+    QImage *p = m_cache.object(key);
+    if( !p ) {
+        m_misses++;
+        return false;
+    }
+
+    m_hits++;
+    img = *p;
+
+    return true;
+}
+
+void QArtworkCache::insert(Kind kind, int size, qreal dpr, int style, const QImage &img)
+{
+    Key         key = { kind, size, style, dpr };
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    int         cost = (int) img.sizeInBytes();
+#else
+    int         cost = img.byteCount();
+#endif
+    QMutexLocker locker(&m_mutex);
+
+    // entries pushed out by this one (a layer over the budget is not kept)
+    int n = m_cache.count() + (m_cache.contains(key) ? 0 : 1);
+
+    m_cache.insert(key, new QImage(img), cost);
+    m_evictions += n - m_cache.count();
+}
+
+void QArtworkCache::setBudget(int bytes)
+{
+    QMutexLocker locker(&m_mutex);
+
+    int n = m_cache.count();
+
+    m_cache.setMaxCost(qMax(bytes, 0));
+    m_evictions += n - m_cache.count();
+}
+
+int QArtworkCache::getBudget(void)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.maxCost();
+}
+
+int QArtworkCache::getBytes(void)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.totalCost();
+}
+
+int QArtworkCache::getCount(void)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.count();
+}
+
+quint64 QArtworkCache::getHits(void)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+quint64 QArtworkCache::getMisses(void)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+quint64 QArtworkCache::getEvictions(void)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_evictions;
+}
+
+void QArtworkCache::clear(void)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_cache.clear();
+    m_hits      = 0;
+    m_misses    = 0;
+    m_evictions = 0;
+}
+
+///
+/// \brief QArtworkCache::Style of layers painted at a quality level
+///
+static int artworkStyle(bool aa, int quality)
+{
+    return (aa ? QArtworkCache::STYLE_AA : 0) |
+           (quality < QQualityGovernor::LEVEL_NO_MINOR ? QArtworkCache::STYLE_MINOR : 0);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QADIRenderer::QADIRenderer(bool sharedResources)
+{
+    m_size   = 0;
+    m_offset = 2;
+    m_dpr    = 1.0;
+
+    m_antialiasing = true;
+    m_quality      = QQualityGovernor::LEVEL_FULL;
+
+    m_shared    = sharedResources;
+    m_res       = NULL;
+    m_layerSize = 0;
+    m_layerDpr  = 0;
+
+    m_discValid = false;
+    m_discRoll  = 0;
+    m_discY     = 0;
+}
+
+QADIRenderer::~QADIRenderer()
+{
+    if( m_shared ) QInstrumentResources::release(m_res);
+    else           delete m_res;
+}
+
+void QADIRenderer::setSize(int size, qreal dpr)
+{
+    if( size != m_size || m_res == NULL ) {
+        if( m_shared ) {
+            const QInstrumentResources *old = m_res;
+
+            m_res = QInstrumentResources::get(size);
+            QInstrumentResources::release(old);
+        } else {
+            delete m_res;
+            m_res = QInstrumentResources::create(size);
+        }
+    }
+
+    m_size = size;
+    m_dpr  = dpr;
+}
+
+void QADIRenderer::setAntialiasing(bool aa)
+{
+    m_antialiasing = aa;
+    m_layerSize = 0;
+}
+
+void QADIRenderer::setQuality(int level)
+{
+    if( level == m_quality ) return;
+
+    m_quality   = level;
+    m_layerSize = 0;
+}
+
+void QADIRenderer::renderImage(QImage &img, double roll, double pitch)
+{
+    int     s  = getImageSize();
+    int     px = qCeil(s*m_dpr);
+
+    if( img.width() != px || img.height() != px ||
+        img.format() != QImage::Format_ARGB32_Premultiplied ) {
+        img = makeLayer(s, s, m_dpr);
+    } else {
+        img.fill(Qt::transparent);
+    }
+
+    QPainter painter(&img);
+    painter.translate(s / 2, s / 2);
+
+    render(painter, roll, pitch);
+}
+
+const QImage& QADIRenderer::getLadderLayer(void)
+{
+    if( m_layerSize != m_size || m_layerDpr != layerDpr() )
+        buildLayers();
+
+    return m_ladderLayer;
+}
+
+const QImage& QADIRenderer::getRollLayer(void)
+{
+    if( m_layerSize != m_size || m_layerDpr != layerDpr() )
+        buildLayers();
+
+    return m_rollLayer;
+}
+
+void QADIRenderer::buildLayers(void)
+{
+    qreal   dpr   = layerDpr();
+    bool    aa    = getEffectiveAntialiasing();
+    bool    minor = m_quality < QQualityGovernor::LEVEL_NO_MINOR;
+    int     r     = m_size/2;
+    int     style = artworkStyle(aa, m_quality);
+
+    QArtworkCache *cache = QArtworkCache::instance();
+
+    // sky/ground disc, filled per attitude in render() (own copy per renderer)
+    {
+        int ls = m_size + 2*m_offset;
+
+        m_discLayer = makeLayer(ls, ls, dpr);
+        m_discValid = false;
+    }
+
+    // pitch ladder strip, zero line at the middle row
+    //  (+-90 deg is +-m_size, plus one radius of margin on each side)
+    if( !cache->find(QArtworkCache::ADI_LADDER, m_size, dpr, style, m_ladderLayer) ) {
+        int     x, y, x1, y1;
+        int     textWidth;
+        double  p;
+        int     ll = m_size/8, l;
+        int     cy = 3*m_size/2;
+
+        int     fontSize = 8;
+
+        QVector<QLineF> lines;
+        QLineF          zeroLine;
+
+        m_ladderLayer = makeLayer(m_size, 3*m_size, dpr);
+
+        QPainter painter(&m_ladderLayer);
+        painter.setRenderHint(QPainter::Antialiasing, aa);
+        painter.translate(r, cy);
+        painter.setFont(m_res->labelFont);
+
+        // lines: the zero line has its own pen, all others go in one batch
+        lines.reserve(18);
+
+        for(int i=-9; i<=9; i++) {
+            if( !minor && i % 3 != 0 ) continue;
+
+            p = i*10;
+            l = (i % 3 == 0) ? ll : ll/2;
+            y = r*p/45.0;
+
+            if( i == 0 ) {
+                l = l * 1.8;
+                zeroLine = QLineF(-l, 1.0*y, l, 1.0*y);
+            } else {
+                lines.append(QLineF(-l, 1.0*y, l, 1.0*y));
+            }
+        }
+
+        painter.setPen(m_res->pitchPen);
+        painter.drawLines(lines);
+        painter.setPen(m_res->pitchZeroPen);
+        painter.drawLine(zeroLine);
+
+        // labels on the long lines
+        textWidth = 100;
+        painter.setPen(m_res->whitePen1);
+
+        for(int i=-9; i<=9 && minor; i+=3) {
+            if( i == 0 ) continue;
+
+            x  = ll;
+            y  = r*i*10/45.0;
+            x1 = -x-2-textWidth;
+            y1 = y - fontSize/2 - 1;
+            m_res->drawText(painter, QRectF(x1, y1, textWidth, fontSize+2),
+                            Qt::AlignRight|Qt::AlignVCenter,
+                            m_res->pitchLabels[i+9]);
+        }
+
+        painter.end();
+        cache->insert(QArtworkCache::ADI_LADDER, m_size, dpr, style, m_ladderLayer);
+    }
+
+    // roll ring: rim, degree lines & labels
+    if( !cache->find(QArtworkCache::ADI_ROLL, m_size, dpr, style, m_rollLayer) ) {
+        int             rollLineLeng = m_size/25;
+        double          fy1 = -r + m_offset;
+        int             fontSize = 8;
+        int             ls = m_size + 2*m_offset;
+        QVector<QLineF> ticks;
+
+        m_rollLayer = makeLayer(ls, ls, dpr);
+
+        QPainter painter(&m_rollLayer);
+        painter.setRenderHint(QPainter::Antialiasing, aa);
+        painter.translate(ls/2.0, ls/2.0);
+
+        painter.setPen(m_res->blackPen);
+        painter.setBrush(Qt::NoBrush);
+        painter.drawEllipse(-r, -r, m_size, m_size);
+
+        // all 36 ticks in one batch
+        ticks.reserve(36);
+        for(int i=0; i<36; i++)
+            if( minor || i % 3 == 0 )
+                ticks.append(ringTick(i, -fy1, (i % 3 == 0) ? rollLineLeng : rollLineLeng/2, 1));
+
+        painter.setPen(m_res->blackPen1);
+        painter.drawLines(ticks);
+
+        // labels every 30 deg, upright along the ring
+        QTransform base = painter.transform();
+
+        painter.setFont(m_res->labelFont);
+        for(int i=0; i<36 && minor; i+=3) {
+            painter.setTransform(ringTransform(i, 1, base));
+            m_res->drawText(painter, QRectF(-50, fy1 + rollLineLeng+2, 100, fontSize+2),
+                            Qt::AlignCenter, m_res->rollLabels[i]);
+        }
+
+        painter.end();
+        cache->insert(QArtworkCache::ADI_ROLL, m_size, dpr, style, m_rollLayer);
+    }
+
+    m_layerSize = m_size;
+    m_layerDpr  = dpr;
+}
+
+void QADIRenderer::render(QPainter &painter, double roll, double pitch)
+{
+    if( m_layerSize != m_size || m_layerDpr != layerDpr() )
+        buildLayers();
+
+    int     r  = m_size/2;
+    bool    aa = getEffectiveAntialiasing();
+
+    painter.setRenderHint(QPainter::Antialiasing, aa);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, aa);
+
+    // draw background (rasterized directly, only when the attitude changed)
+    {
+        int ls = m_size + 2*m_offset;
+        int y_max = r*40.0/45.0;
+
+        // FIXME: AHRS output left-hand values
+        int y = r*pitch/45.;
+        if( y < -y_max ) y = -y_max;
+        if( y >  y_max ) y =  y_max;
+
+        if( !m_discValid || roll != m_discRoll || y != m_discY ) {
+            DiscRaster  p;
+            double      a = roll*M_PI/180.0;
+            QColor      sky = m_res->skyBrush.color(), ground = m_res->groundBrush.color();
+            QColor      line = m_res->blackPen.color();
+
+            p.cx = p.cy = ls*m_layerDpr/2;
+            p.r         = r*m_layerDpr;
+            p.nx        = -sin(a);
+            p.ny        =  cos(a);
+            p.off       = y*m_layerDpr;
+            p.lineHalf  = m_res->blackPen.widthF()/2*m_layerDpr;
+            p.edge      = aa ? 1.0f : 1e6f;
+
+            p.sky[0]    = sky.red();    p.sky[1]    = sky.green();    p.sky[2]    = sky.blue();
+            p.ground[0] = ground.red(); p.ground[1] = ground.green(); p.ground[2] = ground.blue();
+            p.line[0]   = line.red();   p.line[1]   = line.green();   p.line[2]   = line.blue();
+
+            rasterDisc(m_discLayer, p);
+
+            m_discValid = true;
+            m_discRoll  = roll;
+            m_discY     = y;
+        }
+
+        painter.drawImage(QPointF(-ls/2.0, -ls/2.0), m_discLayer);
+    }
+
+    painter.rotate(roll);
+
+    // draw pitch lines (clipped to the disc)
+    {
+        // only the strip rows within one radius of the center can be visible
+        double  y0 = r*pitch/45.0 - 3*m_size/2;
+        int     ly0 = qBound(0, (int) floor(-r - y0), 2*m_size);
+        int     lh  = qMin(m_size + 2, 3*m_size - ly0);
+
+        painter.setClipPath(m_res->adiClip);
+
+        painter.drawImage(QRectF(-r, y0 + ly0, m_size, lh), m_ladderLayer,
+                          QRectF(0, ly0*m_layerDpr, m_size*m_layerDpr, lh*m_layerDpr));
+
+        painter.setClipping(false);
+    }
+
+    // draw rim & roll degree lines
+    {
+        int ls = m_size + 2*m_offset;
+        painter.drawImage(QPointF(-ls/2.0, -ls/2.0), m_rollLayer);
+    }
+
+    // draw marker
+    {
+        painter.setBrush(m_res->redBrush);
+        painter.setPen(Qt::NoPen);
+
+        painter.drawPolygon(m_res->adiMarkerR);
+        painter.drawPolygon(m_res->adiMarkerL);
+    }
+
+    // draw roll marker
+    {
+        painter.rotate(-roll);
+        painter.setPen(m_res->blackPen1);
+        painter.setBrush(m_res->blackBrush);
+
+        painter.drawPolygon(m_res->rollMarker);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QADI::QADI(QWidget *parent)
+    : QWidget(parent)
+{
+    m_sizeMin = 200;
+    m_sizeMax = 600;
+    m_offset = 2;
+    m_size = m_sizeMin - 2*m_offset;
+
+    setMinimumSize(m_sizeMin, m_sizeMin);
+    setMaximumSize(m_sizeMax, m_sizeMax);
+    resize(m_sizeMin, m_sizeMin);
+
+    setFocusPolicy(Qt::NoFocus);
+
+    m_roll  = 0.0;
+    m_pitch = 0.0;
+
+    m_rollCh    = QSampleChannel(360);
+    m_latency   = 0;
+    m_maxExtrap = 100000000;
+
+    QInstrumentScheduler::instance()->registerWidget(this);
+
+    m_renderer.setSize(m_size);
+    m_job = NULL;
+
+    m_stats = NULL;
+    m_hud   = false;
+
+    m_settleTimer = new QTimer(this);
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(QQualityGovernor::settleTime());
+    connect(m_settleTimer, SIGNAL(timeout(void)), this, SLOT(settle_slot(void)));
+
+    m_hudTimer = new QTimer(this);
+    m_hudTimer->setSingleShot(true);
+    m_hudTimer->setTimerType(Qt::PreciseTimer);
+    m_hudTimer->setInterval(1000);
+    connect(m_hudTimer, SIGNAL(timeout(void)), this, SLOT(hudRefresh_slot(void)));
+}
+
+QADI::~QADI()
+{
+    // do not re-create the scheduler if it went away with the application
+    if( QInstrumentScheduler::existingInstance() )
+        QInstrumentScheduler::existingInstance()->unregisterWidget(this);
+
+    // stop the render thread from using the job before it is destroyed
+    if( m_job ) {
+        m_job->cancel();
+        delete m_job;
+        m_job = NULL;
+    }
+
+    delete m_stats;
+}
+
+
+void QADI::canvasReplot_slot(void)
+{
+    markDirty();
+}
+
+void QADI::frameReady_slot(void)
+{
+    markDirty();
+}
+
+void QADI::settle_slot(void)
+{
+    if( m_governor.settle() ) {
+        m_renderer.setQuality(QQualityGovernor::LEVEL_FULL);
+        markDirty();
+    }
+}
+
+void QADI::hudRefresh_slot(void)
+{
+    if( m_hud ) markDirty();
+}
+
+void QADI::setThreadedRendering(bool on)
+{
+    if( on == (m_job != NULL) ) return;
+
+    if( on && !QFontDatabase::supportsThreadedFontRendering() ) {
+        qWarning("threaded rendering is not supported on this platform");
+        return;
+    }
+
+    if( on ) {
+        m_job = new QADIRenderJob(this);
+        connect(m_job, SIGNAL(frameReady(void)), this, SLOT(frameReady_slot(void)));
+    } else {
+        m_job->cancel();
+        delete m_job;
+        m_job = NULL;
+    }
+
+    markDirty();
+}
+
+void QADI::setStatsEnabled(bool on)
+{
+    if( on == (m_stats != NULL) ) return;
+
+    if( on ) {
+        m_stats = new QPaintStats();
+    } else {
+        delete m_stats;
+        m_stats = NULL;
+        m_hud   = false;
+    }
+
+    markDirty();
+}
+
+void QADI::setHudVisible(bool on)
+{
+    if( on ) setStatsEnabled(true);
+
+    m_hud = on;
+    markDirty();
+}
+
+void QADI::setFrameBudget(double ms)
+{
+    m_governor.setBudget(ms);
+    m_renderer.setQuality(m_governor.getLevel());
+
+    markDirty();
+}
+
+void QADI::governQuality(qint64 ns)
+{
+    if( m_governor.addPaint(ns) ) {
+        m_renderer.setQuality(m_governor.getLevel());
+        markDirty();
+    }
+
+    // full quality again once nothing was painted for a while
+    if( m_governor.getLevel() > QQualityGovernor::LEVEL_FULL )
+        m_settleTimer->start();
+}
+
+
+void QADI::resizeEvent(QResizeEvent *event)
+{
+    m_size = qMin(width(),height()) - 2*m_offset;
+
+    m_renderer.setSize(m_size, widgetDpr(this));
+}
+
+void QADI::paintEvent(QPaintEvent *)
+{
+    qint64  t0 = m_stats || m_governor.isEnabled() ? QTelemetryQueue::now() : 0;
+
+    m_renderer.setSize(m_size, widgetDpr(this));
+
+    QPainter painter(this);
+
+    double  roll = m_roll, pitch = m_pitch;
+
+    // timestamped samples: value at the presentation time
+    if( !m_rollCh.isEmpty() || !m_pitchCh.isEmpty() ) {
+        qint64  tp = QTelemetryQueue::now() + m_latency;
+        bool    moving = false;
+
+        if( !m_rollCh.isEmpty() ) {
+            // circular: +179 -> -179 passes through 180, not through 0
+            roll = m_rollCh.value(tp, m_maxExtrap);
+            if( roll > 180 ) roll -= 360;
+            roll = qBound(-180.0, roll, 180.0);
+            moving |= tp < m_rollCh.lastTime() + m_maxExtrap;
+        }
+        if( !m_pitchCh.isEmpty() ) {
+            pitch = qBound(-90.0, m_pitchCh.value(tp, m_maxExtrap), 90.0);
+            moving |= tp < m_pitchCh.lastTime() + m_maxExtrap;
+        }
+
+        // keep animating until the extrapolation window has passed
+        if( moving ) markDirty();
+    }
+
+    // threaded: show the newest completed frame, render the next one
+    if( m_job ) {
+        double  v[4] = { roll, pitch, m_renderer.getAntialiasing() ? 1.0 : 0.0,
+                         (double) m_governor.getLevel() };
+
+        m_job->request(m_size, widgetDpr(this), v, 4);
+
+        // the governor watches the render thread, blitting costs nothing
+        if( m_job->fetch() && m_governor.isEnabled() )
+            governQuality(m_job->getRenderTime());
+
+        const QImage &img = m_job->frame();
+        if( !img.isNull() ) {
+            int s = qRound(img.width() / img.devicePixelRatio());
+            painter.drawImage(QPoint(width() / 2 - s / 2, height() / 2 - s / 2), img);
+        }
+    } else {
+        painter.translate(width() / 2, height() / 2);
+        m_renderer.render(painter, roll, pitch);
+
+        if( m_governor.isEnabled() ) governQuality(QTelemetryQueue::now() - t0);
+    }
+
+    if( m_stats ) {
+        m_stats->addPaint(t0, QTelemetryQueue::now());
+
+        if( m_hud ) {
+            painter.resetTransform();
+            m_stats->drawHud(painter);
+
+            // show the rate drop to 0 if no paint follows within a second
+            if( m_stats->getFps() > 0 ) m_hudTimer->start();
+        }
+    }
+}
+
+void QADI::keyPressEvent(QKeyEvent *event)
+{
+    switch (event->key()) {
+    case Qt::Key_Left:
+        m_roll -= 1.0;
+        break;
+    case Qt::Key_Right:
+        m_roll += 1.0;
+        break;
+    case Qt::Key_Down:
+        if(m_pitch>-90.)
+            m_pitch -=1.0;
+        break;
+    case Qt::Key_Up:
+        if(m_pitch<90.)
+            m_pitch +=1.0;
+        break;
+    default:
+        QWidget::keyPressEvent(event);
+        return;
+    }
+
+    markDirty();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QCompassRenderer::QCompassRenderer(bool sharedResources)
+{
+    m_size   = 0;
+    m_offset = 2;
+    m_dpr    = 1.0;
+
+    m_antialiasing = true;
+    m_quality      = QQualityGovernor::LEVEL_FULL;
+
+    m_shared   = sharedResources;
+    m_res      = NULL;
+    m_dialSize = 0;
+    m_dialDpr  = 0;
+
+    m_mode     = NORTH_UP;
+    m_filter   = FILTER_SMOOTH;
+    m_cardSize = 0;
+    m_cardDpr  = 0;
+
+    m_courseOn  = false;
+    m_bearingOn = false;
+    m_course    = 0;
+    m_dev       = 0;
+    m_bearing   = 0;
+}
+
+QCompassRenderer::~QCompassRenderer()
+{
+    if( m_shared ) QInstrumentResources::release(m_res);
+    else           delete m_res;
+}
+
+void QCompassRenderer::setSize(int size, qreal dpr)
+{
+    if( size != m_size || m_res == NULL ) {
+        if( m_shared ) {
+            const QInstrumentResources *old = m_res;
+
+            m_res = QInstrumentResources::get(size);
+            QInstrumentResources::release(old);
+        } else {
+            delete m_res;
+            m_res = QInstrumentResources::create(size);
+        }
+    }
+
+    m_size = size;
+    m_dpr  = dpr;
+}
+
+void QCompassRenderer::setAntialiasing(bool aa)
+{
+    m_antialiasing = aa;
+    m_dialSize = 0;
+    m_cardSize = 0;
+}
+
+void QCompassRenderer::setQuality(int level)
+{
+    if( level == m_quality ) return;
+
+    m_quality  = level;
+    m_dialSize = 0;
+    m_cardSize = 0;
+}
+
+void QCompassRenderer::setCardFilter(CardFilter filter)
+{
+    if( filter == m_filter ) return;
+
+    // FILTER_HIGH needs a card of twice the resolution
+    if( (filter == FILTER_HIGH) != (m_filter == FILTER_HIGH) ) m_cardSize = 0;
+
+    m_filter = filter;
+}
+
+void QCompassRenderer::paintCard(QPainter &painter)
+{
+    // draw background
+    {
+        painter.setPen(m_res->blackPen);
+        painter.setBrush(m_res->compassBrush);
+
+        painter.drawEllipse(-m_size/2, -m_size/2, m_size, m_size);
+    }
+
+
+    // draw yaw lines
+    {
+        int             yawLineLeng = m_size/25;
+        double          fy1 = -m_size/2 + m_offset;
+        int             fontSize = 8;
+        bool            minor = m_quality < QQualityGovernor::LEVEL_NO_MINOR;
+        QVector<QLineF> ticks;
+        QTransform      base = painter.transform();
+
+        // N (blue) & S (red) have their own pens, the other 34 ticks are one batch
+        ticks.reserve(34);
+        for(int i=0; i<36; i++) {
+            if( i == 0 || i == 18 ) continue;
+            if( !minor && i % 3 != 0 ) continue;
+            ticks.append(ringTick(i, -fy1, (i % 3 == 0) ? yawLineLeng : yawLineLeng/2, -1));
+        }
+
+        painter.setPen(m_res->blackPen1);
+        painter.drawLines(ticks);
+        painter.setPen(m_res->bluePen);
+        painter.drawLine(ringTick(0, -fy1, yawLineLeng, -1));
+        painter.setPen(m_res->redPen);
+        painter.drawLine(ringTick(18, -fy1, yawLineLeng, -1));
+
+        // labels every 30 deg, cardinal points in the direction font
+        for(int i=0; i<36; i+=3) {
+            if( !minor && i % 9 != 0 ) continue;
+
+            if     ( i == 0  ) painter.setPen(m_res->bluePen);
+            else if( i == 18 ) painter.setPen(m_res->redPen);
+            else               painter.setPen(m_res->blackPen1);
+
+            painter.setFont(i % 9 == 0 ? m_res->dirFont : m_res->labelFont);
+            painter.setTransform(ringTransform(i, -1, base));
+            m_res->drawText(painter, QRectF(-50, fy1 + yawLineLeng+4, 100, fontSize+2),
+                            Qt::AlignCenter, m_res->yawLabels[i]);
+        }
+
+        painter.setTransform(base);
+    }
+}
+
+void QCompassRenderer::buildDial(void)
+{
+    qreal   dpr   = layerDpr();
+    int     ls    = m_size + 2*m_offset;
+    int     style = artworkStyle(getEffectiveAntialiasing(), m_quality);
+
+    QArtworkCache *cache = QArtworkCache::instance();
+
+    m_dialSize = m_size;
+    m_dialDpr  = dpr;
+
+    // another compass of this size painted it already
+    if( cache->find(QArtworkCache::COMPASS_DIAL, m_size, dpr, style, m_dialLayer) ) return;
+
+    m_dialLayer = makeLayer(ls, ls, dpr);
+
+    QPainter painter(&m_dialLayer);
+
+    painter.setRenderHint(QPainter::Antialiasing, getEffectiveAntialiasing());
+
+    painter.translate(ls/2.0, ls/2.0);
+
+    paintCard(painter);
+
+    // draw S/N arrow
+    {
+        int     arrowWidth = m_size/5;
+        double  fx1, fy1, fx2, fy2, fx3, fy3;
+
+        fx1 = 0;
+        fy1 = -m_size/2 + m_offset + m_size/25 + 15;
+        fx2 = -arrowWidth/2;
+        fy2 = 0;
+        fx3 = arrowWidth/2;
+        fy3 = 0;
+
+        painter.setPen(Qt::NoPen);
+
+        painter.setBrush(m_res->blueBrush);
+        QPointF pointsN[3] = {
+            QPointF(fx1, fy1),
+            QPointF(fx2, fy2),
+            QPointF(fx3, fy3)
+        };
+        painter.drawPolygon(pointsN, 3);
+
+
+        fx1 = 0;
+        fy1 = m_size/2 - m_offset - m_size/25 - 15;
+        fx2 = -arrowWidth/2;
+        fy2 = 0;
+        fx3 = arrowWidth/2;
+        fy3 = 0;
+
+        painter.setBrush(m_res->redBrush);
+        QPointF pointsS[3] = {
+            QPointF(fx1, fy1),
+            QPointF(fx2, fy2),
+            QPointF(fx3, fy3)
+        };
+        painter.drawPolygon(pointsS, 3);
+    }
+
+    // draw altitude box
+    {
+        painter.setPen(m_res->blackPen);
+        painter.setBrush(m_res->whiteBrush);
+
+        painter.drawRoundedRect(m_res->altBox, 6, 6);
+    }
+
+    painter.end();
+    cache->insert(QArtworkCache::COMPASS_DIAL, m_size, dpr, style, m_dialLayer);
+}
+
+void QCompassRenderer::buildCard(void)
+{
+    int     ls    = m_size + 2*m_offset;
+    int     r     = m_size/2;
+    qreal   dpr   = layerDpr();
+    qreal   cdpr  = m_filter == FILTER_HIGH ? 2*dpr : dpr;
+    int     style = artworkStyle(getEffectiveAntialiasing(), m_quality);
+
+    QArtworkCache *cache = QArtworkCache::instance();
+
+    // the card only turns, so all of its ticks & labels are drawn once here
+    if( !cache->find(QArtworkCache::COMPASS_CARD, m_size, cdpr, style, m_cardLayer) ) {
+        m_cardLayer = makeLayer(ls, ls, cdpr);
+
+        QPainter painter(&m_cardLayer);
+        painter.setRenderHint(QPainter::Antialiasing, getEffectiveAntialiasing());
+        painter.translate(ls/2.0, ls/2.0);
+
+        paintCard(painter);
+
+        painter.end();
+        cache->insert(QArtworkCache::COMPASS_CARD, m_size, cdpr, style, m_cardLayer);
+    }
+
+    // fixed parts: lubber line, aircraft symbol & ALT/H box (no ticks or labels)
+    style &= QArtworkCache::STYLE_AA;
+
+    if( !cache->find(QArtworkCache::COMPASS_HSI, m_size, dpr, style, m_hsiLayer) ) {
+        m_hsiLayer = makeLayer(ls, ls, dpr);
+
+        QPainter painter(&m_hsiLayer);
+        painter.setRenderHint(QPainter::Antialiasing, getEffectiveAntialiasing());
+        painter.translate(ls/2.0, ls/2.0);
+
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(m_res->yawMarkerBrush);
+        painter.drawPolygon(m_res->yawMarker);
+
+        painter.setPen(QPen(Qt::white, 2));
+        painter.drawLine(QPointF(-r/5.0, 0), QPointF(r/5.0, 0));
+        painter.drawLine(QPointF(0, -r/8.0), QPointF(0, r/5.0));
+        painter.drawLine(QPointF(-r/12.0, r/5.0), QPointF(r/12.0, r/5.0));
+
+        painter.setPen(m_res->blackPen);
+        painter.setBrush(m_res->whiteBrush);
+        painter.drawRoundedRect(m_res->altBox.translated(getReadoutOffset()), 6, 6);
+
+        painter.end();
+        cache->insert(QArtworkCache::COMPASS_HSI, m_size, dpr, style, m_hsiLayer);
+    }
+
+    m_cardSize = m_size;
+    m_cardDpr  = dpr;
+}
+
+void QCompassRenderer::drawCard(QPainter &painter, double yaw)
+{
+    if( m_cardSize != m_size || m_cardDpr != layerDpr() )
+        buildCard();
+
+    int     ls = getImageSize();
+
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, m_filter != FILTER_FAST);
+
+    // the heading goes to the top, where the yaw marker points in north-up mode
+    painter.rotate(yaw);
+    painter.drawImage(QRectF(-ls/2.0, -ls/2.0, ls, ls), m_cardLayer);
+    painter.rotate(-yaw);
+}
+
+void QCompassRenderer::drawHsiOverlay(QPainter &painter, double yaw)
+{
+    double  r   = m_size/2 - m_offset;
+    double  dot = r*0.16;                       // deviation of one dot
+
+    // course pointer, deviation bar & dots
+    if( m_courseOn ) {
+        double  dx = qBound(-2.5, m_dev, 2.5)*dot;
+        QPen    pen(QColor(255, 0, 255), 3);
+        QPointF head[3] = {
+            QPointF(0,       -r*0.80),
+            QPointF(-r*0.07, -r*0.62),
+            QPointF( r*0.07, -r*0.62)
+        };
+
+        painter.rotate(yaw - m_course);
+
+        painter.setPen(m_res->whitePen1);
+        painter.setBrush(Qt::NoBrush);
+        for(int i=-2; i<=2; i++)
+            if( i != 0 ) painter.drawEllipse(QPointF(i*dot, 0), 3, 3);
+
+        painter.setPen(pen);
+        painter.drawLine(QPointF(0, -r*0.62), QPointF(0, -r*0.38));
+        painter.drawLine(QPointF(0,  r*0.38), QPointF(0,  r*0.80));
+        painter.drawLine(QPointF(dx, -r*0.34), QPointF(dx, r*0.34));
+
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(pen.color());
+        painter.drawPolygon(head, 3);
+
+        painter.rotate(m_course - yaw);
+    }
+
+    // bearing pointer
+    if( m_bearingOn ) {
+        QPointF head[3] = {
+            QPointF(0,       -r*0.95),
+            QPointF(-r*0.06, -r*0.80),
+            QPointF( r*0.06, -r*0.80)
+        };
+
+        painter.rotate(yaw - m_bearing);
+
+        painter.setPen(QPen(Qt::cyan, 2));
+        painter.setBrush(Qt::NoBrush);
+        painter.drawLine(QPointF(0, -r*0.80), QPointF(0, -r*0.45));
+        painter.drawLine(QPointF(0,  r*0.45), QPointF(0,  r*0.95));
+        painter.drawPolyline(head, 3);
+
+        painter.rotate(m_bearing - yaw);
+    }
+
+    // fixed overlay
+    {
+        int ls = getImageSize();
+        painter.drawImage(QPointF(-ls/2.0, -ls/2.0), m_hsiLayer);
+    }
+}
+
+void QCompassRenderer::drawDial(QPainter &painter, const QRectF &rc)
+{
+    if( m_dialSize != m_size || m_dialDpr != layerDpr() )
+        buildDial();
+
+    int     ls = getImageSize();
+    QRectF  dial(-ls/2.0, -ls/2.0, ls, ls);
+    QRectF  r = rc.isNull() ? dial : (rc & dial);
+
+    if( !r.isEmpty() )
+        painter.drawImage(r, m_dialLayer,
+                          QRectF((r.topLeft() - dial.topLeft())*m_dialDpr, r.size()*m_dialDpr));
+}
+
+const QImage& QCompassRenderer::getDialLayer(void)
+{
+    if( m_dialSize != m_size || m_dialDpr != layerDpr() )
+        buildDial();
+
+    return m_dialLayer;
+}
+
+void QCompassRenderer::drawYawMarker(QPainter &painter, double yaw)
+{
+    painter.rotate(-yaw);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(m_res->yawMarkerBrush);
+
+    painter.drawPolygon(m_res->yawMarker);
+
+    painter.rotate(yaw);
+}
+
+void QCompassRenderer::drawAlt(QPainter &painter, double alt)
+{
+    painter.setFont(m_res->altFont);
+    painter.setPen(m_res->bluePen);
+
+    m_res->drawReadout(painter, m_res->altRect.translated(getReadoutOffset()),
+                       m_res->altPrefix, alt);
+}
+
+void QCompassRenderer::drawH(QPainter &painter, double h)
+{
+    painter.setFont(m_res->altFont);
+    painter.setPen(m_res->bluePen);
+
+    m_res->drawReadout(painter, m_res->hRect.translated(getReadoutOffset()),
+                       m_res->hPrefix, h);
+}
+
+void QCompassRenderer::render(QPainter &painter, double yaw, double alt, double h)
+{
+    painter.setRenderHint(QPainter::Antialiasing, getEffectiveAntialiasing());
+
+    if( m_mode == HEADING_UP ) {
+        drawCard(painter, yaw);
+        drawHsiOverlay(painter, yaw);
+    } else {
+        drawDial(painter);
+        drawYawMarker(painter, yaw);
+    }
+
+    drawAlt(painter, alt);
+    drawH(painter, h);
+}
+
+void QCompassRenderer::renderImage(QImage &img, double yaw, double alt, double h)
+{
+    int     s  = getImageSize();
+    int     px = qCeil(s*m_dpr);
+
+    if( img.width() != px || img.height() != px ||
+        img.format() != QImage::Format_ARGB32_Premultiplied ) {
+        img = makeLayer(s, s, m_dpr);
+    } else {
+        img.fill(Qt::transparent);
+    }
+
+    QPainter painter(&img);
+    painter.translate(s / 2, s / 2);
+
+    render(painter, yaw, alt, h);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QTapeRenderer::QTapeRenderer(TapeType type, bool sharedResources)
+{
+    m_width  = 0;
+    m_height = 0;
+    m_dpr    = 1.0;
+
+    m_antialiasing = true;
+
+    m_shared = sharedResources;
+    m_res    = NULL;
+
+    setType(type);
+}
+
+QTapeRenderer::~QTapeRenderer()
+{
+    if( m_shared ) QInstrumentResources::release(m_res);
+    else           delete m_res;
+}
+
+void QTapeRenderer::setType(TapeType type)
+{
+    m_type = type;
+
+    if( type == ALTITUDE ) {
+        m_tick = 10;  m_labelEvery = 5; m_pxPerTick = 12;
+        m_min  = -1000; m_max = 20000;
+    } else if( type == AIRSPEED ) {
+        m_tick = 1;   m_labelEvery = 5; m_pxPerTick = 8;
+        m_min  = 0;   m_max = 300;
+    } else {
+        // VSI: the scale is fitted to the height
+        m_tick = 1;   m_labelEvery = 5; m_pxPerTick = 0;
+        m_min  = -10; m_max = 10;
+    }
+
+    invalidate();
+}
+
+void QTapeRenderer::setSize(int w, int h, qreal dpr)
+{
+    if( h != m_height || m_res == NULL ) {
+        if( m_shared ) {
+            const QInstrumentResources *old = m_res;
+
+            m_res = QInstrumentResources::get(h);
+            QInstrumentResources::release(old);
+        } else {
+            delete m_res;
+            m_res = QInstrumentResources::create(h);
+        }
+    }
+
+    if( w != m_width || h != m_height || dpr != m_dpr ) invalidate();
+
+    m_width  = w;
+    m_height = h;
+    m_dpr    = dpr;
+}
+
+void QTapeRenderer::setScale(double tick, int labelEvery, double pxPerTick)
+{
+    if( tick <= 0 || labelEvery < 1 ) return;
+
+    m_tick       = tick;
+    m_labelEvery = labelEvery;
+    m_pxPerTick  = pxPerTick > 1 ? pxPerTick : 1;
+
+    invalidate();
+}
+
+void QTapeRenderer::setRange(double vMin, double vMax)
+{
+    if( vMax <= vMin ) return;
+
+    m_min = vMin;
+    m_max = vMax;
+
+    invalidate();
+}
+
+void QTapeRenderer::setAntialiasing(bool aa)
+{
+    m_antialiasing = aa;
+
+    invalidate();
+}
+
+void QTapeRenderer::invalidate(void)
+{
+    m_tiles.clear();
+    m_scaleLayer = QImage();
+}
+
+void QTapeRenderer::drawGraduation(QPainter &painter, double vLo, double vHi, double vTop,
+                                   double ppu)
+{
+    int             tl = qMax(4, m_width/6);
+    int             prec = (m_tick*m_labelEvery == floor(m_tick*m_labelEvery)) ? 0 : 1;
+    int             i0, i1;
+    QVector<QLineF> ticks;
+
+    vLo = qMax(vLo, m_min);
+    vHi = qMin(vHi, m_max);
+    if( vHi < vLo ) return;
+
+    i0 = (int) ceil(vLo/m_tick - 1e-9);
+    i1 = (int) floor(vHi/m_tick + 1e-9);
+
+    // all ticks in one batch
+    ticks.reserve(i1 - i0 + 1);
+    for(int i=i0; i<=i1; i++) {
+        double  y = (vTop - i*m_tick)*ppu;
+        int     l = (i % m_labelEvery == 0) ? tl : tl/2;
+
+        if( m_type == AIRSPEED ) ticks.append(QLineF(m_width - l, y, m_width, y));
+        else                     ticks.append(QLineF(0, y, l, y));
+    }
+
+    painter.setPen(m_res->whitePen1);
+    painter.drawLines(ticks);
+
+    // labels
+    painter.setFont(m_res->labelFont);
+
+    for(int i=i0; i<=i1; i++) {
+        if( i % m_labelEvery != 0 ) continue;
+
+        double  y = (vTop - i*m_tick)*ppu;
+
+        if( m_type == AIRSPEED )
+            painter.drawText(QRectF(2, y - 7, m_width - tl - 5, 14),
+                             Qt::AlignRight|Qt::AlignVCenter, QString::number(i*m_tick, 'f', prec));
+        else
+            painter.drawText(QRectF(tl + 3, y - 7, m_width - tl - 5, 14),
+                             Qt::AlignLeft|Qt::AlignVCenter, QString::number(i*m_tick, 'f', prec));
+    }
+}
+
+QImage QTapeRenderer::tile(int k)
+{
+    QHash<int, QImage>::iterator it = m_tiles.find(k);
+
+    if( it != m_tiles.end() ) return it.value();
+
+    // keep the tiles nearest to the current one
+    if( m_tiles.size() >= MAX_TILES ) {
+        int drop = k;
+
+        for(it=m_tiles.begin(); it!=m_tiles.end(); it++)
+            if( qAbs(it.key() - k) >= qAbs(drop - k) ) drop = it.key();
+
+        m_tiles.remove(drop);
+    }
+
+    double  ppu  = m_pxPerTick / m_tick;
+    double  span = TILE_H / ppu;
+    double  margin = 8 / ppu;                   // labels crossing the tile edge
+    QImage  img = makeLayer(m_width, TILE_H, m_dpr);
+
+    {
+        QPainter painter(&img);
+        painter.setRenderHint(QPainter::Antialiasing, m_antialiasing);
+
+        drawGraduation(painter, k*span - margin, (k+1)*span + margin, (k+1)*span, ppu);
+    }
+
+    m_tiles.insert(k, img);
+
+    return img;
+}
+
+void QTapeRenderer::drawRolling(QPainter &painter, double v, const QRectF &box)
+{
+    const QStaticText   *g = m_res->glyphs;
+    qreal               gw = m_res->glyphWidth;
+    qreal               gh = g[0].size().height();
+    double              a = qMin(fabs(v), 1e9);
+    double              f = a - floor(a);
+    quint64             p = (quint64) floor(a);
+    qreal               x = box.right() - gw;
+    qreal               y = box.center().y() - gh/2;
+    bool                carry = true;               // all lower digits are 9
+    int                 nd = 1;
+
+    // one more column when the carry is about to add a digit
+    for(quint64 q=(p+1)/10; q; q/=10) nd++;
+
+    painter.save();
+    painter.setClipRect(box, Qt::IntersectClip);
+    painter.setPen(m_res->whitePen1);
+
+    // odometer: a column rolls with the fraction while all lower ones show 9
+    for(int j=0; j<nd; j++, p/=10, x-=gw) {
+        int     d = p % 10;
+        qreal   yd = y + (carry ? f*gh : 0);
+
+        // the value above rolls in, the one below out; leading zeros are blank
+        if( j == 0 || p > 0 || carry )
+            painter.drawStaticText(QPointF(x + (gw - g[(d+1)%10].size().width())/2, yd - gh),
+                                   g[(d+1)%10]);
+        if( j == 0 || p > 0 )
+            painter.drawStaticText(QPointF(x + (gw - g[d].size().width())/2, yd), g[d]);
+        if( j == 0 ? p > 0 : p > 1 )
+            painter.drawStaticText(QPointF(x + (gw - g[(d+9)%10].size().width())/2, yd + gh),
+                                   g[(d+9)%10]);
+
+        carry = carry && d == 9;
+    }
+
+    if( v < 0 )
+        painter.drawStaticText(QPointF(x + (gw - g[11].size().width())/2, y), g[11]);
+
+    painter.restore();
+}
+
+void QTapeRenderer::renderScrolling(QPainter &painter, double v)
+{
+    double  ppu  = m_pxPerTick / m_tick;
+    double  span = TILE_H / ppu;
+    double  half = m_height / 2.0;
+    double  vt = qBound(m_min - half/ppu, v, m_max + half/ppu);
+    int     tl = qMax(4, m_width/6);
+    int     k0, k1;
+
+    // visible value range -> tiles, the graduation ends at the range limits
+    k0 = (int) floor(qMax(vt - half/ppu, m_min) / span);
+    k1 = (int) floor(qMin(vt + half/ppu, m_max) / span);
+
+    for(int k=k0; k<=k1; k++) {
+        QImage  img = tile(k);
+
+        // top of the tile, on a device pixel: no resampling
+        double  yt = qRound((half + (vt - (k+1)*span)*ppu)*m_dpr) / m_dpr;
+        double  y0 = qMax(0.0, yt);
+        double  y1 = qMin((double) m_height, yt + TILE_H);
+
+        if( y1 <= y0 ) continue;
+
+        painter.drawImage(QRectF(0, y0, m_width, y1 - y0), img,
+                          QRectF(0, (y0 - yt)*m_dpr, m_width*m_dpr, (y1 - y0)*m_dpr));
+    }
+
+    // readout box with a pointer to the graduation
+    {
+        qreal       gh = m_res->glyphs[0].size().height();
+        qreal       bh = qRound(gh*1.6);
+        QRectF      box;
+        QPointF     ptr[3];
+
+        if( m_type == AIRSPEED ) {
+            box = QRectF(1, half - bh/2, m_width - tl - 1, bh);
+            ptr[0] = QPointF(box.right(),     half - 5);
+            ptr[1] = QPointF(box.right() + 5, half);
+            ptr[2] = QPointF(box.right(),     half + 5);
+        } else {
+            box = QRectF(tl, half - bh/2, m_width - tl - 1, bh);
+            ptr[0] = QPointF(box.left(),     half - 5);
+            ptr[1] = QPointF(box.left() - 5, half);
+            ptr[2] = QPointF(box.left(),     half + 5);
+        }
+
+        painter.setPen(m_res->whitePen1);
+        painter.setBrush(m_res->blackBrush);
+        painter.drawRect(box);
+        painter.setPen(Qt::NoPen);
+        painter.drawPolygon(ptr, 3);
+
+        drawRolling(painter, v, box.adjusted(2, 1, -2, -1));
+    }
+}
+
+void QTapeRenderer::renderVsi(QPainter &painter, double v)
+{
+    qreal   gh = m_res->glyphs[0].size().height();
+    int     tl = qMax(4, m_width/6);
+    double  top = 8, bottom = m_height - gh - 10;
+    double  ppu = (bottom - top) / (m_max - m_min);
+
+    if( m_scaleLayer.isNull() ) {
+        m_scaleLayer = makeLayer(m_width, m_height, m_dpr);
+
+        QPainter painter(&m_scaleLayer);
+        painter.setRenderHint(QPainter::Antialiasing, m_antialiasing);
+        painter.fillRect(QRectF(0, 0, m_width, m_height), QColor(64, 64, 64));
+        painter.translate(0, top);
+
+        drawGraduation(painter, m_min, m_max, m_max, ppu);
+    }
+
+    painter.drawImage(QPointF(0, 0), m_scaleLayer);
+
+    // pointer from the pivot (right, at zero) to the value
+    {
+        double  y0 = top + m_max*ppu;
+        double  y  = top + (m_max - qBound(m_min, v, m_max))*ppu;
+
+        painter.setPen(m_res->pitchPen);
+        painter.drawLine(QPointF(m_width - 2, y0), QPointF(tl + 2, y));
+    }
+
+    // readout below the scale
+    {
+        QRectF  box(tl, m_height - gh - 6, m_width - tl - 1, gh + 4);
+        char    buf[32];
+        int     n = QInstrumentResources::formatFixed(buf, v, 0, 1);
+        qreal   x = box.right() - 2;
+
+        painter.setPen(m_res->whitePen1);
+        painter.setBrush(m_res->blackBrush);
+        painter.drawRect(box);
+
+        for(int i=n-1; i>=0; i--) {
+            int     gi = glyphIndex(buf[i]);
+            qreal   w  = (gi == 10 || gi == 11) ? m_res->glyphs[gi].size().width()
+                                                : m_res->glyphWidth;
+
+            x -= w;
+            painter.drawStaticText(QPointF(x + (w - m_res->glyphs[gi].size().width())/2,
+                                           box.top() + 2),
+                                   m_res->glyphs[gi]);
+        }
+    }
+}
+
+void QTapeRenderer::render(QPainter &painter, double v)
+{
+    if( qIsNaN(v) ) v = 0;
+
+    painter.setRenderHint(QPainter::Antialiasing, m_antialiasing);
+    painter.translate(-m_width/2.0, -m_height/2.0);
+
+    if( m_type == VSI ) {
+        renderVsi(painter, v);
+    } else {
+        painter.fillRect(QRectF(0, 0, m_width, m_height), QColor(64, 64, 64));
+        renderScrolling(painter, v);
+    }
+
+    painter.translate(m_width/2.0, m_height/2.0);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QRenderJob::QRenderJob(QObject *parent)
+    : QObject(parent)
+{
+    m_size   = 0;
+    m_dpr    = 1.0;
+    m_queued = false;
+
+    atomicStore(m_renderNs, 0);
+
+    m_lastSize = 0;
+    m_lastDpr  = 0;
+
+    for(int i=0; i<MAX_VALUES; i++) m_v[i] = m_lastV[i] = 0;
+}
+
+QRenderJob::~QRenderJob()
+{
+    // the derived jobs cancel already, their renderer is gone by now
+    cancel();
+}
+
+void QRenderJob::cancel(void)
+{
+    if( !QInstrumentRenderThread::s_instance.isNull() )
+        QInstrumentRenderThread::s_instance->cancel(this);
+}
+
+void QRenderJob::request(int size, qreal dpr, const double *v, int n)
+{
+    bool    changed = size != m_lastSize || dpr != m_lastDpr;
+
+    for(int i=0; i<n && i<MAX_VALUES; i++) {
+        if( v[i] != m_lastV[i] ) changed = true;
+        m_lastV[i] = v[i];
+    }
+
+    if( !changed ) return;
+
+    m_lastSize = size;
+    m_lastDpr  = dpr;
+
+    QInstrumentRenderThread::instance()->enqueue(this, size, dpr, m_lastV);
+}
+
+void QADIRenderJob::render(QImage &img, int size, qreal dpr, const double *v)
+{
+    if( m_renderer.getAntialiasing() != (v[2] != 0) )
+        m_renderer.setAntialiasing(v[2] != 0);
+
+    m_renderer.setQuality((int) v[3]);
+    m_renderer.setSize(size, dpr);
+    m_renderer.renderImage(img, v[0], v[1]);
+}
+
+void QCompassRenderJob::render(QImage &img, int size, qreal dpr, const double *v)
+{
+    if( m_renderer.getAntialiasing() != (v[3] != 0) )
+        m_renderer.setAntialiasing(v[3] != 0);
+
+    m_renderer.setCardMode((QCompassRenderer::CardMode) (int) v[4]);
+    m_renderer.setCardFilter((QCompassRenderer::CardFilter) (int) v[5]);
+    m_renderer.setCourse(v[6] != 0, v[7], v[8]);
+    m_renderer.setBearing(v[9] != 0, v[10]);
+    m_renderer.setQuality((int) v[11]);
+
+    m_renderer.setSize(size, dpr);
+    m_renderer.renderImage(img, v[0], v[1], v[2]);
+}
+
+
+QPointer<QInstrumentRenderThread> QInstrumentRenderThread::s_instance;
+
+QInstrumentRenderThread::QInstrumentRenderThread(QObject *parent)
+    : QThread(parent)
+{
+    m_current = NULL;
+    m_quit    = false;
+}
+
+QInstrumentRenderThread::~QInstrumentRenderThread()
+{
+    m_mutex.lock();
+    m_quit = true;
+    m_cond.wakeAll();
+    m_mutex.unlock();
+
+    wait();
+}
+
+QInstrumentRenderThread* QInstrumentRenderThread::instance(void)
+{
+    if( s_instance.isNull() ) {
+        s_instance = new QInstrumentRenderThread(qApp);
+        s_instance->start();
+    }
+
+    return s_instance;
+}
+
+void QInstrumentRenderThread::enqueue(QRenderJob *job, int size, qreal dpr, const double *v)
+{
+    QMutexLocker locker(&m_mutex);
+
+    job->m_size = size;
+    job->m_dpr  = dpr;
+    memcpy(job->m_v, v, sizeof(job->m_v));
+
+    if( !job->m_queued ) {
+        job->m_queued = true;
+        m_queue.append(job);
+        m_cond.wakeOne();
+    }
+}
+
+void QInstrumentRenderThread::cancel(QRenderJob *job)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_queue.removeAll(job);
+    job->m_queued = false;
+
+    while( m_current == job ) m_idle.wait(&m_mutex);
+}
+
+void QInstrumentRenderThread::run(void)
+{
+    QMutexLocker locker(&m_mutex);
+
+    while( !m_quit ) {
+        if( m_queue.isEmpty() ) {
+            m_cond.wait(&m_mutex);
+            continue;
+        }
+
+        QRenderJob  *job = m_queue.takeFirst();
+        int         size = job->m_size;
+        qreal       dpr  = job->m_dpr;
+        double      v[QRenderJob::MAX_VALUES];
+
+        memcpy(v, job->m_v, sizeof(v));
+        job->m_queued = false;
+        m_current = job;
+
+        locker.unlock();
+
+        qint64  t0 = QTelemetryQueue::now();
+
+        job->render(job->m_frames.back(), size, dpr, v);
+        atomicStore(job->m_renderNs, QTelemetryQueue::now() - t0);
+        job->m_frames.publish();
+        emit job->frameReady();
+
+        locker.relock();
+
+        m_current = NULL;
+        m_idle.wakeAll();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QCompass::QCompass(QWidget *parent)
+    : QWidget(parent)
+{
+    m_sizeMin = 200;
+    m_sizeMax = 600;
+    m_offset = 2;
+    m_size = m_sizeMin - 2*m_offset;
+
+    setMinimumSize(m_sizeMin, m_sizeMin);
+    setMaximumSize(m_sizeMax, m_sizeMax);
+    resize(m_sizeMin, m_sizeMin);
+
+    setFocusPolicy(Qt::NoFocus);
+
+    m_yaw  = 0.0;
+    m_alt  = 0.0;
+    m_h    = 0.0;
+    m_paintedYaw = 0.0;
+
+    m_courseOn  = false;
+    m_bearingOn = false;
+    m_course    = 0.0;
+    m_dev       = 0.0;
+    m_bearing   = 0.0;
+
+    m_yawCh     = QSampleChannel(360);
+    m_latency   = 0;
+    m_maxExtrap = 100000000;
+
+    QInstrumentScheduler::instance()->registerWidget(this);
+
+    m_renderer.setSize(m_size);
+    m_res = m_renderer.getResources();
+    m_job = NULL;
+
+    m_stats = NULL;
+    m_hud   = false;
+
+    m_settleTimer = new QTimer(this);
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(QQualityGovernor::settleTime());
+    connect(m_settleTimer, SIGNAL(timeout(void)), this, SLOT(settle_slot(void)));
+
+    m_hudTimer = new QTimer(this);
+    m_hudTimer->setSingleShot(true);
+    m_hudTimer->setTimerType(Qt::PreciseTimer);
+    m_hudTimer->setInterval(1000);
+    connect(m_hudTimer, SIGNAL(timeout(void)), this, SLOT(hudRefresh_slot(void)));
+}
+
+QCompass::~QCompass()
+{
+    if( QInstrumentScheduler::existingInstance() )
+        QInstrumentScheduler::existingInstance()->unregisterWidget(this);
+
+    // stop the render thread from using the job before it is destroyed
+    if( m_job ) {
+        m_job->cancel();
+        delete m_job;
+        m_job = NULL;
+    }
+
+    delete m_stats;
+}
+
+
+void QCompass::canvasReplot_slot(void)
+{
+    markDirty();
+}
+
+void QCompass::frameReady_slot(void)
+{
+    markDirty();
+}
+
+void QCompass::settle_slot(void)
+{
+    if( m_governor.settle() ) {
+        m_renderer.setQuality(QQualityGovernor::LEVEL_FULL);
+        markDirty();
+    }
+}
+
+void QCompass::hudRefresh_slot(void)
+{
+    if( m_hud ) markDirty(QPaintStats::hudRect());
+}
+
+void QCompass::setThreadedRendering(bool on)
+{
+    if( on == (m_job != NULL) ) return;
+
+    if( on && !QFontDatabase::supportsThreadedFontRendering() ) {
+        qWarning("threaded rendering is not supported on this platform");
+        return;
+    }
+
+    if( on ) {
+        m_job = new QCompassRenderJob(this);
+        connect(m_job, SIGNAL(frameReady(void)), this, SLOT(frameReady_slot(void)));
+    } else {
+        m_job->cancel();
+        delete m_job;
+        m_job = NULL;
+    }
+
+    markDirty();
+}
+
+void QCompass::setStatsEnabled(bool on)
+{
+    if( on == (m_stats != NULL) ) return;
+
+    if( on ) {
+        m_stats = new QPaintStats();
+    } else {
+        delete m_stats;
+        m_stats = NULL;
+        m_hud   = false;
+    }
+
+    markDirty();
+}
+
+void QCompass::setHudVisible(bool on)
+{
+    if( on ) setStatsEnabled(true);
+
+    m_hud = on;
+    markDirty();
+}
+
+void QCompass::setFrameBudget(double ms)
+{
+    m_governor.setBudget(ms);
+    m_renderer.setQuality(m_governor.getLevel());
+
+    markDirty();
+}
+
+void QCompass::governQuality(qint64 ns)
+{
+    if( m_governor.addPaint(ns) ) {
+        m_renderer.setQuality(m_governor.getLevel());
+        markDirty();
+    }
+
+    // full quality again once nothing was painted for a while
+    if( m_governor.getLevel() > QQualityGovernor::LEVEL_FULL )
+        m_settleTimer->start();
+}
+
+void QCompass::resizeEvent(QResizeEvent *event)
+{
+    m_size = qMin(width(),height()) - 2*m_offset;
+
+    m_renderer.setSize(m_size, widgetDpr(this));
+    m_res = m_renderer.getResources();
+}
+
+QRect QCompass::yawMarkerRect(double yaw)
+{
+    QTransform t;
+
+    // the card turns with the heading
+    if( m_renderer.getCardMode() == QCompassRenderer::HEADING_UP ) return rect();
+
+    t.translate(width() / 2, height() / 2);
+    t.rotate(-yaw);
+
+    // margin for antialiasing
+    return t.map(m_res->yawMarker).boundingRect().toAlignedRect().adjusted(-2, -2, 2, 2);
+}
+
+QRect QCompass::readoutRect(const QRectF &rc)
+{
+    return rc.translated(QPointF(width() / 2, height() / 2) + m_renderer.getReadoutOffset())
+             .toAlignedRect().adjusted(-1, -1, 1, 1);
+}
+
+void QCompass::paintEvent(QPaintEvent *event)
+{
+    qint64  t0 = m_stats || m_governor.isEnabled() ? QTelemetryQueue::now() : 0;
+
+    // the dial is rebuilt on a resize or a screen change
+    m_renderer.setSize(m_size, widgetDpr(this));
+    m_res = m_renderer.getResources();
+
+    QPainter        painter(this);
+    const QRegion   &rgn = event->region();
+    double          yaw = m_yaw, alt = m_alt, h = m_h;
+
+    // timestamped samples: value at the presentation time
+    if( !m_yawCh.isEmpty() || !m_altCh.isEmpty() || !m_hCh.isEmpty() ) {
+        qint64  tp = QTelemetryQueue::now() + m_latency;
+        QRegion next;
+
+        if( !m_yawCh.isEmpty() ) {
+            yaw = m_yawCh.value(tp, m_maxExtrap);
+
+            // the marker must be inside the repainted region, else repaint all
+            if( !(QRegion(yawMarkerRect(yaw)) - rgn).isEmpty() ) markDirty();
+
+            if( tp < m_yawCh.lastTime() + m_maxExtrap ) {
+                next += yawMarkerRect(yaw);
+                next += yawMarkerRect(m_yawCh.value(
+                            tp + (qint64) (1e9/QInstrumentScheduler::instance()->getTargetRate()),
+                            m_maxExtrap));
+            }
+        }
+        // setAlt() / setH() clear only their own channel
+        if( !m_altCh.isEmpty() ) {
+            alt = m_altCh.value(tp, m_maxExtrap);
+
+            if( tp < m_altCh.lastTime() + m_maxExtrap )
+                next += readoutRect(m_res->altRect);
+        }
+        if( !m_hCh.isEmpty() ) {
+            h = m_hCh.value(tp, m_maxExtrap);
+
+            if( tp < m_hCh.lastTime() + m_maxExtrap )
+                next += readoutRect(m_res->hRect);
+        }
+
+        // keep animating until the extrapolation window has passed
+        if( !next.isEmpty() ) markDirty(next);
+    }
+
+    // threaded: show the newest completed frame, render the next one
+    if( m_job ) {
+        double  v[12] = { yaw, alt, h, m_renderer.getAntialiasing() ? 1.0 : 0.0,
+                          (double) m_renderer.getCardMode(), (double) m_renderer.getCardFilter(),
+                          m_courseOn ? 1.0 : 0.0, m_course, m_dev,
+                          m_bearingOn ? 1.0 : 0.0, m_bearing,
+                          (double) m_governor.getLevel() };
+
+        m_job->request(m_size, widgetDpr(this), v, 12);
+
+        // the governor watches the render thread, blitting costs nothing
+        if( m_job->fetch() && m_governor.isEnabled() )
+            governQuality(m_job->getRenderTime());
+
+        const QImage &img = m_job->frame();
+        if( !img.isNull() ) {
+            int s = qRound(img.width() / img.devicePixelRatio());
+            painter.drawImage(QPoint(width() / 2 - s / 2, height() / 2 - s / 2), img);
+        }
+    } else if( m_renderer.getCardMode() == QCompassRenderer::HEADING_UP ) {
+        // the card turns: whole frame, clipped to the exposed region
+        m_renderer.setCourse(m_courseOn, m_course, m_dev);
+        m_renderer.setBearing(m_bearingOn, m_bearing);
+
+        painter.translate(width() / 2, height() / 2);
+        m_renderer.render(painter, yaw, alt, h);
+    } else {
+        painter.setRenderHint(QPainter::Antialiasing, m_renderer.getEffectiveAntialiasing());
+        painter.translate(width() / 2, height() / 2);
+
+        // draw static dial (only the exposed part)
+        m_renderer.drawDial(painter, QRectF(event->rect()).translated(-(width() / 2), -(height() / 2)));
+
+        // draw yaw marker
+        if( rgn.intersects(yawMarkerRect(yaw)) )
+            m_renderer.drawYawMarker(painter, yaw);
+
+        // draw altitude
+        if( rgn.intersects(readoutRect(m_res->altRect)) )
+            m_renderer.drawAlt(painter, alt);
+        if( rgn.intersects(readoutRect(m_res->hRect)) )
+            m_renderer.drawH(painter, h);
+    }
+    m_paintedYaw = yaw;
+
+    if( !m_job && m_governor.isEnabled() ) governQuality(QTelemetryQueue::now() - t0);
+
+    // the overlay is part of every dirty region (see markDirty)
+    if( m_stats ) {
+        m_stats->addPaint(t0, QTelemetryQueue::now());
+
+        if( m_hud ) {
+            painter.resetTransform();
+            m_stats->drawHud(painter);
+
+            // show the rate drop to 0 if no paint follows within a second
+            if( m_stats->getFps() > 0 ) m_hudTimer->start();
+        }
+    }
+}
+
+void QCompass::keyPressEvent(QKeyEvent *event)
+{
+    // only the changed part is repainted, like the setters do
+    QRegion rgn;
+
+    switch (event->key()) {
+    case Qt::Key_Left:
+        rgn = yawMarkerRect(m_paintedYaw);
+        m_yaw -= 1.0;
+        rgn += yawMarkerRect(m_yaw);
+        break;
+    case Qt::Key_Right:
+        rgn = yawMarkerRect(m_paintedYaw);
+        m_yaw += 1.0;
+        rgn += yawMarkerRect(m_yaw);
+        break;
+    case Qt::Key_Down:
+        m_alt -= 1.0;
+        rgn = readoutRect(m_res->altRect);
+        break;
+    case Qt::Key_Up:
+        m_alt += 1.0;
+        rgn = readoutRect(m_res->altRect);
+        break;
+    case Qt::Key_W:
+        m_h += 1.0;
+        rgn = readoutRect(m_res->hRect);
+        break;
+    case Qt::Key_S:
+        m_h -= 1.0;
+        rgn = readoutRect(m_res->hRect);
+        break;
+
+    default:
+        QWidget::keyPressEvent(event);
+        return;
+    }
+
+    markDirty(rgn);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QTape::QTape(QTapeRenderer::TapeType type, QWidget *parent)
+    : QWidget(parent), m_renderer(type)
+{
+    setMinimumSize(60, 200);
+    setMaximumSize(120, 800);
+    resize(80, 300);
+
+    setFocusPolicy(Qt::NoFocus);
+
+    m_value = 0.0;
+
+    m_latency   = 0;
+    m_maxExtrap = 100000000;
+
+    QInstrumentScheduler::instance()->registerWidget(this);
+
+    m_renderer.setSize(width(), height());
+}
+
+QTape::~QTape()
+{
+    if( QInstrumentScheduler::existingInstance() )
+        QInstrumentScheduler::existingInstance()->unregisterWidget(this);
+}
+
+void QTape::resizeEvent(QResizeEvent *event)
+{
+    m_renderer.setSize(width(), height(), widgetDpr(this));
+}
+
+void QTape::paintEvent(QPaintEvent *)
+{
+    m_renderer.setSize(width(), height(), widgetDpr(this));
+
+    QPainter painter(this);
+
+    double  v = m_value;
+
+    // timestamped samples: value at the presentation time
+    if( !m_ch.isEmpty() ) {
+        qint64  tp = QTelemetryQueue::now() + m_latency;
+
+        v = m_ch.value(tp, m_maxExtrap);
+
+        // keep scrolling until the extrapolation window has passed
+        if( tp < m_ch.lastTime() + m_maxExtrap ) markDirty();
+    }
+
+    painter.translate(width() / 2.0, height() / 2.0);
+    m_renderer.render(painter, v);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QTrendChannel::QTrendChannel(qint64 capacity)
+{
+    qint64  c = CHUNK;
+
+    while( c < capacity ) c <<= 1;
+
+    m_raw.setCapacity(c, CHUNK);
+
+    for(int L=0; L<LEVELS; L++) {
+        qint64 lc = qMax<qint64>(1, c >> (FANOUT_BITS*(L+1)));
+
+        m_levels[L].setCapacity(lc, CHUNK);
+        m_accN[L] = 0;
+    }
+}
+
+void QTrendChannel::clear(void)
+{
+    m_raw.clear();
+
+    for(int L=0; L<LEVELS; L++) {
+        m_levels[L].clear();
+        m_accN[L] = 0;
+    }
+}
+
+void QTrendChannel::append(double v)
+{
+    MinMax  e;
+
+    e.lo = e.hi = (float) v;
+    m_raw.append(e.lo);
+
+    // carry completed blocks up the pyramid
+    for(int L=0; L<LEVELS; L++) {
+        MinMax &a = m_acc[L];
+
+        if( m_accN[L] == 0 ) {
+            a = e;
+        } else {
+            if( e.lo < a.lo ) a.lo = e.lo;
+            if( e.hi > a.hi ) a.hi = e.hi;
+        }
+
+        if( ++m_accN[L] < FANOUT ) break;
+
+        m_levels[L].append(a);
+        m_accN[L] = 0;
+        e = a;
+    }
+}
+
+QTrendChannel::MinMax QTrendChannel::rangeAt(int L, qint64 i0, qint64 i1) const
+{
+    MinMax  r;
+    int     shift = FANOUT_BITS*L;
+    qint64  k0, k1;
+
+    r.lo =  1e30f;
+    r.hi = -1e30f;
+
+    if( i1 <= i0 ) return r;
+
+    if( L == 0 ) {
+        for(qint64 i=i0; i<i1; i++) {
+            float v = m_raw.at(i);
+            if( v < r.lo ) r.lo = v;
+            if( v > r.hi ) r.hi = v;
+        }
+        return r;
+    }
+
+    const QChunkRing<MinMax> &lv = m_levels[L-1];
+
+    // whole blocks of this level inside [i0, i1), the edges from the finer levels
+    k0 = qMax((i0 + ((qint64) 1 << shift) - 1) >> shift, lv.getFirst());
+    k1 = qMin(i1 >> shift, lv.getCount());
+
+    if( k1 <= k0 ) return rangeAt(L-1, i0, i1);
+
+    for(qint64 k=k0; k<k1; k++) {
+        const MinMax &e = lv.at(k);
+        if( e.lo < r.lo ) r.lo = e.lo;
+        if( e.hi > r.hi ) r.hi = e.hi;
+    }
+
+    MinMax  h = rangeAt(L-1, i0, k0 << shift);
+    MinMax  t = rangeAt(L-1, k1 << shift, i1);
+
+    r.lo = qMin(r.lo, qMin(h.lo, t.lo));
+    r.hi = qMax(r.hi, qMax(h.hi, t.hi));
+
+    return r;
+}
+
+QTrendChannel::MinMax QTrendChannel::range(qint64 i0, qint64 i1) const
+{
+    qint64  n = i1 - i0;
+    int     L = 0;
+
+    i0 = qMax(i0, getFirst());
+    i1 = qMin(i1, getCount());
+
+    // coarsest level with at least one whole block in the range
+    while( L < LEVELS && ((qint64) FANOUT << (FANOUT_BITS*L)) <= n ) L++;
+
+    if( i1 <= i0 ) {
+        MinMax r;
+        r.lo =  1e30f;
+        r.hi = -1e30f;
+        return r;
+    }
+
+    return rangeAt(L, i0, i1);
+}
+
+void QTrendChannel::columns(double x0, double spp, int n, MinMax *out) const
+{
+    for(int c=0; c<n; c++) {
+        qint64 i0 = (qint64) floor(x0 + c*spp);
+        qint64 i1 = qMax(i0 + 1, (qint64) floor(x0 + (c+1)*spp));
+
+        out[c] = range(i0, i1);
+    }
+}
+
+
+QTrend::QTrend(QWidget *parent)
+    : QWidget(parent)
+{
+    setMinimumSize(200, 120);
+    setFocusPolicy(Qt::NoFocus);
+
+    m_rate   = 0;
+    m_span   = 60;
+    m_spp    = 1;
+    m_end    = 0;
+    m_follow = true;
+    m_dragX  = 0;
+
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, SIGNAL(timeout(void)), this, SLOT(sample_slot(void)));
+
+    QInstrumentScheduler::instance()->registerWidget(this);
+
+    setSampleRate(100);
+    setSpan(60);
+}
+
+QTrend::~QTrend()
+{
+    if( QInstrumentScheduler::existingInstance() )
+        QInstrumentScheduler::existingInstance()->unregisterWidget(this);
+
+    for(int i=0; i<m_channels.size(); i++) {
+        delete m_channels[i]->data;
+        delete m_channels[i];
+    }
+}
+
+int QTrend::addChannel(const QString &name, const QColor &color, qint64 capacity)
+{
+    Channel *c = new Channel;
+
+    c->name   = name;
+    c->color  = color;
+    c->data   = new QTrendChannel(capacity);
+    c->value  = 0;
+    c->source = SRC_VALUE;
+
+    m_channels.append(c);
+    markDirty();
+
+    return m_channels.size() - 1;
+}
+
+void QTrend::attach(QADI *adi)
+{
+    m_adi = adi;
+
+    m_channels[addChannel("roll",  QColor(255, 96, 96))]->source = SRC_ROLL;
+    m_channels[addChannel("pitch", QColor(96, 255, 96))]->source = SRC_PITCH;
+}
+
+void QTrend::attach(QCompass *compass)
+{
+    m_compass = compass;
+
+    m_channels[addChannel("alt", QColor(96, 160, 255))]->source = SRC_ALT;
+    m_channels[addChannel("H",   QColor(255, 208, 64))]->source = SRC_H;
+}
+
+void QTrend::appendSample(void)
+{
+    for(int i=0; i<m_channels.size(); i++) {
+        Channel *c = m_channels[i];
+
+        switch( c->source ) {
+        case SRC_ROLL:  if( m_adi )     c->value = m_adi->getRoll();     break;
+        case SRC_PITCH: if( m_adi )     c->value = m_adi->getPitch();    break;
+        case SRC_ALT:   if( m_compass ) c->value = m_compass->getAlt();  break;
+        case SRC_H:     if( m_compass ) c->value = m_compass->getH();    break;
+        default:        break;
+        }
+
+        c->data->append(c->value);
+    }
+
+    if( m_follow ) markDirty();
+}
+
+void QTrend::setSampleRate(double hz)
+{
+    m_rate = hz > 0 ? hz : 0;
+
+    if( m_rate > 0 ) {
+        m_timer->setInterval(qMax(1, qRound(1000.0/m_rate)));
+        m_timer->start();
+    } else {
+        m_timer->stop();
+    }
+
+    updateSpp();
+}
+
+void QTrend::setSpan(double seconds)
+{
+    if( seconds > 0 ) m_span = seconds;
+
+    updateSpp();
+}
+
+void QTrend::updateSpp(void)
+{
+    double  rate = m_rate > 0 ? m_rate : 100;
+
+    m_spp = qMax(1.0/16, m_span*rate / qMax(1, plotRect().width()));
+    markDirty();
+}
+
+void QTrend::sample_slot(void)
+{
+    appendSample();
+}
+
+qint64 QTrend::getCount(void)
+{
+    qint64 n = 0;
+
+    for(int i=0; i<m_channels.size(); i++)
+        n = qMax(n, m_channels[i]->data->getCount());
+
+    return n;
+}
+
+QRect QTrend::plotRect(void)
+{
+    // value labels on the right, time labels at the bottom
+    return QRect(2, 2, qMax(1, width() - 50), qMax(1, height() - 18));
+}
+
+void QTrend::paintEvent(QPaintEvent *)
+{
+    QPainter    painter(this);
+    QRect       pr = plotRect();
+    int         w = pr.width();
+    int         nch = m_channels.size();
+    qint64      count = getCount();
+    double      rate = m_rate > 0 ? m_rate : 100;
+    double      x0;
+
+    if( m_follow ) m_end = count;
+    x0 = m_end - w*m_spp;
+
+    painter.fillRect(rect(), QColor(32, 32, 32));
+
+    // time grid, 1-2-5 steps at least 80 px apart, labels relative to the newest sample
+    {
+        static const double mant[3] = { 1, 2, 5 };
+        double          step = 1e-3;
+        QVector<QLineF> grid;
+
+        for(int i=0; step*rate/m_spp < 80; i++)
+            step = mant[i % 3] * pow(10.0, i / 3 - 3);
+
+        double  t0 = (x0 - count)/rate, t1 = (m_end - count)/rate;
+
+        painter.setPen(QColor(160, 160, 160));
+        painter.setFont(QFont("", 8));
+
+        for(double t=ceil(t0/step)*step; t<=t1; t+=step) {
+            double x = pr.left() + (t*rate + count - x0)/m_spp;
+
+            grid.append(QLineF(x, pr.top(), x, pr.bottom()));
+            painter.drawText(QRectF(x - 40, pr.bottom() + 2, 80, 14), Qt::AlignCenter,
+                             QString::number(t, 'g', 6) + "s");
+        }
+
+        painter.setPen(QColor(64, 64, 64));
+        painter.drawLines(grid);
+    }
+
+    if( nch == 0 ) return;
+
+    if( m_cols.size() < w ) m_cols.resize(w);
+    if( m_pts.size() < 2*w ) m_pts.resize(2*w);
+
+    for(int ch=0; ch<nch; ch++) {
+        const Channel   *c = m_channels[ch];
+        double          top = pr.top() + (double) pr.height()*ch/nch;
+        double          h   = (double) pr.height()/nch;
+        double          lo = 1e30, hi = -1e30, sy;
+        int             n = 0;
+
+        c->data->columns(x0, m_spp, w, m_cols.data());
+
+        // auto-scale to the visible samples
+        for(int i=0; i<w; i++) {
+            if( m_cols[i].lo > m_cols[i].hi ) continue;
+            lo = qMin(lo, (double) m_cols[i].lo);
+            hi = qMax(hi, (double) m_cols[i].hi);
+        }
+        if( lo > hi ) { lo = -1; hi = 1; }
+        if( hi - lo < 1e-6 ) { lo -= 1; hi += 1; }
+
+        sy = (h - 6) / (hi - lo);
+
+        // min/max per column, joined into one polyline
+        for(int i=0; i<w; i++) {
+            const QTrendChannel::MinMax &m = m_cols[i];
+
+            if( m.lo > m.hi ) continue;
+
+            double x = pr.left() + i + 0.5;
+            m_pts[n++] = QPointF(x, top + 3 + (hi - m.hi)*sy);
+            m_pts[n++] = QPointF(x, top + 3 + (hi - m.lo)*sy);
+        }
+
+        painter.setPen(QColor(80, 80, 80));
+        if( ch > 0 ) painter.drawLine(QPointF(pr.left(), top), QPointF(pr.right(), top));
+
+        painter.setPen(c->color);
+        if( n > 0 ) painter.drawPolyline(m_pts.constData(), n);
+
+        // lane label & scale
+        painter.drawText(QRectF(pr.left() + 4, top + 2, w - 8, 14), Qt::AlignLeft|Qt::AlignTop,
+                         c->name + " " + QString::number(c->value, 'f', 1));
+        painter.setPen(QColor(200, 200, 200));
+        painter.drawText(QRectF(pr.right() + 4, top, 44, 14), Qt::AlignLeft|Qt::AlignTop,
+                         QString::number(hi, 'g', 5));
+        painter.drawText(QRectF(pr.right() + 4, top + h - 14, 44, 14), Qt::AlignLeft|Qt::AlignBottom,
+                         QString::number(lo, 'g', 5));
+    }
+}
+
+void QTrend::resizeEvent(QResizeEvent *)
+{
+    // keep the visible time span
+    updateSpp();
+}
+
+void QTrend::wheelEvent(QWheelEvent *event)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    int     ex = qRound(event->position().x());
+#else
+    int     ex = event->pos().x();
+#endif
+    QRect   pr = plotRect();
+    double  x  = qBound(0, ex - pr.left(), pr.width());
+    double  x0 = (m_follow ? getCount() : m_end) - pr.width()*m_spp;
+    double  s  = x0 + x*m_spp;                   // sample under the cursor stays put
+    double  spp = m_spp * pow(1.25, -event->angleDelta().y()/120.0);
+
+    spp = qBound(1.0/16, spp, qMax(1.0, 2.0*getCount()/pr.width()));
+
+    m_end  = s + (pr.width() - x)*spp;
+    m_spp  = spp;
+    m_span = spp*qMax(1, pr.width()) / (m_rate > 0 ? m_rate : 100);
+
+    // zooming at the right edge keeps following
+    if( m_follow && x < pr.width() ) m_follow = false;
+
+    markDirty();
+}
+
+void QTrend::mousePressEvent(QMouseEvent *event)
+{
+    m_dragX = event->pos().x();
+}
+
+void QTrend::mouseMoveEvent(QMouseEvent *event)
+{
+    if( !(event->buttons() & Qt::LeftButton) ) return;
+
+    if( m_follow ) m_end = getCount();
+
+    m_end   -= (event->pos().x() - m_dragX)*m_spp;
+    m_dragX  = event->pos().x();
+    m_follow = false;
+
+    markDirty();
+}
+
+void QTrend::mouseDoubleClickEvent(QMouseEvent *)
+{
+    m_follow = true;
+
+    markDirty();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QInstrumentGrid::QInstrumentGrid(QWidget *parent)
+    : QWidget(parent)
+{
+    m_cellSize = 64;
+    m_cols     = 1;
+
+    m_artSize  = 0;
+    m_artDpr   = 0;
+
+    m_labelFont = QFont("", 7);
+
+    // every pixel is painted in paintEvent
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setFocusPolicy(Qt::NoFocus);
+
+    QSizePolicy sp(QSizePolicy::Preferred, QSizePolicy::Preferred);
+    sp.setHeightForWidth(true);
+    setSizePolicy(sp);
+
+    QInstrumentScheduler::instance()->registerWidget(this);
+}
+
+QInstrumentGrid::~QInstrumentGrid()
+{
+    if( QInstrumentScheduler::existingInstance() )
+        QInstrumentScheduler::existingInstance()->unregisterWidget(this);
+}
+
+void QInstrumentGrid::setVehicleCount(int n)
+{
+    int n0 = m_roll.size();
+
+    if( n < 0 ) n = 0;
+
+    m_roll.resize(n);
+    m_pitch.resize(n);
+    m_yaw.resize(n);
+    m_dirty.resize(n);
+    m_labels.resize(n);
+
+    for(int i=n0; i<n; i++) {
+        m_roll[i]  = 0;
+        m_pitch[i] = 0;
+        m_yaw[i]   = 0;
+        m_labels[i].setText(QString::number(i));
+        m_labels[i].setPerformanceHint(QStaticText::AggressiveCaching);
+    }
+
+    m_dirty.fill(1);
+
+    updateGeometry();
+    update();
+}
+
+void QInstrumentGrid::setCellSize(int px)
+{
+    m_cellSize = qBound(32, px, 256);
+    m_cols     = columns(width());
+
+    m_dirty.fill(1);
+
+    updateGeometry();
+    update();
+}
+
+int QInstrumentGrid::columns(int w) const
+{
+    return qMax(1, w / (2*m_cellSize));
+}
+
+QRect QInstrumentGrid::cellRect(int i) const
+{
+    return QRect((i % m_cols) * 2*m_cellSize, (i / m_cols) * m_cellSize,
+                 2*m_cellSize, m_cellSize);
+}
+
+int QInstrumentGrid::heightForWidth(int w) const
+{
+    int cols = columns(w);
+    return (m_roll.size() + cols - 1) / cols * m_cellSize;
+}
+
+QSize QInstrumentGrid::sizeHint(void) const
+{
+    // about square: cells are twice as wide as high
+    int n    = qMax(1, m_roll.size());
+    int cols = qMax(1, qCeil(sqrt(n / 2.0)));
+    int rows = (n + cols - 1) / cols;
+
+    return QSize(cols * 2*m_cellSize, rows * m_cellSize);
+}
+
+void QInstrumentGrid::resizeEvent(QResizeEvent *)
+{
+    m_cols = columns(width());
+    m_dirty.fill(1);
+}
+
+void QInstrumentGrid::buildArtwork(void)
+{
+    qreal   dpr = widgetDpr(this);
+    int     s   = m_cellSize;
+    int     d   = s - 4;
+    int     r   = d / 2;
+
+    QPen    blackPen(Qt::black);
+    QPen    whitePen(Qt::white);
+
+    blackPen.setWidth(2);
+    whitePen.setWidth(1);
+
+    // sky/ground strip with a short pitch ladder, horizon at 1.5*d
+    //  (+-90 deg is +-d, plus half a disc of margin on each side)
+    {
+        int cy = 3*d/2;
 
-            s = QString("%1").arg(-p);
+        m_skyLayer = makeLayer(d, 3*d, dpr);
 
-            if( i % 3 == 0 )
-                l = ll;
-            else
-                l = ll/2;
+        QPainter painter(&m_skyLayer);
 
-            if( i == 0 ) {
-                painter.setPen(pitchZero);
-                l = l * 1.8;
-            } else {
-                painter.setPen(pitchPen);
-            }
+        painter.fillRect(0, 0,  d, cy,       QColor(48,172,220));
+        painter.fillRect(0, cy, d, 3*d - cy, QColor(247,168,21));
 
-            y = m_size/2*p/45.0 - m_size/2*pitch_tem/45.;
-            x = l;
+        QVector<QLine>  lines;
 
-            r = sqrt(x*x + y*y);
-            if( r > m_size/2 ) continue;
+        for(int i=-9; i<=9; i++) {
+            if( i == 0 ) continue;
 
-            painter.drawLine(QPointF(-l, 1.0*y), QPointF(l, 1.0*y));
+            int y = cy + r*i*10/45.0;
+            int l = (i % 3 == 0) ? d/5 : d/10;
 
-            textWidth = 100;
+            lines.append(QLine(r - l, y, r + l, y));
+        }
 
-            if( i % 3 == 0 && i != 0 ) {
-                painter.setPen(QPen(Qt::white));
+        painter.setPen(whitePen);
+        painter.drawLines(lines);
+        painter.setPen(QPen(Qt::green, 2));
+        painter.drawLine(r - d/5, cy, r + d/5, cy);
+    }
 
-                x1 = -x-2-textWidth;
-                y1 = y - fontSize/2 - 1;
-                painter.drawText(QRectF(x1, y1, textWidth, fontSize+2),
-                                 Qt::AlignRight|Qt::AlignVCenter, s);
-            }
-        }
+    // ADI bezel: rim, top index & aircraft symbol
+    {
+        m_adiBezel = makeLayer(s, s, dpr);
 
-        // draw marker
-        int     markerSize = m_size/20;
-        float   fx1, fy1, fx2, fy2, fx3, fy3;
+        QPainter painter(&m_adiBezel);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.translate(s/2.0, s/2.0);
 
-        painter.setBrush(QBrush(Qt::red));
-        painter.setPen(Qt::NoPen);
+        painter.setPen(blackPen);
+        painter.setBrush(Qt::NoBrush);
+        painter.drawEllipse(-r, -r, d, d);
 
-        fx1 = markerSize;
-        fy1 = 0;
-        fx2 = fx1 + markerSize;
-        fy2 = -markerSize/2;
-        fx3 = fx1 + markerSize;
-        fy3 = markerSize/2;
+        int m = qMax(3, s/16);
 
-        QPointF points[3] = {
-            QPointF(fx1, fy1),
-            QPointF(fx2, fy2),
-            QPointF(fx3, fy3)
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(Qt::black);
+        QPointF pointsIdx[3] = {
+            QPointF(0, -r),
+            QPointF(-m/2.0, -r + m),
+            QPointF( m/2.0, -r + m)
         };
-        painter.drawPolygon(points, 3);
+        painter.drawPolygon(pointsIdx, 3);
 
-        QPointF points2[3] = {
-            QPointF(-fx1, fy1),
-            QPointF(-fx2, fy2),
-            QPointF(-fx3, fy3)
-        };
-        painter.drawPolygon(points2, 3);
+        painter.setBrush(Qt::red);
+        painter.drawRect(QRectF(-r/2.0, -1, r/3.0, 2));
+        painter.drawRect(QRectF( r/6.0, -1, r/3.0, 2));
+        painter.drawEllipse(QPointF(0, 0), 2, 2);
     }
 
-    // draw roll degree lines
+    // compass dial: background, ticks every 30 deg & N mark
     {
-        int     nRollLines = 36;
-        float   rotAng = 360.0 / nRollLines;
-        int     rollLineLeng = m_size/25;
-        double  fx1, fy1, fx2, fy2;
-        int     fontSize = 8;
-        QString s;
+        m_compassDial = makeLayer(s, s, dpr);
+
+        QPainter painter(&m_compassDial);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.translate(s/2.0, s/2.0);
 
-        blackPen.setWidth(1);
         painter.setPen(blackPen);
-        painter.setFont(QFont("", fontSize));
+        painter.setBrush(QColor(48,172,220));
+        painter.drawEllipse(-r, -r, d, d);
 
-        for(int i=0; i<nRollLines; i++) {
-            if( i < nRollLines/2 )
-                s = QString("%1").arg(-i*rotAng);
-            else
-                s = QString("%1").arg(360-i*rotAng);
+        QVector<QLineF> ticks;
 
-            fx1 = 0;
-            fy1 = -m_size/2 + m_offset;
-            fx2 = 0;
+        for(int i=0; i<36; i+=3)
+            ticks.append(ringTick(i, r - 1, d/10.0, -1));
 
-            if( i % 3 == 0 ) {
-                fy2 = fy1 + rollLineLeng;
-                painter.drawLine(QPointF(fx1, fy1), QPointF(fx2, fy2));
+        painter.setPen(QPen(Qt::black, 1));
+        painter.drawLines(ticks);
 
-                fy2 = fy1 + rollLineLeng+2;
-                painter.drawText(QRectF(-50, fy2, 100, fontSize+2),
-                                 Qt::AlignCenter, s);
-            } else {
-                fy2 = fy1 + rollLineLeng/2;
-                painter.drawLine(QPointF(fx1, fy1), QPointF(fx2, fy2));
-            }
+        painter.setPen(Qt::blue);
+        painter.setFont(QFont("", qMax(6, s/10)));
+        painter.drawText(QRectF(-r/2.0, -r + d/10.0, r, s/8.0 + 4),
+                         Qt::AlignCenter, "N");
+    }
 
-            painter.rotate(rotAng);
-        }
+    m_cellClip = QPainterPath();
+    m_cellClip.addEllipse(QPointF(0, 0), r, r);
+
+    m_artSize = m_cellSize;
+    m_artDpr  = dpr;
+}
+
+void QInstrumentGrid::paintCell(QPainter &painter, int i, const QRect &rc)
+{
+    int     s  = m_cellSize;
+    int     d  = s - 4;
+    int     r  = d / 2;
+    qreal   cx = rc.x() + s/2.0;
+    qreal   cy = rc.y() + s/2.0;
+
+    painter.fillRect(rc, palette().window());
+
+    // attitude: rotated sky/ground strip clipped to the disc
+    {
+        painter.setTransform(QTransform::fromTranslate(cx, cy).rotate(m_roll[i]));
+        painter.setClipPath(m_cellClip);
+        painter.drawImage(QPointF(-r, r*m_pitch[i]/45.0 - 3*d/2), m_skyLayer);
+        painter.setClipping(false);
+        painter.resetTransform();
+
+        painter.drawImage(QPointF(rc.x(), rc.y()), m_adiBezel);
     }
 
-    // draw roll marker
+    // heading: dial & needle
     {
-        int     rollMarkerSize = m_size/25;
-        double  fx1, fy1, fx2, fy2, fx3, fy3;
+        int m = s/8;
 
-        painter.rotate(-m_roll);
-        painter.setBrush(QBrush(Qt::black));
+        painter.drawImage(QPointF(rc.x() + s, rc.y()), m_compassDial);
 
-        fx1 = 0;
-        fy1 = -m_size/2 + m_offset;
-        fx2 = fx1 - rollMarkerSize/2;
-        fy2 = fy1 + rollMarkerSize;
-        fx3 = fx1 + rollMarkerSize/2;
-        fy3 = fy1 + rollMarkerSize;
+        painter.setTransform(QTransform::fromTranslate(cx + s, cy).rotate(-m_yaw[i]));
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QColor(0xFF, 0x00, 0x00, 0xE0));
 
         QPointF points[3] = {
-            QPointF(fx1, fy1),
-            QPointF(fx2, fy2),
-            QPointF(fx3, fy3)
+            QPointF(0, -r + 2),
+            QPointF(-m/2.0, r/3.0),
+            QPointF( m/2.0, r/3.0)
         };
         painter.drawPolygon(points, 3);
+        painter.resetTransform();
     }
+
+    // vehicle index
+    painter.setPen(Qt::black);
+    painter.drawStaticText(rc.topLeft() + QPoint(1, 0), m_labels[i]);
 }
 
-void QADI::keyPressEvent(QKeyEvent *event)
+void QInstrumentGrid::paintEvent(QPaintEvent *event)
 {
-    switch (event->key()) {
-    case Qt::Key_Left:
-        m_roll -= 1.0;
-        break;
-    case Qt::Key_Right:
-        m_roll += 1.0;
-        break;
-    case Qt::Key_Down:
-        if(m_pitch>-90.)
-            m_pitch -=1.0;
-        break;
-    case Qt::Key_Up:
-        if(m_pitch<90.)
-            m_pitch +=1.0;
-        break;
-    default:
-        QWidget::keyPressEvent(event);
-        break;
-    }
-
-    update();
-}
+    if( m_artSize != m_cellSize || m_artDpr != widgetDpr(this) )
+        buildArtwork();
 
+    QPainter        painter(this);
+    const QRegion   &rgn = event->region();
+    const QRect     br = event->rect();
 
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
+    int     cw = 2*m_cellSize, ch = m_cellSize;
+    int     n  = m_roll.size();
+    int     rows = (n + m_cols - 1) / m_cols;
 
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.setFont(m_labelFont);
 
-QCompass::QCompass(QWidget *parent)
-    : QWidget(parent)
-{
-    connect(this, SIGNAL(canvasReplot(void)), this, SLOT(canvasReplot_slot(void)));
+    // only cells in the exposed region are painted
+    int c0 = br.left() / cw, c1 = qMin(m_cols - 1, br.right() / cw);
+    int r0 = br.top() / ch,  r1 = qMin(rows - 1, br.bottom() / ch);
 
-    m_sizeMin = 200;
-    m_sizeMax = 600;
-    m_offset = 2;
-    m_size = m_sizeMin - 2*m_offset;
+    for(int row=r0; row<=r1; row++) {
+        for(int col=c0; col<=c1; col++) {
+            int     i  = row*m_cols + col;
+            QRect   rc(col*cw, row*ch, cw, ch);
 
-    setMinimumSize(m_sizeMin, m_sizeMin);
-    setMaximumSize(m_sizeMax, m_sizeMax);
-    resize(m_sizeMin, m_sizeMin);
+            if( !rgn.intersects(rc) ) continue;
 
-    setFocusPolicy(Qt::NoFocus);
+            if( i < n ) {
+                paintCell(painter, i, rc);
+                m_dirty[i] = 0;
+            } else {
+                painter.fillRect(rc, palette().window());
+            }
+        }
+    }
 
-    m_yaw  = 0.0;
-    m_alt  = 0.0;
-    m_h    = 0.0;
+    // area outside of the cells
+    QRegion rest = rgn - QRegion(0, 0, m_cols*cw, rows*ch);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    for(const QRect &rc : rest)
+        painter.fillRect(rc, palette().window());
+#else
+    const QVector<QRect> rects = rest.rects();
+    for(const QRect &rc : rects)
+        painter.fillRect(rc, palette().window());
+#endif
 }
 
-QCompass::~QCompass()
-{
 
-}
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
 
 
-void QCompass::canvasReplot_slot(void)
+QTelemetryQueue::QTelemetryQueue(QObject *parent)
+    : QObject(parent)
 {
-    update();
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setInterval(qRound(1000.0/QInstrumentScheduler::instance()->getTargetRate()));
+    connect(m_timer, SIGNAL(timeout(void)), this, SLOT(drain_slot(void)));
+    m_timer->start();
 }
 
-void QCompass::resizeEvent(QResizeEvent *event)
+QTelemetryQueue::~QTelemetryQueue()
 {
-    m_size = qMin(width(),height()) - 2*m_offset;
+
 }
 
-void QCompass::paintEvent(QPaintEvent *)
+qint64 QTelemetryQueue::now(void)
 {
-    QPainter painter(this);
-
-    QBrush bgGround(QColor(48,172,220));
-
-    QPen   whitePen(Qt::white);
-    QPen   blackPen(Qt::black);
-    QPen   redPen(Qt::red);
-    QPen   bluePen(Qt::blue);
-    QPen   greenPen(Qt::green);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-    whitePen.setWidth(1);
-    blackPen.setWidth(2);
-    redPen.setWidth(2);
-    bluePen.setWidth(2);
-    greenPen.setWidth(2);
+int QTelemetryQueue::drain(void)
+{
+    QTelemetrySample    s;
+    int                 n = 0;
+
+    // every sample goes to the instruments' history, they interpolate
+    while( m_ring.pop(s) ) {
+        switch( s.type ) {
+        case QTelemetrySample::ATTITUDE:
+            if( m_adi ) m_adi->addSample(s.t, s.v[0], s.v[1]);
+            break;
+        case QTelemetrySample::HEADING:
+            if( m_compass ) m_compass->addYawSample(s.t, s.v[0]);
+            break;
+        case QTelemetrySample::ALTITUDE:
+            if( m_compass ) m_compass->addAltSample(s.t, s.v[0], s.v[1]);
+            break;
+        }
 
-    painter.setRenderHint(QPainter::Antialiasing);
+        n++;
+    }
 
-    painter.translate(width() / 2, height() / 2);
+    return n;
+}
 
+void QTelemetryQueue::drain_slot(void)
+{
+    drain();
+}
 
-    // draw background
-    {
-        painter.setPen(blackPen);
-        painter.setBrush(bgGround);
 
-        painter.drawEllipse(-m_size/2, -m_size/2, m_size, m_size);
-    }
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
 
 
-    // draw yaw lines
-    {
-        int     nyawLines = 36;
-        float   rotAng = 360.0 / nyawLines;
-        int     yawLineLeng = m_size/25;
-        double  fx1, fy1, fx2, fy2;
-        int     fontSize = 8;
-        QString s;
+QKeyValueModel::QKeyValueModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    m_font = QFont("", 8);
+}
 
-        blackPen.setWidth(1);
-        painter.setPen(blackPen);
+QKeyValueModel::~QKeyValueModel()
+{
 
-        for(int i=0; i<nyawLines; i++) {
+}
 
-            if( i == 0 ) {
-                s = "N";
-                painter.setPen(bluePen);
+int QKeyValueModel::findOrInsert(const QString &key)
+{
+    QHash<QString, int>::const_iterator it = m_index.constFind(key);
+    if( it != m_index.constEnd() ) return it.value();
+
+    // keep rows sorted by key (same order as ListMap)
+    int row = 0, hi = m_entries.size();
+    while( row < hi ) {
+        int mid = (row + hi) / 2;
+        if( m_entries[mid].key < key ) row = mid + 1;
+        else                           hi  = mid;
+    }
 
-                painter.setFont(QFont("", fontSize*1.3));
-            } else if ( i == 9 ) {
-                s = "W";
-                painter.setPen(blackPen);
+    Entry e;
+    e.key  = key;
+    e.type = Entry::STRING;
+    e.d    = 0;
+    e.i    = 0;
 
-                painter.setFont(QFont("", fontSize*1.3));
-            } else if ( i == 18 ) {
-                s = "S";
-                painter.setPen(redPen);
+    beginInsertRows(QModelIndex(), row, row);
+    m_entries.insert(row, e);
+    for(int i=row; i<m_entries.size(); i++) m_index[m_entries[i].key] = i;
+    endInsertRows();
 
-                painter.setFont(QFont("", fontSize*1.3));
-            } else if ( i == 27 ) {
-                s = "E";
-                painter.setPen(blackPen);
+    return row;
+}
 
-                painter.setFont(QFont("", fontSize*1.3));
-            } else {
-                s = QString("%1").arg(i*rotAng);
-                painter.setPen(blackPen);
+void QKeyValueModel::valueChanged(int row)
+{
+    QModelIndex idx = index(row, 1);
+    emit dataChanged(idx, idx);
+}
 
-                painter.setFont(QFont("", fontSize));
-            }
+void QKeyValueModel::setValue(const QString &key, double v)
+{
+    int     row = findOrInsert(key);
+    Entry   &e  = m_entries[row];
 
-            fx1 = 0;
-            fy1 = -m_size/2 + m_offset;
-            fx2 = 0;
+    if( e.type == Entry::DOUBLE && e.d == v ) return;
 
-            if( i % 3 == 0 ) {
-                fy2 = fy1 + yawLineLeng;
-                painter.drawLine(QPointF(fx1, fy1), QPointF(fx2, fy2));
+    e.type = Entry::DOUBLE;
+    e.d    = v;
+    valueChanged(row);
+}
 
-                fy2 = fy1 + yawLineLeng+4;
-                painter.drawText(QRectF(-50, fy2, 100, fontSize+2),
-                                 Qt::AlignCenter, s);
-            } else {
-                fy2 = fy1 + yawLineLeng/2;
-                painter.drawLine(QPointF(fx1, fy1), QPointF(fx2, fy2));
-            }
+void QKeyValueModel::setValue(const QString &key, int v)
+{
+    int     row = findOrInsert(key);
+    Entry   &e  = m_entries[row];
 
-            painter.rotate(-rotAng);
-        }
-    }
+    if( e.type == Entry::INT && e.i == v ) return;
 
-    // draw S/N arrow
-    {
-        int     arrowWidth = m_size/5;
-        double  fx1, fy1, fx2, fy2, fx3, fy3;
+    e.type = Entry::INT;
+    e.i    = v;
+    valueChanged(row);
+}
 
-        fx1 = 0;
-        fy1 = -m_size/2 + m_offset + m_size/25 + 15;
-        fx2 = -arrowWidth/2;
-        fy2 = 0;
-        fx3 = arrowWidth/2;
-        fy3 = 0;
+void QKeyValueModel::setValue(const QString &key, const QString &v)
+{
+    int     row = findOrInsert(key);
+    Entry   &e  = m_entries[row];
 
-        painter.setPen(Qt::NoPen);
+    if( e.type == Entry::STRING && e.s == v ) return;
 
-        painter.setBrush(QBrush(Qt::blue));
-        QPointF pointsN[3] = {
-            QPointF(fx1, fy1),
-            QPointF(fx2, fy2),
-            QPointF(fx3, fy3)
-        };
-        painter.drawPolygon(pointsN, 3);
+    e.type = Entry::STRING;
+    e.s    = v;
+    valueChanged(row);
+}
 
+void QKeyValueModel::removeKey(const QString &key)
+{
+    QHash<QString, int>::iterator it = m_index.find(key);
+    if( it == m_index.end() ) return;
 
-        fx1 = 0;
-        fy1 = m_size/2 - m_offset - m_size/25 - 15;
-        fx2 = -arrowWidth/2;
-        fy2 = 0;
-        fx3 = arrowWidth/2;
-        fy3 = 0;
+    int row = it.value();
 
-        painter.setBrush(QBrush(Qt::red));
-        QPointF pointsS[3] = {
-            QPointF(fx1, fy1),
-            QPointF(fx2, fy2),
-            QPointF(fx3, fy3)
-        };
-        painter.drawPolygon(pointsS, 3);
-    }
+    beginRemoveRows(QModelIndex(), row, row);
+    m_index.erase(it);
+    m_entries.remove(row);
+    for(int i=row; i<m_entries.size(); i++) m_index[m_entries[i].key] = i;
+    endRemoveRows();
+}
 
+QStringList QKeyValueModel::keys(void) const
+{
+    QStringList k;
 
-    // draw yaw marker
-    {
-        int     yawMarkerSize = m_size/12;
-        double  fx1, fy1, fx2, fy2, fx3, fy3;
+    for(int i=0; i<m_entries.size(); i++) k.append(m_entries[i].key);
 
-        painter.rotate(-m_yaw);
-        painter.setBrush(QBrush(QColor(0xFF, 0x00, 0x00, 0xE0)));
+    return k;
+}
 
-        fx1 = 0;
-        fy1 = -m_size/2 + m_offset;
-        fx2 = fx1 - yawMarkerSize/2;
-        fy2 = fy1 + yawMarkerSize;
-        fx3 = fx1 + yawMarkerSize/2;
-        fy3 = fy1 + yawMarkerSize;
+int QKeyValueModel::rowCount(const QModelIndex &parent) const
+{
+    if( parent.isValid() ) return 0;
+    return m_entries.size();
+}
 
-        QPointF points[3] = {
-            QPointF(fx1, fy1),
-            QPointF(fx2, fy2),
-            QPointF(fx3, fy3)
-        };
-        painter.drawPolygon(points, 3);
+int QKeyValueModel::columnCount(const QModelIndex &parent) const
+{
+    if( parent.isValid() ) return 0;
+    return 2;
+}
 
-        painter.rotate(m_yaw);
-    }
+QVariant QKeyValueModel::data(const QModelIndex &index, int role) const
+{
+    if( !index.isValid() || index.row() >= m_entries.size() ) return QVariant();
 
-    // draw altitude
-    {
-        int     altFontSize = 13;
-        int     fx, fy, w, h;
-        QString s;
-        char    buf[200];
+    const Entry &e = m_entries[index.row()];
 
-        w  = 130;
-        h  = 2*(altFontSize + 8);
-        fx = -w/2;
-        fy = -h/2;
+    switch( role ) {
+    case Qt::DisplayRole:
+        if( index.column() == 0 ) return e.key;
 
-        blackPen.setWidth(2);
-        painter.setPen(blackPen);
-        painter.setBrush(QBrush(Qt::white));
-        painter.setFont(QFont("", altFontSize));
+        // values are formatted only when a (visible) cell is painted
+        if( e.type == Entry::DOUBLE ) return QString::number(e.d);
+        if( e.type == Entry::INT )    return QString::number(e.i);
+        return e.s;
 
-        painter.drawRoundedRect(fx, fy, w, h, 6, 6);
+    case Qt::ForegroundRole:
+        if( index.column() == 0 ) return QColor(0x00, 0x00, 0xFF);
+        return QColor(0x00, 0x00, 0x00);
 
-        painter.setPen(bluePen);
-        sprintf(buf, "ALT: %6.1f m", m_alt);
-        s = buf;
-        painter.drawText(QRectF(fx, fy+2, w, h/2), Qt::AlignCenter, s);
+    case Qt::BackgroundRole:
+        if( index.row() % 2 == 0 ) return QColor(0xFF, 0xFF, 0xFF);
+        return QColor(0xE0, 0xE0, 0xE0);
 
-        sprintf(buf, "H: %6.1f m", m_h);
-        s = buf;
-        painter.drawText(QRectF(fx, fy+h/2, w, h/2), Qt::AlignCenter, s);
+    case Qt::FontRole:
+        return m_font;
     }
+
+    return QVariant();
 }
 
-void QCompass::keyPressEvent(QKeyEvent *event)
+QVariant QKeyValueModel::headerData(int section, Qt::Orientation orientation,
+                                    int role) const
 {
-    switch (event->key()) {
-    case Qt::Key_Left:
-        m_yaw -= 1.0;
-        break;
-    case Qt::Key_Right:
-        m_yaw += 1.0;
-        break;
-    case Qt::Key_Down:
-        m_alt -= 1.0;
-        break;
-    case Qt::Key_Up:
-        m_alt += 1.0;
-        break;
-    case Qt::Key_W:
-        m_h += 1.0;
-        break;
-    case Qt::Key_S:
-        m_h -= 1.0;
-        break;
+    if( role != Qt::DisplayRole ) return QVariant();
 
-    default:
-        QWidget::keyPressEvent(event);
-        break;
+    if( orientation == Qt::Horizontal ) {
+        if( section == 0 ) return QString("Name");
+        if( section == 1 ) return QString("Value");
+        return QVariant();
     }
 
-    update();
+    return section + 1;
 }
 
 
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-
-
-QKeyValueListView::QKeyValueListView(QWidget *parent) : QTableWidget(parent)
+QKeyValueListView::QKeyValueListView(QWidget *parent) : QTableView(parent)
 {
     connect(this, SIGNAL(listUpdate(void)), this, SLOT(listUpdate_slot(void)));
 
     m_mutex = new QMutex();
 
-    // set row & column numbers
-    setRowCount(0);
-    setColumnCount(2);
+    m_model = new QKeyValueModel(this);
+    setModel(m_model);
 
     // set no headers
     //verticalHeader()->hide();
     //horizontalHeader()->hide();
-    QStringList htb = {"Name", "Value"};
-    this->setHorizontalHeaderLabels(htb);
+
+    // fixed row height, no per-row sizing
+    QHeaderView *VertHdr = verticalHeader();
+    VertHdr->setSectionResizeMode(QHeaderView::Fixed);
+    VertHdr->setDefaultSectionSize(20);
 
     // set last section is stretch-able
     QHeaderView *HorzHdr = horizontalHeader();
@@ -562,72 +3895,115 @@ QKeyValueListView::QKeyValueListView(QWidget *parent) : QTableWidget(parent)
     HorzHdr->resizeSection(0, 80);     // set first column width
 
     // disable table edit & focus
-    setEditTriggers(QTableWidget::NoEditTriggers);
+    setEditTriggers(QTableView::NoEditTriggers);
     setFocusPolicy(Qt::NoFocus);
+
+    m_stats = NULL;
+    m_hud   = false;
+
+    m_hudTimer = new QTimer(this);
+    m_hudTimer->setSingleShot(true);
+    m_hudTimer->setTimerType(Qt::PreciseTimer);
+    m_hudTimer->setInterval(1000);
+    connect(m_hudTimer, SIGNAL(timeout(void)), this, SLOT(hudRefresh_slot(void)));
 }
 
 QKeyValueListView::~QKeyValueListView()
 {
     delete m_mutex;
+    delete m_stats;
 }
 
-void QKeyValueListView::listUpdate_slot(void)
+void QKeyValueListView::setStatsEnabled(bool on)
 {
-    int                 i, n;
-    ListMap::iterator   it;
+    if( on == (m_stats != NULL) ) return;
+
+    if( on ) {
+        m_stats = new QPaintStats();
+    } else {
+        delete m_stats;
+        m_stats = NULL;
+        m_hud   = false;
+    }
 
-    QColor              clCL1, clCL2;
-    QColor              clB1, clB2;
+    viewport()->update();
+}
 
-    int                 fontSize = 8;
-    int                 rowHeight = 20;
+void QKeyValueListView::setHudVisible(bool on)
+{
+    if( on ) setStatsEnabled(true);
 
-    clCL1 = QColor(0x00, 0x00, 0xFF);
-    clCL2 = QColor(0x00, 0x00, 0x00);
-    clB1  = QColor(0xFF, 0xFF, 0xFF);
-    clB2  = QColor(0xE0, 0xE0, 0xE0);
+    m_hud = on;
+    viewport()->update();
+}
 
-    m_mutex->lock();
+void QKeyValueListView::valueChanged(void)
+{
+    m_stats->addRequest();
 
-    n = m_data.size();
-    setRowCount(n);
-    setColumnCount(2);
+    // only the changed rows are repainted, the overlay must be too
+    if( m_hud ) viewport()->update(QPaintStats::hudRect());
+}
 
-    for(i=0, it=m_data.begin(); it!=m_data.end(); i++, it++) {
-        // set name cell
-        if( this->item(i, 0) != NULL ) {
-            this->item(i, 0)->setText(it.key());
-        } else {
-            QTableWidgetItem* item = new QTableWidgetItem();
-            item->setText(it.key());
+void QKeyValueListView::paintEvent(QPaintEvent *event)
+{
+    if( !m_stats ) {
+        QTableView::paintEvent(event);
+        return;
+    }
 
-            item->setTextColor(clCL1);
-            if( i % 2 == 0 ) item->setBackgroundColor(clB1);
-            else             item->setBackgroundColor(clB2);
+    qint64  t0 = QTelemetryQueue::now();
 
-            item->setFont(QFont("", fontSize));
+    QTableView::paintEvent(event);
 
-            this->setItem(i, 0, item);
-        }
+    m_stats->addPaint(t0, QTelemetryQueue::now());
 
-        // set value cell
-        if( this->item(i, 1) != NULL ) {
-            this->item(i, 1)->setText(it.value());
-        } else {
-            QTableWidgetItem* item = new QTableWidgetItem();
-            item->setText(it.value());
+    if( m_hud ) {
+        QPainter painter(viewport());
+        m_stats->drawHud(painter);
+
+        // show the rate drop to 0 if no paint follows within a second
+        if( m_stats->getFps() > 0 ) m_hudTimer->start();
+    }
+}
+
+void QKeyValueListView::scrollContentsBy(int dx, int dy)
+{
+    QTableView::scrollContentsBy(dx, dy);
 
-            item->setTextColor(clCL2);
-            if( i % 2 == 0 ) item->setBackgroundColor(clB1);
-            else             item->setBackgroundColor(clB2);
+    // the viewport scroll copied the overlay along with the rows, repaint
+    // both the copy and the overlay's fixed place
+    if( m_hud ) {
+        QRect rc = QPaintStats::hudRect();
+        viewport()->update(QRegion(rc) + rc.translated(dx, dy));
+    }
+}
 
-            item->setFont(QFont("", fontSize));
+void QKeyValueListView::hudRefresh_slot(void)
+{
+    if( m_hud ) viewport()->update(QPaintStats::hudRect());
+}
 
-            this->setItem(i, 1, item);
-        }
+void QKeyValueListView::listUpdate_slot(void)
+{
+    ListMap::iterator   it;
+    QSet<QString>       keys;
+
+    m_mutex->lock();
+
+    // remove keys dropped from the map (typed setValue() keys stay)
+    for(const QString &key : m_dataKeys) {
+        if( !m_data.contains(key) ) m_model->removeKey(key);
+    }
 
-        setRowHeight(i, rowHeight);
+    // the model only emits dataChanged for values which differ
+    for(it=m_data.begin(); it!=m_data.end(); it++) {
+        m_model->setValue(it.key(), it.value());
+        keys.insert(it.key());
     }
+    m_dataKeys = keys;
 
     m_mutex->unlock();
+
+    if( m_stats ) valueChanged();
 }
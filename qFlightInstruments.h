@@ -1,198 +1,2369 @@
 #ifndef __QFLIGHTINSTRUMENTS_H__
 #define __QFLIGHTINSTRUMENTS_H__
 
+#include <cmath>
+
 #include <QtCore>
 #include <QtGui>
 #include <QWidget>
 #include <QMap>
-#include <QTableWidget>
+#include <QTableView>
+
+///
+/// \brief Relaxed atomic load/store (load()/store() are deprecated in Qt 5.14)
+///
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+template<typename T> inline T atomicLoad(const QAtomicInteger<T> &a)      { return a.loadRelaxed(); }
+template<typename T> inline void atomicStore(QAtomicInteger<T> &a, typename QAtomicInteger<T>::Type v)  { a.storeRelaxed(v); }
+#else
+template<typename T> inline T atomicLoad(const QAtomicInteger<T> &a)      { return a.load(); }
+template<typename T> inline void atomicStore(QAtomicInteger<T> &a, typename QAtomicInteger<T>::Type v)  { a.store(v); }
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Display-rate repaint scheduler shared by all instruments
+///
+///     Instruments register themselves and only mark their state dirty in
+///     the setters. The scheduler issues at most one update() per widget
+///     per display frame at the target rate; the first request after an
+///     idle period is served immediately.
+///
+class QInstrumentScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    ///
+    /// \brief Get the process-wide scheduler (GUI thread only)
+    ///
+    static QInstrumentScheduler* instance(void);
+
+    ///
+    /// \brief Get the scheduler if it exists, without creating it
+    ///     (for destructors which may run after application teardown)
+    /// \return scheduler or NULL
+    ///
+    static QInstrumentScheduler* existingInstance(void) {return s_instance;}
+
+    void registerWidget(QWidget *w);
+    void unregisterWidget(QWidget *w);
+
+    ///
+    /// \brief Mark a widget's state dirty, it will be repainted next frame
+    /// \param w - registered widget
+    ///
+    void markDirty(QWidget *w);
+
+    ///
+    /// \brief Mark part of a widget dirty, only that part is repainted
+    /// \param w - registered widget
+    /// \param r - dirty region (in widget coordinates)
+    ///
+    void markDirty(QWidget *w, const QRegion &r);
+
+    ///
+    /// \brief Set target display rate
+    /// \param hz - frames per second (default 60)
+    ///
+    void setTargetRate(double hz);
+
+    ///
+    /// \brief Get target display rate
+    /// \return frames per second
+    ///
+    double getTargetRate(void) {return m_rate;}
+
+    quint64 getRequestCount(void) {return m_nRequest;}  ///< markDirty() calls
+    quint64 getRepaintCount(void) {return m_nRepaint;}  ///< issued update() calls
+    quint64 getMergedCount(void)  {return m_nMerged;}   ///< requests merged into a pending frame
+    quint64 getDroppedCount(void) {return m_nDropped;}  ///< dirty frames dropped (widget hidden)
+    void    resetCounters(void);
+
+protected slots:
+    void frameTick_slot(void);
+
+protected:
+    QInstrumentScheduler(QObject *parent = 0);
+
+    struct DirtyState {
+        bool        dirty;                      ///< pending repaint in this frame
+        bool        full;                       ///< whole widget is dirty
+        QRegion     region;                     ///< dirty part if not full
+    };
+
+    void addDirty(QWidget *w, const QRegion *r);
+
+protected:
+    QTimer                  *m_timer;           ///< frame timer (runs only while dirty)
+    double                  m_rate;             ///< target rate (in Hz)
+
+    QHash<QWidget*, DirtyState> m_widgets;      ///< registered widgets & dirty state
+    QVector<QWidget*>       m_dirtyList;        ///< widgets dirty in this frame
+
+    quint64                 m_nRequest, m_nRepaint, m_nMerged, m_nDropped;
+
+    static QPointer<QInstrumentScheduler>       s_instance;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Lock-free histogram of durations (in ns)
+///
+///     Log-linear buckets: 8 per power of two, i.e. values are kept with
+///     about 12% resolution from 1 ns to ~100 s. Any thread may add or read.
+///
+class QPaintHistogram
+{
+public:
+    enum {
+        SUB_BITS    = 3,                        ///< 2^SUB_BITS buckets per power of two
+        SUB         = 1 << SUB_BITS,
+        BUCKETS     = (38 - SUB_BITS) * SUB
+    };
+
+    QPaintHistogram() {}
+
+    ///
+    /// \brief Add a duration
+    /// \param ns - duration (in ns)
+    ///
+    void add(qint64 ns) {
+        int b = bucket(ns);
+
+        m_bins[b].fetchAndAddRelaxed(1);
+        m_count.fetchAndAddRelaxed(1);
+        m_sum.fetchAndAddRelaxed(ns);
+
+        qint64 m = atomicLoad(m_max);
+        while( ns > m && !m_max.testAndSetRelaxed(m, ns) ) m = atomicLoad(m_max);
+    }
+
+    ///
+    /// \brief Get a percentile
+    /// \param p - percentile (0..100)
+    /// \return duration (in ns, bucket center), 0 if empty
+    ///
+    qint64 percentile(double p) const;
+
+    qint64  getMax(void) const      { return atomicLoad(m_max); }
+    quint64 getCount(void) const    { return atomicLoad(m_count); }
+    double  getMean(void) const     { quint64 n = atomicLoad(m_count); return n ? (double) atomicLoad(m_sum) / n : 0; }
+
+    void reset(void);
+
+protected:
+    static int bucket(qint64 ns);
+    static qint64 bucketValue(int b);
+
+protected:
+    QAtomicInt              m_bins[BUCKETS];
+    QAtomicInteger<quint64> m_count;
+    QAtomicInteger<qint64>  m_sum;
+    QAtomicInteger<qint64>  m_max;
+};
+
+///
+/// \brief Paint statistics of one widget
+///
+///     Paint durations & inter-frame intervals go to lock-free histograms,
+///     update requests and paints are counted. A widget only keeps a
+///     QPaintStats while statistics are enabled, so the disabled cost is a
+///     pointer test.
+///
+class QPaintStats
+{
+public:
+    QPaintStats();
+
+    ///
+    /// \brief Count an update request (markDirty / value change)
+    ///
+    void addRequest(void) { m_requests.fetchAndAddRelaxed(1); }
+
+    ///
+    /// \brief Record a paint
+    /// \param t0 - paint start (QTelemetryQueue::now())
+    /// \param t1 - paint end
+    ///
+    void addPaint(qint64 t0, qint64 t1);
+
+    const QPaintHistogram& getPaintTime(void) const     { return m_paintTime; }
+    const QPaintHistogram& getFrameInterval(void) const { return m_interval; }
+
+    quint64 getRequestCount(void) const { return atomicLoad(m_requests); }
+    quint64 getPaintCount(void) const   { return m_paintTime.getCount(); }
+
+    ///
+    /// \brief Paints per second over the last full second, a paint after
+    ///     a second without paints starts over at 0
+    ///
+    double getFps(void) const { return m_fps; }
+
+    void reset(void);
+
+    ///
+    /// \brief Draw the statistics overlay (top-left corner of the widget)
+    ///
+    void drawHud(QPainter &painter) const;
+
+    ///
+    /// \brief Area covered by the overlay (in widget coordinates)
+    ///
+    static QRect hudRect(void) { return QRect(2, 2, 178, 46); }
+
+protected:
+    QPaintHistogram         m_paintTime;        ///< paint durations
+    QPaintHistogram         m_interval;         ///< paint start to paint start
+    QAtomicInteger<quint64> m_requests;
+
+    qint64                  m_lastPaint;        ///< start of the last paint
+    qint64                  m_fpsStart;         ///< start of the fps window
+    int                     m_fpsPaints;        ///< paints in the fps window
+    double                  m_fps;
+};
+
+///
+/// \brief Paint quality governor of one instrument
+///
+///     Compares the smoothed paint time with a frame budget. Over budget it
+///     steps the quality down one level at a time, with headroom (below half
+///     the budget for a while) it steps back up. Stepping down again right
+///     after a step up doubles the headroom required for the next try, so a
+///     level at the edge of the budget does not flicker. When the motion
+///     settles the owner calls settle() to restore full quality.
+///
+class QQualityGovernor
+{
+public:
+    enum Level {
+        LEVEL_FULL = 0,                         ///< as configured
+        LEVEL_NO_AA,                            ///< no antialiasing
+        LEVEL_NO_MINOR,                         ///< + no minor ticks, only cardinal labels
+        LEVEL_LOW_RES,                          ///< + cached layers at half resolution
+        LEVEL_NUM
+    };
+
+    QQualityGovernor();
+
+    ///
+    /// \brief Set paint time budget of a frame
+    /// \param ms - budget (in ms, 0: governor off, always full quality)
+    ///
+    void setBudget(double ms);
+    double getBudget(void) const { return m_budget/1e6; }
+
+    bool isEnabled(void) const { return m_budget > 0; }
+
+    ///
+    /// \brief Account the paint (or render) time of a frame
+    /// \return true if the level changed
+    ///
+    bool addPaint(qint64 ns);
+
+    ///
+    /// \brief Motion settled: back to full quality
+    /// \return true if the level changed
+    ///
+    bool settle(void);
+
+    int getLevel(void) const { return m_level; }
+
+    ///
+    /// \brief Time without paints after which the motion counts as settled (in ms)
+    ///
+    static int settleTime(void) { return 250; }
+
+protected:
+    bool setLevel(int level);
+
+protected:
+    qint64  m_budget;                           ///< budget (in ns)
+    double  m_avg;                              ///< smoothed paint time (in ns)
+    int     m_level;
+    int     m_samples;                          ///< paints at this level (-1: skip the next)
+    int     m_headroom;                         ///< consecutive paints below half the budget
+    int     m_upDelay;                          ///< headroom paints needed to step up
+    bool    m_steppedUp;                        ///< last change was a step up
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Paint resources shared by all instruments of the same size
+///
+///     Pens, brushes, fonts, prepared static texts for all fixed labels and
+///     size dependent marker geometry. Entries are created once per size and
+///     never change, so widgets keep a pointer and paint without allocating.
+///     They are reference counted: a set nobody uses any more is kept among
+///     the last 8 idle sizes, older idle sets are freed.
+///
+struct QInstrumentResources
+{
+    int             size;                       ///< instrument size (m_size)
+
+    QPen            blackPen, blackPen1, whitePen1;
+    QPen            pitchPen, pitchZeroPen, bluePen, redPen;
+    QBrush          skyBrush, groundBrush, compassBrush;
+    QBrush          redBrush, blueBrush, blackBrush, whiteBrush, yawMarkerBrush;
+    QFont           labelFont;                  ///< tick labels (8 pt)
+    QFont           dirFont;                    ///< N/E/S/W (10 pt)
+    QFont           altFont;                    ///< ALT/H readout (13 pt)
+
+    QStaticText     pitchLabels[19];            ///< -90..90 step 10 (index i+9)
+    QStaticText     rollLabels[36];             ///< roll ring, every 10 deg
+    QStaticText     yawLabels[36];              ///< yaw ring, N/W/S/E at 0/9/18/27
+    QStaticText     altPrefix, hPrefix, unitSuffix;
+    QStaticText     glyphs[13];                 ///< "0".."9", ".", "-", " "
+    qreal           glyphWidth;                 ///< advance of one readout glyph
+
+    QPainterPath    adiClip;                    ///< ADI disc
+    QPolygonF       adiMarkerL, adiMarkerR;     ///< ADI aircraft markers
+    QPolygonF       rollMarker;                 ///< ADI roll marker
+    QPolygonF       yawMarker;                  ///< compass yaw marker
+    QRectF          altRect, hRect;             ///< compass readout lines (centered)
+    QRectF          altBox;                     ///< compass readout box (centered)
+
+    ///
+    /// \brief Get (or create) resources for an instrument size (thread-safe),
+    ///     each get() needs a release()
+    /// \param size - instrument size (in pixel)
+    ///
+    static const QInstrumentResources* get(int size);
+
+    ///
+    /// \brief Drop a reference taken by get() (NULL is ignored)
+    ///
+    static void release(const QInstrumentResources *res);
+
+    ///
+    /// \brief Create private resources (caller owns them), for renderers
+    ///     which paint on a worker thread
+    /// \param size - instrument size (in pixel)
+    ///
+    static QInstrumentResources* create(int size);
+
+    ///
+    /// \brief Allocation-free fixed-point formatting ("%*.*f", right aligned)
+    /// \param buf   - output buffer (at least 32 chars)
+    /// \param v     - value
+    /// \param width - minimum field width
+    /// \param prec  - digits after the decimal point (0..6)
+    /// \return number of chars written (without terminating 0)
+    ///
+    static int formatFixed(char *buf, double v, int width, int prec);
+
+    ///
+    /// \brief Draw a static text aligned in a rectangle (like drawText)
+    ///
+    void drawText(QPainter &painter, const QRectF &rc, int flags,
+                  const QStaticText &st) const;
+
+    ///
+    /// \brief Draw "<prefix>%6.1f<unit>" centered in rc without allocating
+    ///
+    void drawReadout(QPainter &painter, const QRectF &rc,
+                     const QStaticText &prefix, double v) const;
+
+protected:
+    QInstrumentResources(int size);
+};
+
+///
+/// \brief Process-wide cache of rasterized instrument artwork
+///
+///     Static layers (ADI pitch ladder & roll ring, compass dial, card &
+///     HSI overlay) are keyed by kind, instrument size, device pixel ratio
+///     and style, so all renderers of one size share a single raster, also
+///     across windows and render threads. Entries are implicitly shared
+///     QImages: an evicted layer lives on in the renderers still using it,
+///     the budget bounds what the cache itself keeps alive. Least recently
+///     used entries are evicted first.
+///
+class QArtworkCache
+{
+public:
+    enum Kind {
+        ADI_LADDER = 0,                         ///< pitch ladder strip
+        ADI_ROLL,                               ///< roll ring, ticks & rim
+        COMPASS_DIAL,                           ///< north-up dial
+        COMPASS_CARD,                           ///< heading-up card
+        COMPASS_HSI                             ///< heading-up fixed overlay
+    };
+
+    enum Style {
+        STYLE_AA    = 0x01,                     ///< antialiased
+        STYLE_MINOR = 0x02                      ///< minor ticks & all labels
+    };
+
+    ///
+    /// \brief Get the cache (created on first use, thread-safe)
+    ///
+    static QArtworkCache* instance(void);
+
+    ///
+    /// \brief Look up a layer (thread-safe)
+    /// \param img - out: the cached layer on a hit
+    /// \return true on a hit
+    ///
+    bool find(Kind kind, int size, qreal dpr, int style, QImage &img);
+
+    ///
+    /// \brief Add a layer (thread-safe), evicts the least recently used
+    ///     entries above the budget
+    ///
+    void insert(Kind kind, int size, qreal dpr, int style, const QImage &img);
+
+    ///
+    /// \brief Set memory budget (in bytes, default 32 MB, 0: keep nothing)
+    ///
+    void setBudget(int bytes);
+    int getBudget(void);
+
+    int getBytes(void);                         ///< bytes of the cached layers
+    int getCount(void);                         ///< number of cached layers
+
+    quint64 getHits(void);
+    quint64 getMisses(void);
+    quint64 getEvictions(void);
+
+    void clear(void);
+
+protected:
+    QArtworkCache();
+
+    struct Key {
+        int     kind, size, style;
+        qreal   dpr;
+
+        bool operator==(const Key &k) const {
+            return kind == k.kind && size == k.size && style == k.style && dpr == k.dpr;
+        }
+    };
+
+    friend uint qHash(const Key &k, uint seed) {
+        return qHash(k.dpr, seed) ^ (uint) (k.kind << 28 | k.style << 24 | k.size);
+    }
+
+protected:
+    QMutex                  m_mutex;
+    QCache<Key, QImage>     m_cache;            ///< cost: bytes
+    quint64                 m_hits, m_misses, m_evictions;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Short history of timestamped samples of one channel
+///
+///     value(t) interpolates between the samples around t, or extrapolates
+///     from the last two samples (at most maxExtrap past the newest one).
+///     With wrap > 0 the channel is circular (e.g. 360 for yaw).
+///
+class QSampleChannel
+{
+public:
+    QSampleChannel(double wrap = 0) : m_wrap(wrap), m_n(0), m_head(0) {}
+
+    void clear(void) { m_n = 0; }
+    bool isEmpty(void) const { return m_n == 0; }
+
+    ///
+    /// \brief Add a sample (older than the newest one are dropped)
+    /// \param t - time (in ns)
+    /// \param v - value
+    ///
+    void add(qint64 t, double v) {
+        if( m_n > 0 && t < m_t[m_head] ) return;
+
+        m_head = (m_head + 1) & (N-1);
+        m_t[m_head] = t;
+        m_v[m_head] = v;
+        if( m_n < N ) m_n++;
+    }
+
+    ///
+    /// \brief Time of the newest sample (in ns)
+    ///
+    qint64 lastTime(void) const { return m_n > 0 ? m_t[m_head] : 0; }
+
+    ///
+    /// \brief Value at time t
+    /// \param t         - time (in ns)
+    /// \param maxExtrap - maximum extrapolation (in ns)
+    ///
+    double value(qint64 t, qint64 maxExtrap) const {
+        int i1 = m_head, i0 = m_head;
+
+        if( m_n == 0 ) return 0;
+        if( m_n == 1 ) return m_v[i1];
+
+        if( t >= m_t[i1] ) {
+            // extrapolate from the last two samples
+            i0 = (i1 - 1) & (N-1);
+            if( t - m_t[i1] > maxExtrap ) t = m_t[i1] + maxExtrap;
+        } else {
+            // find the samples around t
+            int k;
+            for(k=1; k<m_n; k++) {
+                i0 = (i1 - 1) & (N-1);
+                if( m_t[i0] <= t ) break;
+                i1 = i0;
+            }
+            if( k == m_n ) return m_v[i1];
+        }
+
+        qint64 dt = m_t[i1] - m_t[i0];
+        if( dt <= 0 ) return m_v[i1];
+
+        return norm(m_v[i0] + diff(m_v[i1], m_v[i0]) * (double) (t - m_t[i0]) / dt);
+    }
+
+protected:
+    double diff(double a, double b) const {
+        double d = a - b;
+        if( m_wrap > 0 ) {
+            while( d >   m_wrap/2 ) d -= m_wrap;
+            while( d <= -m_wrap/2 ) d += m_wrap;
+        }
+        return d;
+    }
+
+    double norm(double v) const {
+        if( m_wrap > 0 ) {
+            while( v <  0 )      v += m_wrap;
+            while( v >= m_wrap ) v -= m_wrap;
+        }
+        return v;
+    }
+
+protected:
+    enum { N = 16 };
+
+    double      m_wrap;                         ///< period of a circular channel
+    int         m_n, m_head;                    ///< sample count & newest index
+    qint64      m_t[N];                         ///< sample times (in ns)
+    double      m_v[N];                         ///< sample values
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Attitude indicator painter, independent of any widget
+///
+///     Holds the cached layers of one instrument size. A renderer with
+///     private resources may paint into a QImage on any thread.
+///
+class QADIRenderer
+{
+public:
+    ///
+    /// \param sharedResources - use the process-wide resources (GUI thread),
+    ///     or a private copy (worker threads)
+    ///
+    QADIRenderer(bool sharedResources = true);
+    virtual ~QADIRenderer();
+
+    ///
+    /// \brief Set instrument size
+    /// \param size - disc diameter (in pixel)
+    /// \param dpr  - device pixel ratio of the target
+    ///
+    void setSize(int size, qreal dpr = 1.0);
+
+    int getSize(void) const         { return m_size; }
+    int getImageSize(void) const    { return m_size + 2*m_offset; } ///< size of a frame
+
+    void setAntialiasing(bool aa);
+    bool getAntialiasing(void) const { return m_antialiasing; }
+
+    ///
+    /// \brief Set paint quality (QQualityGovernor::Level, default: LEVEL_FULL)
+    ///
+    void setQuality(int level);
+    int getQuality(void) const { return m_quality; }
+
+    ///
+    /// \brief Antialiasing in effect (configured and not dropped by the quality)
+    ///
+    bool getEffectiveAntialiasing(void) const {
+        return m_antialiasing && m_quality < QQualityGovernor::LEVEL_NO_AA;
+    }
+
+    const QInstrumentResources* getResources(void) const { return m_res; }
+
+    ///
+    /// \brief Paint the instrument centered at the painter's origin
+    /// \param roll  - roll angle (in degree)
+    /// \param pitch - pitch angle (in degree)
+    ///
+    void render(QPainter &painter, double roll, double pitch);
+
+    ///
+    /// \brief Render one frame (getImageSize() square, transparent background)
+    /// \param img - output image, (re)allocated if its size does not match
+    ///
+    void renderImage(QImage &img, double roll, double pitch);
+
+    ///
+    /// \brief Cached pitch ladder strip & roll ring (e.g. for scene-graph textures)
+    ///
+    ///     The ladder strip is m_size x 3*m_size with the zero line at the
+    ///     middle row, the roll ring is getImageSize() square.
+    ///
+    const QImage& getLadderLayer(void);
+    const QImage& getRollLayer(void);
+
+protected:
+    ///
+    /// \brief Rebuild cached layers (pitch ladder, roll ring)
+    ///
+    void buildLayers(void);
+
+    ///
+    /// \brief Device pixel ratio of the cached layers (half at LEVEL_LOW_RES)
+    ///
+    qreal layerDpr(void) const {
+        return m_quality >= QQualityGovernor::LEVEL_LOW_RES ? m_dpr/2 : m_dpr;
+    }
+
+protected:
+    int     m_size, m_offset;               ///< disc diameter & rim offset
+    qreal   m_dpr;                          ///< device pixel ratio
+    bool    m_antialiasing;                 ///< antialiasing flag
+    int     m_quality;                      ///< QQualityGovernor::Level
+
+    bool    m_shared;                       ///< m_res is shared
+    const QInstrumentResources *m_res;      ///< paint resources of m_size
+
+    QImage  m_discLayer;                    ///< sky/ground disc, rasterized per attitude
+    bool    m_discValid;                    ///< m_discLayer matches m_discRoll/m_discY
+    double  m_discRoll;                     ///< roll of m_discLayer
+    int     m_discY;                        ///< horizon offset of m_discLayer
+    QImage  m_ladderLayer;                  ///< pitch ladder strip (m_size x 3*m_size)
+    QImage  m_rollLayer;                    ///< roll ring, ticks & rim
+    int     m_layerSize;                    ///< m_size the layers were built for
+    qreal   m_layerDpr;                     ///< device pixel ratio of the layers
+};
+
+///
+/// \brief Compass painter, independent of any widget
+///
+///     Same threading rules as QADIRenderer. The dial, the yaw marker and
+///     the readouts can be drawn separately for partial repaints.
+///
+class QCompassRenderer
+{
+public:
+    enum CardMode {
+        NORTH_UP = 0,                           ///< fixed dial, rotating yaw marker
+        HEADING_UP                              ///< HSI: rotating card, fixed lubber line
+    };
+
+    enum CardFilter {
+        FILTER_FAST = 0,                        ///< nearest pixel
+        FILTER_SMOOTH,                          ///< bilinear
+        FILTER_HIGH                             ///< bilinear from a card of twice the resolution
+    };
+
+    QCompassRenderer(bool sharedResources = true);
+    virtual ~QCompassRenderer();
+
+    ///
+    /// \brief Set instrument size
+    /// \param size - dial diameter (in pixel)
+    /// \param dpr  - device pixel ratio of the target
+    ///
+    void setSize(int size, qreal dpr = 1.0);
+
+    int getSize(void) const         { return m_size; }
+    int getImageSize(void) const    { return m_size + 2*m_offset; } ///< size of a frame
+
+    void setAntialiasing(bool aa);
+    bool getAntialiasing(void) const { return m_antialiasing; }
+
+    ///
+    /// \brief Set paint quality (QQualityGovernor::Level, default: LEVEL_FULL)
+    ///
+    void setQuality(int level);
+    int getQuality(void) const { return m_quality; }
+
+    ///
+    /// \brief Antialiasing in effect (configured and not dropped by the quality)
+    ///
+    bool getEffectiveAntialiasing(void) const {
+        return m_antialiasing && m_quality < QQualityGovernor::LEVEL_NO_AA;
+    }
+
+    const QInstrumentResources* getResources(void) const { return m_res; }
+
+    ///
+    /// \brief Set card mode (default: NORTH_UP)
+    ///
+    ///     Heading-up keeps the card (background, ticks & labels) in a cached
+    ///     image which is rotated as a whole each frame.
+    ///
+    void setCardMode(CardMode mode)         { m_mode = mode; }
+    CardMode getCardMode(void) const        { return m_mode; }
+
+    ///
+    /// \brief Set filter of the rotated card (default: FILTER_SMOOTH)
+    ///
+    void setCardFilter(CardFilter filter);
+    CardFilter getCardFilter(void) const    { return m_filter; }
+
+    ///
+    /// \brief Course pointer & deviation bar (heading-up mode)
+    /// \param visible   - show the pointer
+    /// \param course    - selected course (in degree)
+    /// \param deviation - course deviation (in dots, full scale +-2, positive: right)
+    ///
+    void setCourse(bool visible, double course = 0, double deviation = 0) {
+        m_courseOn = visible;
+        m_course   = course;
+        m_dev      = deviation;
+    }
+
+    ///
+    /// \brief Bearing pointer (heading-up mode)
+    /// \param visible - show the pointer
+    /// \param bearing - bearing to the station / waypoint (in degree)
+    ///
+    void setBearing(bool visible, double bearing = 0) {
+        m_bearingOn = visible;
+        m_bearing   = bearing;
+    }
+
+    ///
+    /// \brief Offset of the ALT/H readout from its centered position
+    ///     (heading-up mode moves it below the course pointer)
+    ///
+    QPointF getReadoutOffset(void) const {
+        return QPointF(0, m_mode == HEADING_UP ? m_size/4 : 0);
+    }
+
+    ///
+    /// \brief Paint the whole instrument centered at the painter's origin
+    /// \param yaw - yaw angle (in degree)
+    /// \param alt - altitude (in m)
+    /// \param h   - height from ground (in m)
+    ///
+    void render(QPainter &painter, double yaw, double alt, double h);
+
+    ///
+    /// \brief Render one frame (getImageSize() square, transparent background)
+    /// \param img - output image, (re)allocated if its size does not match
+    ///
+    void renderImage(QImage &img, double yaw, double alt, double h);
+
+    ///
+    /// \brief Draw the static dial
+    /// \param rc - part to draw, relative to the center (null: all)
+    ///
+    void drawDial(QPainter &painter, const QRectF &rc = QRectF());
+
+    ///
+    /// \brief Cached static dial, getImageSize() square (e.g. for scene-graph textures)
+    ///
+    const QImage& getDialLayer(void);
+
+    void drawYawMarker(QPainter &painter, double yaw);
+    void drawAlt(QPainter &painter, double alt);
+    void drawH(QPainter &painter, double h);
+
+    ///
+    /// \brief Draw the card rotated to heading-up
+    ///
+    void drawCard(QPainter &painter, double yaw);
+
+    ///
+    /// \brief Draw course & bearing pointers, lubber line and ALT/H box
+    ///
+    void drawHsiOverlay(QPainter &painter, double yaw);
+
+protected:
+    ///
+    /// \brief Rebuild the static dial (background, yaw lines, arrow, ALT/H box)
+    ///
+    void buildDial(void);
+
+    ///
+    /// \brief Rebuild the heading-up card & its fixed overlay
+    ///
+    void buildCard(void);
+
+    ///
+    /// \brief Paint background, yaw lines & labels (centered)
+    ///
+    void paintCard(QPainter &painter);
+
+    ///
+    /// \brief Device pixel ratio of the dial & card (half at LEVEL_LOW_RES)
+    ///
+    qreal layerDpr(void) const {
+        return m_quality >= QQualityGovernor::LEVEL_LOW_RES ? m_dpr/2 : m_dpr;
+    }
+
+protected:
+    int     m_size, m_offset;                   ///< dial diameter & rim offset
+    qreal   m_dpr;                              ///< device pixel ratio
+    bool    m_antialiasing;                     ///< antialiasing flag
+    int     m_quality;                          ///< QQualityGovernor::Level
+
+    bool    m_shared;                           ///< m_res is shared
+    const QInstrumentResources *m_res;          ///< paint resources of m_size
+
+    QImage  m_dialLayer;                        ///< cached static dial
+    int     m_dialSize;                         ///< m_size the dial was built for
+    qreal   m_dialDpr;                          ///< device pixel ratio of the dial
+
+    CardMode    m_mode;
+    CardFilter  m_filter;
+    QImage      m_cardLayer;                    ///< heading-up card (2x for FILTER_HIGH)
+    QImage      m_hsiLayer;                     ///< lubber line, aircraft & ALT/H box
+    int         m_cardSize;                     ///< m_size the card was built for
+    qreal       m_cardDpr;                      ///< layerDpr() the card was built for
+
+    bool        m_courseOn, m_bearingOn;
+    double      m_course, m_dev, m_bearing;     ///< HSI pointers (in degree, dots)
+};
+
+///
+/// \brief Painter of a vertical tape (altitude, airspeed, vertical speed)
+///
+///     Altitude & airspeed tapes keep their graduation in tiles of a fixed
+///     height, each covering a fixed value span. A frame blits the two or
+///     three visible tiles at the value offset and only draws the rolling
+///     digit readout. The VSI scale does not move: it is cached once and
+///     only the pointer & readout are drawn. A renderer belongs to one
+///     thread.
+///
+class QTapeRenderer
+{
+public:
+    enum TapeType {
+        ALTITUDE = 0,                           ///< ticks on the left, scrolling
+        AIRSPEED,                               ///< ticks on the right, scrolling
+        VSI                                     ///< fixed scale, moving pointer
+    };
+
+    QTapeRenderer(TapeType type = ALTITUDE, bool sharedResources = true);
+    virtual ~QTapeRenderer();
+
+    ///
+    /// \brief Set tape type, resets scale & range to the type's defaults
+    ///
+    void setType(TapeType type);
+    TapeType getType(void) const    { return m_type; }
+
+    ///
+    /// \brief Set tape size
+    /// \param w, h - tape size (in pixel)
+    /// \param dpr  - device pixel ratio of the target
+    ///
+    void setSize(int w, int h, qreal dpr = 1.0);
+
+    int getWidth(void) const        { return m_width; }
+    int getHeight(void) const       { return m_height; }
+
+    ///
+    /// \brief Set graduation
+    /// \param tick       - value between two ticks
+    /// \param labelEvery - label every n-th tick
+    /// \param pxPerTick  - tick spacing (in pixel)
+    ///
+    void setScale(double tick, int labelEvery, double pxPerTick);
+
+    ///
+    /// \brief Set the graduated value range (VSI: the whole scale)
+    ///
+    void setRange(double vMin, double vMax);
+
+    double getMin(void) const       { return m_min; }
+    double getMax(void) const       { return m_max; }
+
+    void setAntialiasing(bool aa);
+    bool getAntialiasing(void) const { return m_antialiasing; }
+
+    ///
+    /// \brief Paint the tape centered at the painter's origin
+    /// \param v - value
+    ///
+    void render(QPainter &painter, double v);
+
+    ///
+    /// \brief Number of cached graduation tiles
+    ///
+    int getTileCount(void) const    { return m_tiles.size(); }
+
+protected:
+    enum {
+        TILE_H      = 256,                      ///< tile height (in pixel)
+        MAX_TILES   = 8                         ///< tiles kept per tape
+    };
+
+    ///
+    /// \brief Drop cached artwork (size, scale or type changed)
+    ///
+    void invalidate(void);
+
+    ///
+    /// \brief Get (or build) the tile of values [k*span, (k+1)*span]
+    ///
+    QImage tile(int k);
+
+    ///
+    /// \brief Draw ticks & labels of values in [vLo, vHi], value vTop at y = 0
+    /// \param ppu - pixels per value unit
+    ///
+    void drawGraduation(QPainter &painter, double vLo, double vHi, double vTop, double ppu);
+
+    ///
+    /// \brief Draw the odometer-style readout of v in box
+    ///
+    void drawRolling(QPainter &painter, double v, const QRectF &box);
+
+    void renderScrolling(QPainter &painter, double v);
+    void renderVsi(QPainter &painter, double v);
+
+protected:
+    TapeType    m_type;
+    int         m_width, m_height;              ///< tape size
+    qreal       m_dpr;                          ///< device pixel ratio
+    bool        m_antialiasing;                 ///< antialiasing flag
+
+    double      m_tick;                         ///< value between ticks
+    int         m_labelEvery;                   ///< label every n-th tick
+    double      m_pxPerTick;                    ///< tick spacing (in pixel)
+    double      m_min, m_max;                   ///< graduated range
+
+    bool        m_shared;                       ///< m_res is shared
+    const QInstrumentResources *m_res;          ///< fonts & readout glyphs
+
+    QHash<int, QImage>  m_tiles;                ///< scrolling tapes: tile index -> graduation
+    QImage      m_scaleLayer;                   ///< VSI: cached scale
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Lock-free triple buffer, one producer & one consumer thread
+///
+///     The producer fills back() and publishes it; the consumer picks up
+///     the newest published item with update() and reads front(). Neither
+///     side ever waits for the other.
+///
+template<typename T>
+class QTripleBuffer
+{
+public:
+    QTripleBuffer() : m_middle(1), m_front(0), m_back(2) {}
+
+    ///
+    /// \brief Item being filled (producer thread only)
+    ///
+    T& back(void) { return m_buf[m_back]; }
+
+    ///
+    /// \brief Publish back() as the newest item (producer thread only)
+    ///
+    void publish(void) {
+        m_back = m_middle.fetchAndStoreOrdered(m_back | FRESH) & INDEX;
+    }
+
+    ///
+    /// \brief Take the newest published item as front() (consumer thread only)
+    /// \return true if front() changed
+    ///
+    bool update(void) {
+        if( !(m_middle.loadAcquire() & FRESH) ) return false;
+
+        m_front = m_middle.fetchAndStoreOrdered(m_front) & INDEX;
+        return true;
+    }
+
+    ///
+    /// \brief Newest item taken by update() (consumer thread only)
+    ///
+    const T& front(void) const { return m_buf[m_front]; }
+
+protected:
+    enum { INDEX = 3, FRESH = 4 };
+
+    T           m_buf[3];
+    QAtomicInt  m_middle;                       ///< index of the middle item | FRESH
+    int         m_front;                        ///< consumer's item
+    int         m_back;                         ///< producer's item
+};
+
+///
+/// \brief Instrument frame rendered on the render thread
+///
+///     The GUI thread requests a frame with the values to show and blits
+///     the newest completed one; frameReady() is emitted (from the render
+///     thread) whenever a new frame has been published.
+///
+class QRenderJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum { MAX_VALUES = 12 };
+
+    QRenderJob(QObject *parent = 0);
+    virtual ~QRenderJob();
+
+    ///
+    /// \brief Request a frame (GUI thread), ignored if nothing changed
+    /// \param size - instrument size (in pixel)
+    /// \param dpr  - device pixel ratio
+    /// \param v    - values to show
+    /// \param n    - number of values (<= MAX_VALUES)
+    ///
+    void request(int size, qreal dpr, const double *v, int n);
+
+    ///
+    /// \brief Take the newest completed frame (GUI thread)
+    /// \return true if frame() changed
+    ///
+    bool fetch(void) { return m_frames.update(); }
+
+    ///
+    /// \brief Newest completed frame (GUI thread), null before the first one
+    ///
+    const QImage& frame(void) const { return m_frames.front(); }
+
+    ///
+    /// \brief Render time of the newest completed frame (in ns)
+    ///
+    qint64 getRenderTime(void) const { return atomicLoad(m_renderNs); }
+
+    ///
+    /// \brief Remove the job from the render thread, waits if it is being
+    ///     rendered (GUI thread). Derived destructors call this before their
+    ///     renderer goes away.
+    ///
+    void cancel(void);
+
+signals:
+    void frameReady(void);
+
+protected:
+    friend class QInstrumentRenderThread;
+
+    ///
+    /// \brief Render a frame (render thread)
+    ///
+    virtual void render(QImage &img, int size, qreal dpr, const double *v) = 0;
+
+protected:
+    QTripleBuffer<QImage>   m_frames;           ///< completed frames
+    QAtomicInteger<qint64>  m_renderNs;         ///< render time of the newest frame
+
+    // request, guarded by the render thread's mutex
+    int                     m_size;
+    qreal                   m_dpr;
+    double                  m_v[MAX_VALUES];
+    bool                    m_queued;           ///< waiting in the render queue
+
+    // last request (GUI thread)
+    int                     m_lastSize;
+    qreal                   m_lastDpr;
+    double                  m_lastV[MAX_VALUES];
+};
+
+///
+/// \brief ADI frame job, v = { roll, pitch, antialiasing, quality }
+///
+class QADIRenderJob : public QRenderJob
+{
+public:
+    QADIRenderJob(QObject *parent = 0) : QRenderJob(parent), m_renderer(false) {}
+    ~QADIRenderJob() { cancel(); }
+
+protected:
+    void render(QImage &img, int size, qreal dpr, const double *v);
+
+    QADIRenderer    m_renderer;                 ///< private, render thread only
+};
+
+///
+/// \brief Compass frame job, v = { yaw, alt, h, antialiasing, card mode, card filter,
+///     course on, course, deviation, bearing on, bearing, quality }
+///
+class QCompassRenderJob : public QRenderJob
+{
+public:
+    QCompassRenderJob(QObject *parent = 0) : QRenderJob(parent), m_renderer(false) {}
+    ~QCompassRenderJob() { cancel(); }
+
+protected:
+    void render(QImage &img, int size, qreal dpr, const double *v);
+
+    QCompassRenderer m_renderer;                ///< private, render thread only
+};
+
+///
+/// \brief Process-wide render thread for instrument frames
+///
+///     Serves the queued jobs in request order; a job is queued at most
+///     once and renders the newest values it was given.
+///
+class QInstrumentRenderThread : public QThread
+{
+public:
+    ///
+    /// \brief Get the render thread, started on first use (GUI thread only)
+    ///
+    static QInstrumentRenderThread* instance(void);
+
+    ///
+    /// \brief Queue a job with new values (GUI thread)
+    ///
+    void enqueue(QRenderJob *job, int size, qreal dpr, const double *v);
+
+    ///
+    /// \brief Remove a job, waits if it is being rendered (GUI thread)
+    ///
+    void cancel(QRenderJob *job);
+
+    virtual ~QInstrumentRenderThread();
+
+protected:
+    friend class QRenderJob;
+
+    QInstrumentRenderThread(QObject *parent = 0);
+
+    void run(void);
+
+protected:
+    QMutex                  m_mutex;
+    QWaitCondition          m_cond;             ///< job queued / quit
+    QWaitCondition          m_idle;             ///< a job finished
+    QList<QRenderJob*>      m_queue;
+    QRenderJob              *m_current;         ///< job being rendered
+    bool                    m_quit;
+
+    static QPointer<QInstrumentRenderThread>    s_instance;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief The Attitude indicator class
+///
+class QADI : public QWidget
+{
+    Q_OBJECT
+
+public:
+    QADI(QWidget *parent = 0);
+    ~QADI();
+
+    ///
+    /// \brief Set roll & pitch values (in degree)
+    /// \param r - roll
+    /// \param p - pitch
+    ///
+    void setData(double r, double p) {
+        m_rollCh.clear();
+        m_pitchCh.clear();
+
+        m_roll = r;
+        m_pitch = p;
+        if( m_roll < -180 ) m_roll = -180;
+        if( m_roll > 180  ) m_roll =  180;
+        if( m_pitch < -90 ) m_pitch = -90;
+        if( m_pitch > 90  ) m_pitch =  90;
+
+        markDirty();
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Set roll angle (in degree)
+    /// \param val - roll
+    ///
+    void setRoll(double val) {
+        m_rollCh.clear();
+
+        m_roll  = val;
+        if( m_roll < -180 ) m_roll = -180;
+        if( m_roll > 180  ) m_roll =  180;
+
+        markDirty();
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Set pitch value (in degree)
+    /// \param val
+    ///
+    void setPitch(double val) {
+        m_pitchCh.clear();
+
+        m_pitch = val;
+        if( m_pitch < -90 ) m_pitch = -90;
+        if( m_pitch > 90  ) m_pitch =  90;
+
+        markDirty();
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Add a timestamped roll & pitch sample (in degree)
+    ///
+    ///     The display samples the history at the frame's presentation time
+    ///     (see setLatencyBudget), the plain setters switch this off again.
+    ///
+    /// \param t - sample time (steady clock in ns, QTelemetryQueue::now())
+    /// \param r - roll
+    /// \param p - pitch
+    ///
+    void addSample(qint64 t, double r, double p) {
+        m_rollCh.add(t, r);
+        m_pitchCh.add(t, p);
+
+        m_roll  = qBound(-180.0, r, 180.0);
+        m_pitch = qBound(-90.0,  p, 90.0);
+
+        markDirty();
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Set display latency budget, timestamped samples are shown
+    ///     at (now + budget)
+    /// \param ms - latency (in ms, default 0)
+    ///
+    void setLatencyBudget(int ms) {m_latency = (qint64) ms*1000000;}
+
+    ///
+    /// \brief Set how far past the newest sample the display extrapolates
+    /// \param ms - time (in ms, default 100)
+    ///
+    void setMaxExtrapolation(int ms) {m_maxExtrap = (qint64) ms*1000000;}
+
+    ///
+    /// \brief Get roll angle (in degree)
+    /// \return roll angle
+    ///
+    double getRoll() {return m_roll;}
+
+    ///
+    /// \brief Get pitch angle (in degree)
+    /// \return pitch angle
+    ///
+    double getPitch(){return m_pitch;}
+
+    ///
+    /// \brief Enable/disable antialiasing (default: enabled)
+    /// \param aa - antialiasing flag
+    ///
+    void setAntialiasing(bool aa) {
+        m_renderer.setAntialiasing(aa);
+
+        markDirty();
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Get antialiasing flag
+    /// \return true if antialiasing is enabled
+    ///
+    bool getAntialiasing() {return m_renderer.getAntialiasing();}
+
+    ///
+    /// \brief Render on the render thread, paintEvent only blits the
+    ///     newest completed frame (default: disabled)
+    /// \param on - threaded rendering flag
+    ///
+    void setThreadedRendering(bool on);
+    bool getThreadedRendering() {return m_job != NULL;}
+
+    ///
+    /// \brief Enable/disable paint statistics (default: disabled)
+    ///
+    void setStatsEnabled(bool on);
+
+    ///
+    /// \brief Get paint statistics, NULL if disabled
+    ///
+    const QPaintStats* getStats() {return m_stats;}
+
+    ///
+    /// \brief Show/hide the statistics overlay (enables statistics)
+    ///
+    void setHudVisible(bool on);
+    bool getHudVisible() {return m_hud;}
+
+    ///
+    /// \brief Set paint time budget, over it the quality steps down
+    ///     (antialiasing, minor ticks & labels, layer resolution) until
+    ///     the motion settles (default: 0, always full quality)
+    /// \param ms - budget per frame (in ms, 0: off)
+    ///
+    void setFrameBudget(double ms);
+    double getFrameBudget() {return m_governor.getBudget();}
+
+    ///
+    /// \brief Get current paint quality (QQualityGovernor::Level)
+    ///
+    int getQuality() {return m_governor.getLevel();}
+
+
+signals:
+    ///
+    /// \brief Emitted when a setter changed the displayed values, the
+    ///     repaint itself goes through QInstrumentScheduler
+    ///
+    void canvasReplot(void);
+
+protected slots:
+    void canvasReplot_slot(void);
+    void frameReady_slot(void);
+    void settle_slot(void);
+    void hudRefresh_slot(void);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void keyPressEvent(QKeyEvent *event);
+
+    ///
+    /// \brief Request a repaint through the display-rate scheduler
+    ///
+    void markDirty(void) {
+        if( m_stats ) m_stats->addRequest();
+        QInstrumentScheduler::instance()->markDirty(this);
+    }
+
+    ///
+    /// \brief Feed a paint (or render) time to the governor, apply its level
+    ///
+    void governQuality(qint64 ns);
+
+protected:
+    int     m_sizeMin, m_sizeMax;           ///< widget's min/max size (in pixel)
+    int     m_size, m_offset;               ///< current size & offset
+
+    double  m_roll;                         ///< roll angle (in degree)
+    double  m_pitch;                        ///< pitch angle (in degree)
+
+    QSampleChannel  m_rollCh, m_pitchCh;    ///< timestamped samples (roll circular)
+    qint64  m_latency;                      ///< latency budget (in ns)
+    qint64  m_maxExtrap;                    ///< max extrapolation (in ns)
+
+    QADIRenderer    m_renderer;             ///< painter & cached layers
+    QADIRenderJob   *m_job;                 ///< threaded rendering, or NULL
+
+    QPaintStats     *m_stats;               ///< paint statistics, or NULL
+    bool            m_hud;                  ///< statistics overlay visible
+    QTimer          *m_hudTimer;            ///< repaints the overlay when painting stops
+
+    QQualityGovernor m_governor;            ///< paint quality under the frame budget
+    QTimer          *m_settleTimer;         ///< restores full quality when idle
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief The Compass & altitude display class
+///
+class QCompass : public QWidget
+{
+    Q_OBJECT
+
+public:
+    QCompass(QWidget *parent = 0);
+    ~QCompass();
+
+    ///
+    /// \brief Set all data (yaw, alt, height)
+    ///
+    /// \param y - yaw ( in degree)
+    /// \param a - altitude ( in m)
+    /// \param h - height from ground (in m)
+    ///
+    void setData(double y, double a, double h) {
+        QRegion rgn = yawMarkerRect(m_paintedYaw);
+
+        m_yawCh.clear();
+        m_altCh.clear();
+        m_hCh.clear();
+
+        m_yaw = y;
+        m_alt = a;
+        m_h   = h;
+
+        if( m_yaw < 0   ) m_yaw = 360 + m_yaw;
+        if( m_yaw > 360 ) m_yaw = m_yaw - 360;
+
+        rgn += yawMarkerRect(m_yaw);
+        rgn += readoutRect(m_res->altRect);
+        rgn += readoutRect(m_res->hRect);
+        markDirty(rgn);
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Set yaw angle (in degree)
+    /// \param val - yaw angle (in degree)
+    ///
+    void setYaw(double val) {
+        QRegion rgn = yawMarkerRect(m_paintedYaw);
+
+        m_yawCh.clear();
+
+        m_yaw  = val;
+        if( m_yaw < 0   ) m_yaw = 360 + m_yaw;
+        if( m_yaw > 360 ) m_yaw = m_yaw - 360;
+
+        // old and new marker position
+        rgn += yawMarkerRect(m_yaw);
+        markDirty(rgn);
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Set altitude value
+    /// \param val - altitude (in m)
+    ///
+    void setAlt(double val) {
+        m_altCh.clear();
+
+        m_alt = val;
+
+        markDirty(readoutRect(m_res->altRect));
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Set height from ground
+    /// \param val - height (in m)
+    ///
+    void setH(double val) {
+        m_hCh.clear();
+
+        m_h = val;
+
+        markDirty(readoutRect(m_res->hRect));
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Add a timestamped yaw sample
+    ///
+    ///     The display samples the history at the frame's presentation time
+    ///     (see setLatencyBudget), interpolating across 0/360. The plain
+    ///     setters switch this off again.
+    ///
+    /// \param t   - sample time (steady clock in ns, QTelemetryQueue::now())
+    /// \param val - yaw angle (in degree)
+    ///
+    void addYawSample(qint64 t, double val) {
+        QRegion rgn = yawMarkerRect(m_paintedYaw);
+
+        m_yaw  = val;
+        if( m_yaw < 0   ) m_yaw = 360 + m_yaw;
+        if( m_yaw > 360 ) m_yaw = m_yaw - 360;
+        m_yawCh.add(t, m_yaw);
+
+        rgn += yawMarkerRect(m_yaw);
+        markDirty(rgn);
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Add a timestamped altitude & height sample
+    /// \param t - sample time (steady clock in ns, QTelemetryQueue::now())
+    /// \param a - altitude (in m)
+    /// \param h - height from ground (in m)
+    ///
+    void addAltSample(qint64 t, double a, double h) {
+        m_alt = a;
+        m_h   = h;
+        m_altCh.add(t, a);
+        m_hCh.add(t, h);
+
+        markDirty(QRegion(readoutRect(m_res->altRect)) + readoutRect(m_res->hRect));
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Set display latency budget, timestamped samples are shown
+    ///     at (now + budget)
+    /// \param ms - latency (in ms, default 0)
+    ///
+    void setLatencyBudget(int ms) {m_latency = (qint64) ms*1000000;}
+
+    ///
+    /// \brief Set how far past the newest sample the display extrapolates
+    /// \param ms - time (in ms, default 100)
+    ///
+    void setMaxExtrapolation(int ms) {m_maxExtrap = (qint64) ms*1000000;}
+
+    ///
+    /// \brief Get yaw angle
+    /// \return yaw angle (in degree)
+    ///
+    double getYaw() {return m_yaw;}
+
+    ///
+    /// \brief Get altitude value
+    /// \return altitude (in m)
+    ///
+    double getAlt() {return m_alt;}
+
+    ///
+    /// \brief Get height from ground
+    /// \return height from ground (in m)
+    ///
+    double getH()   {return m_h;}
+
+    ///
+    /// \brief Enable/disable antialiasing (default: enabled)
+    /// \param aa - antialiasing flag
+    ///
+    void setAntialiasing(bool aa) {
+        m_renderer.setAntialiasing(aa);
+
+        markDirty();
+        emit canvasReplot();
+    }
+
+    ///
+    /// \brief Get antialiasing flag
+    /// \return true if antialiasing is enabled
+    ///
+    bool getAntialiasing() {return m_renderer.getAntialiasing();}
+
+    ///
+    /// \brief Set card mode, HEADING_UP is an HSI with a rotating card
+    ///     (default: NORTH_UP)
+    ///
+    void setCardMode(QCompassRenderer::CardMode mode) {
+        m_renderer.setCardMode(mode);
+
+        markDirty();
+    }
+
+    QCompassRenderer::CardMode getCardMode() {return m_renderer.getCardMode();}
+
+    ///
+    /// \brief Set filter quality of the rotated card (default: FILTER_SMOOTH)
+    ///
+    void setCardFilter(QCompassRenderer::CardFilter filter) {
+        m_renderer.setCardFilter(filter);
+
+        markDirty();
+    }
+
+    QCompassRenderer::CardFilter getCardFilter() {return m_renderer.getCardFilter();}
+
+    ///
+    /// \brief Show the course pointer (heading-up mode)
+    /// \param course    - selected course (in degree)
+    /// \param deviation - course deviation (in dots, full scale +-2, positive: right)
+    ///
+    void setCourse(double course, double deviation) {
+        m_courseOn = true;
+        m_course   = course;
+        m_dev      = deviation;
+
+        if( getCardMode() == QCompassRenderer::HEADING_UP ) markDirty();
+    }
+
+    void clearCourse(void) {
+        m_courseOn = false;
+
+        if( getCardMode() == QCompassRenderer::HEADING_UP ) markDirty();
+    }
+
+    ///
+    /// \brief Show the bearing pointer (heading-up mode)
+    /// \param bearing - bearing to the station / waypoint (in degree)
+    ///
+    void setBearing(double bearing) {
+        m_bearingOn = true;
+        m_bearing   = bearing;
+
+        if( getCardMode() == QCompassRenderer::HEADING_UP ) markDirty();
+    }
+
+    void clearBearing(void) {
+        m_bearingOn = false;
+
+        if( getCardMode() == QCompassRenderer::HEADING_UP ) markDirty();
+    }
+
+    ///
+    /// \brief Render on the render thread, paintEvent only blits the
+    ///     newest completed frame (default: disabled)
+    /// \param on - threaded rendering flag
+    ///
+    void setThreadedRendering(bool on);
+    bool getThreadedRendering() {return m_job != NULL;}
+
+    ///
+    /// \brief Enable/disable paint statistics (default: disabled)
+    ///
+    void setStatsEnabled(bool on);
+
+    ///
+    /// \brief Get paint statistics, NULL if disabled
+    ///
+    const QPaintStats* getStats() {return m_stats;}
+
+    ///
+    /// \brief Show/hide the statistics overlay (enables statistics)
+    ///
+    void setHudVisible(bool on);
+    bool getHudVisible() {return m_hud;}
+
+    ///
+    /// \brief Set paint time budget, over it the quality steps down
+    ///     (antialiasing, minor ticks & labels, layer resolution) until
+    ///     the motion settles (default: 0, always full quality)
+    /// \param ms - budget per frame (in ms, 0: off)
+    ///
+    void setFrameBudget(double ms);
+    double getFrameBudget() {return m_governor.getBudget();}
+
+    ///
+    /// \brief Get current paint quality (QQualityGovernor::Level)
+    ///
+    int getQuality() {return m_governor.getLevel();}
+
+signals:
+    ///
+    /// \brief Emitted when a setter changed the displayed values, the
+    ///     repaint itself goes through QInstrumentScheduler
+    ///
+    void canvasReplot(void);
+
+protected slots:
+    void canvasReplot_slot(void);
+    void frameReady_slot(void);
+    void settle_slot(void);
+    void hudRefresh_slot(void);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void keyPressEvent(QKeyEvent *event);
+
+    ///
+    /// \brief Request a repaint through the display-rate scheduler
+    ///
+    void markDirty(void) {
+        if( m_stats ) m_stats->addRequest();
+        QInstrumentScheduler::instance()->markDirty(this);
+    }
+
+    ///
+    /// \brief Request a repaint of part of the widget (and of the overlay)
+    ///
+    void markDirty(const QRegion &rgn) {
+        if( m_stats ) m_stats->addRequest();
+        QInstrumentScheduler::instance()->markDirty(this, m_hud ? rgn + QPaintStats::hudRect() : rgn);
+    }
+
+    ///
+    /// \brief Bounds of the yaw marker at a yaw angle (in widget coordinates),
+    ///     the whole widget in heading-up mode
+    ///
+    QRect yawMarkerRect(double yaw);
+
+    ///
+    /// \brief Bounds of a readout line (in widget coordinates)
+    /// \param rc - line rect relative to the dial center
+    ///
+    QRect readoutRect(const QRectF &rc);
+
+    ///
+    /// \brief Feed a paint (or render) time to the governor, apply its level
+    ///
+    void governQuality(qint64 ns);
+
+protected:
+    int     m_sizeMin, m_sizeMax;               ///< widget min/max size (in pixel)
+    int     m_size, m_offset;                   ///< widget size and offset size
+
+    double  m_yaw;                              ///< yaw angle (in degree)
+    double  m_alt;                              ///< altitude (in m)
+    double  m_h;                                ///< height from ground (in m)
+    double  m_paintedYaw;                       ///< yaw of the marker on screen
+
+    bool    m_courseOn, m_bearingOn;            ///< HSI pointers shown
+    double  m_course, m_dev, m_bearing;         ///< HSI pointers (in degree, dots)
+
+    QSampleChannel  m_yawCh, m_altCh, m_hCh;    ///< timestamped samples
+    qint64  m_latency;                          ///< latency budget (in ns)
+    qint64  m_maxExtrap;                        ///< max extrapolation (in ns)
+
+    const QInstrumentResources *m_res;          ///< paint resources of m_size
+    QCompassRenderer    m_renderer;             ///< painter & cached dial
+    QCompassRenderJob   *m_job;                 ///< threaded rendering, or NULL
+
+    QPaintStats         *m_stats;               ///< paint statistics, or NULL
+    bool                m_hud;                  ///< statistics overlay visible
+    QTimer              *m_hudTimer;            ///< repaints the overlay when painting stops
+
+    QQualityGovernor    m_governor;             ///< paint quality under the frame budget
+    QTimer              *m_settleTimer;         ///< restores full quality when idle
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Vertical tape instrument: altitude, airspeed or vertical speed
+///
+class QTape : public QWidget
+{
+    Q_OBJECT
+
+public:
+    QTape(QTapeRenderer::TapeType type = QTapeRenderer::ALTITUDE, QWidget *parent = 0);
+    ~QTape();
+
+    ///
+    /// \brief Set value (altitude in m, airspeed in m/s, vertical speed in m/s)
+    ///
+    void setValue(double val) {
+        m_ch.clear();
+
+        m_value = val;
+
+        markDirty();
+    }
+
+    ///
+    /// \brief Add a timestamped sample (see QADI::addSample)
+    /// \param t   - sample time (steady clock in ns, QTelemetryQueue::now())
+    /// \param val - value
+    ///
+    void addSample(qint64 t, double val) {
+        m_value = val;
+        m_ch.add(t, val);
+
+        markDirty();
+    }
+
+    double getValue() {return m_value;}
+
+    ///
+    /// \brief Set display latency budget (in ms, default 0)
+    ///
+    void setLatencyBudget(int ms) {m_latency = (qint64) ms*1000000;}
+
+    ///
+    /// \brief Set how far past the newest sample the display extrapolates
+    /// \param ms - time (in ms, default 100)
+    ///
+    void setMaxExtrapolation(int ms) {m_maxExtrap = (qint64) ms*1000000;}
+
+    ///
+    /// \brief Set graduation (see QTapeRenderer::setScale)
+    ///
+    void setScale(double tick, int labelEvery, double pxPerTick) {
+        m_renderer.setScale(tick, labelEvery, pxPerTick);
+
+        markDirty();
+    }
+
+    ///
+    /// \brief Set graduated value range (see QTapeRenderer::setRange)
+    ///
+    void setRange(double vMin, double vMax) {
+        m_renderer.setRange(vMin, vMax);
+
+        markDirty();
+    }
+
+    QTapeRenderer::TapeType getType() {return m_renderer.getType();}
+
+    void setAntialiasing(bool aa) {
+        m_renderer.setAntialiasing(aa);
+
+        markDirty();
+    }
+
+    bool getAntialiasing() {return m_renderer.getAntialiasing();}
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+
+    ///
+    /// \brief Request a repaint through the display-rate scheduler
+    ///
+    void markDirty(void) {
+        QInstrumentScheduler::instance()->markDirty(this);
+    }
+
+protected:
+    double          m_value;                    ///< displayed value
+
+    QSampleChannel  m_ch;                       ///< timestamped samples
+    qint64          m_latency;                  ///< latency budget (in ns)
+    qint64          m_maxExtrap;                ///< max extrapolation (in ns)
+
+    QTapeRenderer   m_renderer;                 ///< painter & cached tiles
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Ring of the newest `capacity` items, stored in chunks which are
+///     allocated as the ring fills (capacity & chunk are powers of two)
+///
+template<typename T>
+class QChunkRing
+{
+public:
+    QChunkRing() : m_count(0), m_capacity(0), m_chunk(1) {}
+    ~QChunkRing() { clear(); }
+
+    void setCapacity(qint64 capacity, int chunk) {
+        clear();
+
+        m_capacity = capacity;
+        m_chunk    = (int) qMin<qint64>(chunk, capacity);
+        m_chunks.fill(NULL, (int) (m_capacity / m_chunk));
+    }
+
+    void clear(void) {
+        for(int i=0; i<m_chunks.size(); i++) {
+            delete [] m_chunks[i];
+            m_chunks[i] = NULL;
+        }
+        m_count = 0;
+    }
+
+    void append(const T &v) {
+        T *&c = m_chunks[(int) ((m_count / m_chunk) & (m_chunks.size() - 1))];
+
+        if( !c ) c = new T[m_chunk];
+        c[m_count & (m_chunk - 1)] = v;
+
+        m_count++;
+    }
+
+    ///
+    /// \brief Item i, getFirst() <= i < getCount()
+    ///
+    const T& at(qint64 i) const {
+        return m_chunks[(int) ((i / m_chunk) & (m_chunks.size() - 1))][i & (m_chunk - 1)];
+    }
+
+    qint64 getCount(void) const { return m_count; }             ///< items appended so far
+    qint64 getFirst(void) const { return qMax<qint64>(0, m_count - m_capacity); }
+
+protected:
+    QVector<T*>     m_chunks;
+    qint64          m_count;
+    qint64          m_capacity;
+    int             m_chunk;
+
+private:
+    QChunkRing(const QChunkRing&);
+    QChunkRing& operator=(const QChunkRing&);
+};
+
+///
+/// \brief Sample history of one trend channel with a min/max pyramid
+///
+///     Level L of the pyramid holds min/max of blocks of FANOUT^L samples
+///     and is extended on append (amortized O(1)). A column query uses the
+///     coarsest level whose blocks fit in a column, so drawing n columns
+///     costs O(n * FANOUT) whatever the number of samples.
+///
+class QTrendChannel
+{
+public:
+    enum {
+        FANOUT_BITS = 3,
+        FANOUT      = 1 << FANOUT_BITS,         ///< samples per block of the next level
+        LEVELS      = 8,                        ///< pyramid levels above the samples
+        CHUNK       = 4096                      ///< ring chunk (items)
+    };
+
+    struct MinMax {
+        float   lo, hi;                         ///< lo > hi: no samples
+    };
+
+    ///
+    /// \param capacity - samples kept (rounded up to a power of two)
+    ///
+    QTrendChannel(qint64 capacity = 1 << 24);
+
+    void append(double v);
+    void clear(void);
+
+    qint64 getCount(void) const     { return m_raw.getCount(); }   ///< index of the next sample
+    qint64 getFirst(void) const     { return m_raw.getFirst(); }   ///< oldest sample kept
+    double at(qint64 i) const       { return m_raw.at(i); }
+
+    ///
+    /// \brief Min/max of samples [i0, i1)
+    ///
+    MinMax range(qint64 i0, qint64 i1) const;
+
+    ///
+    /// \brief Min/max per column, column c covers samples [x0 + c*spp, x0 + (c+1)*spp)
+    /// \param out - n results
+    ///
+    void columns(double x0, double spp, int n, MinMax *out) const;
+
+protected:
+    ///
+    /// \brief Min/max of [i0, i1) (in samples) from level L & the finer tail
+    ///
+    MinMax rangeAt(int L, qint64 i0, qint64 i1) const;
+
+protected:
+    QChunkRing<float>   m_raw;                  ///< samples
+    QChunkRing<MinMax>  m_levels[LEVELS];       ///< level L+1
+    MinMax              m_acc[LEVELS];          ///< block in progress of level L+1
+    int                 m_accN[LEVELS];
+};
+
+///
+/// \brief Strip chart of channel histories (e.g. roll, pitch, alt, H)
+///
+///     The channels' current values are recorded at a fixed sample rate,
+///     each channel is drawn in its own auto-scaled lane as min/max per
+///     pixel column. Wheel: zoom, drag: pan, double-click: follow the
+///     newest samples.
+///
+class QTrend : public QWidget
+{
+    Q_OBJECT
+
+public:
+    QTrend(QWidget *parent = 0);
+    ~QTrend();
+
+    ///
+    /// \brief Add a channel
+    /// \param name     - lane label
+    /// \param color    - trace color
+    /// \param capacity - samples kept
+    /// \return channel index
+    ///
+    int addChannel(const QString &name, const QColor &color, qint64 capacity = 1 << 24);
+
+    int getChannelCount(void) { return m_channels.size(); }
+    const QTrendChannel* getChannel(int ch) { return m_channels[ch]->data; }
+
+    ///
+    /// \brief Record roll & pitch of an ADI / alt & H of a compass
+    ///     (adds the channels)
+    ///
+    void attach(QADI *adi);
+    void attach(QCompass *compass);
+
+    ///
+    /// \brief Set the current value of a channel, recorded by the sample clock
+    ///
+    void setValue(int ch, double v) { m_channels[ch]->value = v; }
+
+    ///
+    /// \brief Record the current values of all channels now
+    ///
+    void appendSample(void);
+
+    ///
+    /// \brief Set sample rate (in Hz, default 100, 0: appendSample() only)
+    ///
+    void setSampleRate(double hz);
+    double getSampleRate(void) { return m_rate; }
+
+    ///
+    /// \brief Set visible time span (in s, default 60), kept on resize
+    ///
+    void setSpan(double seconds);
+    double getSpan(void) { return m_span; }
+
+    ///
+    /// \brief Keep the newest sample at the right edge (default: on)
+    ///
+    void setFollow(bool on) { m_follow = on; markDirty(); }
+    bool getFollow(void) { return m_follow; }
+
+protected slots:
+    void sample_slot(void);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void wheelEvent(QWheelEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseMoveEvent(QMouseEvent *event);
+    void mouseDoubleClickEvent(QMouseEvent *event);
+
+    void markDirty(void) {
+        QInstrumentScheduler::instance()->markDirty(this);
+    }
+
+    ///
+    /// \brief Plot area (lanes & time axis excluded)
+    ///
+    QRect plotRect(void);
+
+    ///
+    /// \brief Samples per pixel from the time span, rate & plot width
+    ///
+    void updateSpp(void);
+
+    ///
+    /// \brief Newest sample count of all channels
+    ///
+    qint64 getCount(void);
+
+protected:
+    struct Channel {
+        QString             name;
+        QColor              color;
+        QTrendChannel       *data;
+        double              value;              ///< current value
+        int                 source;             ///< SRC_*
+    };
+
+    enum {
+        SRC_VALUE = 0,                          ///< setValue()
+        SRC_ROLL, SRC_PITCH, SRC_ALT, SRC_H
+    };
+
+    QList<Channel*>         m_channels;
+    QPointer<QADI>          m_adi;
+    QPointer<QCompass>      m_compass;
+
+    QTimer                  *m_timer;           ///< sample clock
+    double                  m_rate;             ///< samples per second
+
+    double                  m_span;             ///< visible time span (in s)
+    double                  m_spp;              ///< samples per pixel (from m_span)
+    double                  m_end;              ///< sample at the right edge
+    bool                    m_follow;           ///< m_end tracks the newest sample
+    int                     m_dragX;            ///< pan: last mouse x
+
+    QVector<QTrendChannel::MinMax>  m_cols;     ///< paint buffers, reused
+    QVector<QPointF>                m_pts;
+};
+
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
 ///
-/// \brief The Attitude indicator class
+/// \brief Grid of compact attitude/heading cells, one per vehicle
 ///
-class QADI : public QWidget
+///     All vehicles are kept in one structure-of-arrays table and painted by
+///     a single paintEvent with artwork shared by all cells. Only the cells
+///     whose state changed are repainted.
+///
+class QInstrumentGrid : public QWidget
 {
     Q_OBJECT
 
 public:
-    QADI(QWidget *parent = 0);
-    ~QADI();
+    QInstrumentGrid(QWidget *parent = 0);
+    ~QInstrumentGrid();
 
     ///
-    /// \brief Set roll & pitch values (in degree)
-    /// \param r - roll
-    /// \param p - pitch
+    /// \brief Set number of vehicles
+    /// \param n - vehicle count
     ///
-    void setData(double r, double p) {
-        m_roll = r;
-        m_pitch = p;
-        if( m_roll < -180 ) m_roll = -180;
-        if( m_roll > 180  ) m_roll =  180;
-        if( m_pitch < -90 ) m_pitch = -90;
-        if( m_pitch > 90  ) m_pitch =  90;
+    void setVehicleCount(int n);
 
-        emit canvasReplot();
-    }
+    ///
+    /// \brief Get number of vehicles
+    ///
+    int getVehicleCount(void) {return m_roll.size();}
 
     ///
-    /// \brief Set roll angle (in degree)
-    /// \param val - roll
+    /// \brief Set cell size (height of one cell, the cell is 2x as wide)
+    /// \param px - size (in pixel)
     ///
-    void setRoll(double val) {
-        m_roll  = val;
-        if( m_roll < -180 ) m_roll = -180;
-        if( m_roll > 180  ) m_roll =  180;
+    void setCellSize(int px);
 
-        emit canvasReplot();
-    }
+    ///
+    /// \brief Get cell size (in pixel)
+    ///
+    int getCellSize(void) {return m_cellSize;}
 
     ///
-    /// \brief Set pitch value (in degree)
-    /// \param val
+    /// \brief Set attitude & heading of a vehicle (in degree)
+    /// \param i - vehicle index
+    /// \param r - roll
+    /// \param p - pitch
+    /// \param y - yaw
     ///
-    void setPitch(double val) {
-        m_pitch = val;
-        if( m_pitch < -90 ) m_pitch = -90;
-        if( m_pitch > 90  ) m_pitch =  90;
+    void setData(int i, double r, double p, double y) {
+        if( i < 0 || i >= m_roll.size() ) return;
 
-        emit canvasReplot();
+        m_roll[i]  = qBound(-180.0, r, 180.0);
+        m_pitch[i] = qBound(-90.0, p, 90.0);
+        m_yaw[i]   = normYaw(y, m_yaw[i]);
+        markCellDirty(i);
     }
 
     ///
-    /// \brief Get roll angle (in degree)
-    /// \return roll angle
+    /// \brief Set roll & pitch of a vehicle (in degree)
     ///
-    double getRoll() {return m_roll;}
+    void setAttitude(int i, double r, double p) {
+        if( i < 0 || i >= m_roll.size() ) return;
+
+        m_roll[i]  = qBound(-180.0, r, 180.0);
+        m_pitch[i] = qBound(-90.0, p, 90.0);
+        markCellDirty(i);
+    }
 
     ///
-    /// \brief Get pitch angle (in degree)
-    /// \return pitch angle
+    /// \brief Set yaw of a vehicle (in degree)
     ///
-    double getPitch(){return m_pitch;}
+    void setYaw(int i, double y) {
+        if( i < 0 || i >= m_roll.size() ) return;
 
+        m_yaw[i] = normYaw(y, m_yaw[i]);
+        markCellDirty(i);
+    }
 
-signals:
-    void canvasReplot(void);
+    double getRoll(int i)  {return m_roll[i];}
+    double getPitch(int i) {return m_pitch[i];}
+    double getYaw(int i)   {return m_yaw[i];}
 
-protected slots:
-    void canvasReplot_slot(void);
+    bool hasHeightForWidth(void) const {return true;}
+    int  heightForWidth(int w) const;
+    QSize sizeHint(void) const;
 
 protected:
     void paintEvent(QPaintEvent *event);
     void resizeEvent(QResizeEvent *event);
-    void keyPressEvent(QKeyEvent *event);
+
+    ///
+    /// \brief Yaw in [0, 360), or prev for a non-finite value
+    ///
+    static float normYaw(double y, float prev) {
+        if( !qIsFinite(y) ) return prev;
+
+        y = std::fmod(y, 360.0);
+        if( y < 0 ) y += 360;
+        return y >= 360 ? 0 : y;
+    }
+
+    void markCellDirty(int i) {
+        if( m_dirty[i] ) return;
+
+        m_dirty[i] = 1;
+        QInstrumentScheduler::instance()->markDirty(this, cellRect(i));
+    }
+
+    int   columns(int w) const;
+    QRect cellRect(int i) const;
+    void  paintCell(QPainter &painter, int i, const QRect &rc);
+
+    ///
+    /// \brief Rebuild the artwork shared by all cells
+    ///
+    void buildArtwork(void);
 
 protected:
-    int     m_sizeMin, m_sizeMax;           ///< widget's min/max size (in pixel)
-    int     m_size, m_offset;               ///< current size & offset
+    int                 m_cellSize;             ///< cell height (in pixel)
+    int                 m_cols;                 ///< current column count
 
-    double  m_roll;                         ///< roll angle (in degree)
-    double  m_pitch;                        ///< pitch angle (in degree)
+    QVector<float>      m_roll;                 ///< roll of each vehicle (in degree)
+    QVector<float>      m_pitch;                ///< pitch of each vehicle (in degree)
+    QVector<float>      m_yaw;                  ///< yaw of each vehicle (in degree)
+    QVector<quint8>     m_dirty;                ///< cell needs repaint
+
+    QVector<QStaticText> m_labels;              ///< vehicle index labels
+
+    QImage              m_skyLayer;             ///< sky/ground strip
+    QImage              m_adiBezel;             ///< ADI rim, roll ticks & aircraft
+    QImage              m_compassDial;          ///< compass dial
+    QPainterPath        m_cellClip;             ///< ADI disc of a cell
+    QFont               m_labelFont;            ///< vehicle index font
+    int                 m_artSize;              ///< cell size of the artwork
+    qreal               m_artDpr;               ///< device pixel ratio of the artwork
 };
 
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
 ///
-/// \brief The Compass & altitude display class
+/// \brief Lock-free single-producer/single-consumer ring buffer
 ///
-class QCompass : public QWidget
+///     N must be a power of two. push() is called by exactly one thread and
+///     pop() by exactly one (other) thread; neither blocks nor allocates.
+///
+template<typename T, int N>
+class QSpscRing
 {
-    Q_OBJECT
-
 public:
-    QCompass(QWidget *parent = 0);
-    ~QCompass();
+    QSpscRing() : m_head(0), m_tail(0), m_tailCache(0), m_overrun(0) {
+        Q_STATIC_ASSERT_X((N & (N-1)) == 0, "N must be a power of two");
+    }
 
     ///
-    /// \brief Set all data (yaw, alt, height)
-    ///
-    /// \param y - yaw ( in degree)
-    /// \param a - altitude ( in m)
-    /// \param h - height from ground (in m)
+    /// \brief Push an item (producer thread only)
+    /// \param v - item
+    /// \return false if the ring is full (item dropped)
     ///
-    void setData(double y, double a, double h) {
-        m_yaw = y;
-        m_alt = a;
-        m_h   = h;
+    bool push(const T &v) {
+        quint32 h = atomicLoad(m_head);
 
-        if( m_yaw < 0   ) m_yaw = 360 + m_yaw;
-        if( m_yaw > 360 ) m_yaw = m_yaw - 360;
+        if( h - m_tailCache == (quint32) N ) {
+            m_tailCache = m_tail.loadAcquire();
+            if( h - m_tailCache == (quint32) N ) {
+                m_overrun.fetchAndAddRelaxed(1);
+                return false;
+            }
+        }
 
-        emit canvasReplot();
+        m_buf[h & (N-1)] = v;
+        m_head.storeRelease(h + 1);
+
+        return true;
     }
 
     ///
-    /// \brief Set yaw angle (in degree)
-    /// \param val - yaw angle (in degree)
+    /// \brief Pop an item (consumer thread only)
+    /// \param v - output item
+    /// \return false if the ring is empty
     ///
-    void setYaw(double val) {
-        m_yaw  = val;
-        if( m_yaw < 0   ) m_yaw = 360 + m_yaw;
-        if( m_yaw > 360 ) m_yaw = m_yaw - 360;
+    bool pop(T &v) {
+        quint32 t = atomicLoad(m_tail);
 
-        emit canvasReplot();
+        if( t == m_head.loadAcquire() ) return false;
+
+        v = m_buf[t & (N-1)];
+        m_tail.storeRelease(t + 1);
+
+        return true;
     }
 
     ///
-    /// \brief Set altitude value
-    /// \param val - altitude (in m)
+    /// \brief Number of items currently queued (approximate)
     ///
-    void setAlt(double val) {
-        m_alt = val;
-
-        emit canvasReplot();
-    }
+    int size(void) { return (int) (m_head.loadAcquire() - m_tail.loadAcquire()); }
 
     ///
-    /// \brief Set height from ground
-    /// \param val - height (in m)
+    /// \brief Number of items dropped because the ring was full
     ///
-    void setH(double val) {
-        m_h = val;
+    int getOverrunCount(void) { return atomicLoad(m_overrun); }
 
-        emit canvasReplot();
-    }
+protected:
+    // head/tail on separate cache lines to avoid false sharing; free-running
+    //  unsigned counters, so head - tail stays right when they wrap
+    QAtomicInteger<quint32> m_head;             ///< written by producer
+    char        m_pad0[64];
+    QAtomicInteger<quint32> m_tail;             ///< written by consumer
+    char        m_pad1[64];
+    quint32     m_tailCache;                    ///< producer's copy of m_tail
+    QAtomicInt  m_overrun;                      ///< dropped pushes
+    char        m_pad2[64];
+    T           m_buf[N];
+};
+
+
+///
+/// \brief One telemetry sample
+///
+struct QTelemetrySample
+{
+    enum Type {
+        ATTITUDE,                               ///< v[0] roll, v[1] pitch (in degree)
+        HEADING,                                ///< v[0] yaw (in degree)
+        ALTITUDE                                ///< v[0] alt, v[1] height from ground (in m)
+    };
+
+    int         type;                           ///< sample type
+    qint64      t;                              ///< timestamp (steady clock, in ns)
+    double      v[2];                           ///< values
+};
+
+///
+/// \brief Telemetry ingestion queue
+///
+///     A non-GUI thread pushes samples without locking or allocating; the
+///     GUI thread drains the queue once per display frame and forwards the
+///     timestamped samples to the attached instruments.
+///
+class QTelemetryQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    QTelemetryQueue(QObject *parent = 0);
+    virtual ~QTelemetryQueue();
 
     ///
-    /// \brief Get yaw angle
-    /// \return yaw angle (in degree)
+    /// \brief Attach instruments (GUI thread)
     ///
-    double getYaw() {return m_yaw;}
+    void attach(QADI *adi)          { m_adi = adi; }
+    void attach(QCompass *compass)  { m_compass = compass; }
 
     ///
-    /// \brief Get altitude value
-    /// \return altitude (in m)
+    /// \brief Push samples (producer thread)
+    /// \return false if the queue is full
     ///
-    double getAlt() {return m_alt;}
+    bool push(const QTelemetrySample &s) { return m_ring.push(s); }
+
+    bool pushAttitude(double roll, double pitch) {
+        QTelemetrySample s = { QTelemetrySample::ATTITUDE, now(), { roll, pitch } };
+        return m_ring.push(s);
+    }
+
+    bool pushHeading(double yaw) {
+        QTelemetrySample s = { QTelemetrySample::HEADING, now(), { yaw, 0 } };
+        return m_ring.push(s);
+    }
+
+    bool pushAltitude(double alt, double h) {
+        QTelemetrySample s = { QTelemetrySample::ALTITUDE, now(), { alt, h } };
+        return m_ring.push(s);
+    }
 
     ///
-    /// \brief Get height from ground
-    /// \return height from ground (in m)
+    /// \brief Steady clock timestamp (in ns)
     ///
-    double getH()   {return m_h;}
+    static qint64 now(void);
 
-signals:
-    void canvasReplot(void);
+    ///
+    /// \brief Drain all queued samples now (GUI thread)
+    /// \return number of samples drained
+    ///
+    int drain(void);
 
-protected slots:
-    void canvasReplot_slot(void);
+    int getOverrunCount(void) { return m_ring.getOverrunCount(); }
 
-protected:
-    void paintEvent(QPaintEvent *event);
-    void resizeEvent(QResizeEvent *event);
-    void keyPressEvent(QKeyEvent *event);
+protected slots:
+    void drain_slot(void);
 
 protected:
-    int     m_sizeMin, m_sizeMax;               ///< widget min/max size (in pixel)
-    int     m_size, m_offset;                   ///< widget size and offset size
+    QSpscRing<QTelemetrySample, 1024>   m_ring;
 
-    double  m_yaw;                              ///< yaw angle (in degree)
-    double  m_alt;                              ///< altitude (in m)
-    double  m_h;                                ///< height from ground (in m)
+    QPointer<QADI>                      m_adi;
+    QPointer<QCompass>                  m_compass;
+    QTimer                              *m_timer;   ///< per-frame drain timer
 };
 
 
@@ -201,10 +2372,75 @@ protected:
 
 typedef QMap<QString, QString> ListMap;
 
+///
+/// \brief Key-value table model with typed values
+///
+///     Rows are kept sorted by key. Values are stored typed and only
+///     formatted when the view asks for a (visible) cell; changing a value
+///     emits dataChanged for that single cell. GUI thread only.
+///
+class QKeyValueModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    QKeyValueModel(QObject *parent = 0);
+    virtual ~QKeyValueModel();
+
+    ///
+    /// \brief Set value of a key (the key is added if not exist)
+    /// \param key - key name
+    /// \param v   - value
+    ///
+    void setValue(const QString &key, double v);
+    void setValue(const QString &key, int v);
+    void setValue(const QString &key, const QString &v);
+
+    ///
+    /// \brief Remove a key
+    /// \param key - key name
+    ///
+    void removeKey(const QString &key);
+
+    ///
+    /// \brief Get all keys (sorted)
+    ///
+    QStringList keys(void) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const;
+
+protected:
+    struct Entry {
+        enum Type { DOUBLE, INT, STRING };
+
+        QString     key;
+        int         type;
+        double      d;
+        qint64      i;
+        QString     s;
+    };
+
+    ///
+    /// \brief Find row of key, add a new row if not exist
+    ///
+    int findOrInsert(const QString &key);
+
+    void valueChanged(int row);
+
+protected:
+    QVector<Entry>          m_entries;          ///< rows, sorted by key
+    QHash<QString, int>     m_index;            ///< key -> row
+    QFont                   m_font;             ///< cell font
+};
+
 ///
 /// \brief The List view class, it will display key-value pair in lines
 ///
-class QKeyValueListView : public QTableWidget
+class QKeyValueListView : public QTableView
 {
 public:
     Q_OBJECT
@@ -213,6 +2449,36 @@ public:
     QKeyValueListView(QWidget *parent = 0);
     virtual ~QKeyValueListView();
 
+    ///
+    /// \brief Set typed value of a key (GUI thread), only this row is updated
+    /// \param key - key name
+    /// \param v   - value
+    ///
+    void setValue(const QString &key, double v)         { m_model->setValue(key, v); if( m_stats ) valueChanged(); }
+    void setValue(const QString &key, int v)            { m_model->setValue(key, v); if( m_stats ) valueChanged(); }
+    void setValue(const QString &key, const QString &v) { m_model->setValue(key, v); if( m_stats ) valueChanged(); }
+
+    ///
+    /// \brief Enable/disable paint statistics (default: disabled)
+    ///
+    void setStatsEnabled(bool on);
+
+    ///
+    /// \brief Get paint statistics, NULL if disabled
+    ///
+    const QPaintStats* getStats(void) { return m_stats; }
+
+    ///
+    /// \brief Show/hide the statistics overlay (enables statistics)
+    ///
+    void setHudVisible(bool on);
+    bool getHudVisible(void) { return m_hud; }
+
+    ///
+    /// \brief Get the table model
+    ///
+    QKeyValueModel* getModel(void) { return m_model; }
+
     ///
     /// \brief Set list data
     /// \param d - list data
@@ -223,7 +2489,8 @@ public:
     }
 
     ///
-    /// \brief Get list data
+    /// \brief Get list data (only the keys given by setData, not those
+    ///     set with the typed setValue)
     /// \param d - list data obj
     ///
     ListMap& getData(void) {
@@ -239,7 +2506,7 @@ public:
     }
 
     ///
-    /// \brief Reloat data to table widget
+    /// \brief Reloat data to table (only changed keys are updated)
     ///
     void listReload(void) {
         emit listUpdate();
@@ -250,10 +2517,26 @@ signals:
 
 protected slots:
     void listUpdate_slot(void);
+    void hudRefresh_slot(void);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void scrollContentsBy(int dx, int dy);
+
+    ///
+    /// \brief Count a value change, keep the overlay in the dirty region
+    ///
+    void valueChanged(void);
 
 protected:
     ListMap         m_data;
+    QSet<QString>   m_dataKeys;         ///< model keys which came from m_data
     QMutex          *m_mutex;
+    QKeyValueModel  *m_model;
+
+    QPaintStats     *m_stats;           ///< paint statistics, or NULL
+    bool            m_hud;              ///< statistics overlay visible
+    QTimer          *m_hudTimer;        ///< repaints the overlay when painting stops
 };
 
 #endif // end of __QFLIGHTINSTRUMENTS_H__
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT += core gui widgets
+QT += core gui widgets quick qml network
 
 
 TARGET = qFlightInstruments
@@ -15,8 +15,18 @@ QMAKE_CXXFLAGS += -std=c++11
 SOURCES += main.cpp \
         TestWin.cpp \
         qFlightInstruments.cpp \
+        qTelemetryLog.cpp \
+        qMavlinkSource.cpp \
+        qInstrumentExport.cpp \
+        qQuickInstruments.cpp \
+        qInstrumentStream.cpp \
 
 
 HEADERS  += qFlightInstruments.h \
+            qTelemetryLog.h \
+            qMavlinkSource.h \
+            qInstrumentExport.h \
+            qQuickInstruments.h \
+            qInstrumentStream.h \
             TestWin.h
 
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <QtCore>
+#include <QtGui>
+
+#include "qInstrumentExport.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Render thread of QInstrumentExporter
+///
+class QExportWorker : public QThread
+{
+public:
+    QExportWorker(QInstrumentExporter *exp) : m_exp(exp) {}
+
+protected:
+    void run(void) { m_exp->workerLoop(); }
+
+    QInstrumentExporter *m_exp;
+};
+
+
+QInstrumentExporter::QInstrumentExporter()
+{
+    m_fps          = 30;
+    m_size         = 196;
+    m_threads      = 0;
+    m_antialiasing = true;
+
+    m_raw     = NULL;
+    m_written = 0;
+    m_elapsed = 0;
+}
+
+QInstrumentExporter::~QInstrumentExporter()
+{
+
+}
+
+int QInstrumentExporter::open(const QString &fname)
+{
+    QTelemetryReplayer  replayer;
+    qint64              n;
+
+    if( replayer.open(fname) != 0 ) return -1;
+
+    // sample the log once per frame, the workers only read this table
+    n = (qint64) (replayer.getDuration() * m_fps / 1e9) + 1;
+
+    m_frames.resize(n * QTelemetryLog::CH_NUM);
+
+    for(qint64 i=0; i<n; i++) {
+        double *v = m_frames.data() + i*QTelemetryLog::CH_NUM;
+
+        replayer.advance((qint64) (i * 1e9 / m_fps));
+
+        for(int c=0; c<QTelemetryLog::CH_NUM; c++) v[c] = replayer.getValue(c);
+    }
+
+    return 0;
+}
+
+QSize QInstrumentExporter::getFrameSize(void)
+{
+    QADIRenderer    adi;
+
+    adi.setSize(m_size);
+
+    return QSize(2*adi.getImageSize(), adi.getImageSize());
+}
+
+void QInstrumentExporter::renderFrame(int i, QADIRenderer &adi, QCompassRenderer &compass,
+                                      QImage &img)
+{
+    const double    *v = m_frames.constData() + i*QTelemetryLog::CH_NUM;
+    int             s = adi.getImageSize();
+    double          yaw = v[QTelemetryLog::CH_YAW];
+
+    if( yaw < 0   ) yaw = 360 + yaw;
+    if( yaw > 360 ) yaw = yaw - 360;
+
+    img.fill(Qt::transparent);
+
+    QPainter painter(&img);
+
+    painter.translate(s / 2, s / 2);
+    adi.render(painter,
+               qBound(-180.0, v[QTelemetryLog::CH_ROLL],  180.0),
+               qBound(-90.0,  v[QTelemetryLog::CH_PITCH], 90.0));
+
+    painter.resetTransform();
+    painter.translate(s + s / 2, s / 2);
+    compass.render(painter, yaw, v[QTelemetryLog::CH_ALT], v[QTelemetryLog::CH_H]);
+}
+
+bool QInstrumentExporter::writeFrame(int i, const QImage &img)
+{
+    bool    ok;
+
+    if( !m_raw )
+        return img.save(QString::asprintf(qPrintable(m_pattern), i), "PNG");
+
+    // convert in parallel, write in frame order
+    QImage rgba = img.convertToFormat(QImage::Format_RGBA8888);
+
+    QMutexLocker locker(&m_mutex);
+
+    while( m_written != i ) m_cond.wait(&m_mutex);
+
+    ok = true;
+    for(int y=0; y<rgba.height() && ok; y++)
+        ok = fwrite(rgba.constScanLine(y), 4, rgba.width(), m_raw) == (size_t) rgba.width();
+
+    m_written++;
+    m_cond.wakeAll();
+
+    return ok;
+}
+
+void QInstrumentExporter::workerLoop(void)
+{
+    // private resources: fonts & static texts are not shared across threads
+    QADIRenderer        adi(false);
+    QCompassRenderer    compass(false);
+    int                 n = getFrameCount();
+    int                 i;
+
+    adi.setSize(m_size);
+    adi.setAntialiasing(m_antialiasing);
+    compass.setSize(m_size);
+    compass.setAntialiasing(m_antialiasing);
+
+    QImage img(2*adi.getImageSize(), adi.getImageSize(), QImage::Format_ARGB32_Premultiplied);
+
+    while( (i = m_next.fetchAndAddRelaxed(1)) < n ) {
+        renderFrame(i, adi, compass, img);
+
+        if( !writeFrame(i, img) ) atomicStore(m_failed, 1);
+    }
+}
+
+int QInstrumentExporter::run(void)
+{
+    QElapsedTimer   clock;
+    int             n = m_threads > 0 ? m_threads : QThread::idealThreadCount();
+
+    clock.start();
+
+    atomicStore(m_next, 0);
+    atomicStore(m_failed, 0);
+    m_written = 0;
+
+    if( !QFontDatabase::supportsThreadedFontRendering() ) {
+        // text can only be drawn on the GUI thread here
+        workerLoop();
+    } else {
+        QList<QExportWorker*> workers;
+
+        for(int i=0; i<qMax(1, n); i++) {
+            workers.append(new QExportWorker(this));
+            workers.last()->start();
+        }
+
+        for(int i=0; i<workers.size(); i++) {
+            workers[i]->wait();
+            delete workers[i];
+        }
+    }
+
+    m_elapsed = clock.elapsed();
+
+    return atomicLoad(m_failed) ? -1 : 0;
+}
+
+int QInstrumentExporter::exportPng(const QString &pattern)
+{
+    // the pattern goes to asprintf: exactly one integer conversion ("%%" is fine)
+    QString conv = QString(pattern).remove("%%");
+
+    if( conv.count('%') != 1 || !conv.contains(QRegularExpression("%0?\\d*d")) ) {
+        qWarning("PNG pattern needs exactly one %%d conversion (e.g. out/%%06d.png): %s",
+                 qPrintable(pattern));
+        return -1;
+    }
+
+    m_pattern = pattern;
+    m_raw     = NULL;
+
+    return run();
+}
+
+int QInstrumentExporter::exportRaw(FILE *f)
+{
+    int     ret;
+
+    m_raw = f;
+    ret = run();
+    fflush(f);
+    m_raw = NULL;
+
+    return ret;
+}
@@ -0,0 +1,118 @@
+#ifndef __QINSTRUMENTEXPORT_H__
+#define __QINSTRUMENTEXPORT_H__
+
+#include <stdio.h>
+
+#include <QtCore>
+#include <QtGui>
+
+#include "qFlightInstruments.h"
+#include "qTelemetryLog.h"
+
+///
+/// \brief Headless export of instrument overlays from a telemetry log
+///
+///     Every output frame holds the ADI (left) and the compass (right) on a
+///     transparent background. The log is sampled once per frame, then the
+///     frames are rendered into QImages by one worker thread per core, each
+///     with its own renderers. Output is an ordered PNG sequence or raw
+///     RGBA frames (e.g. piped into an encoder).
+///
+class QInstrumentExporter
+{
+public:
+    QInstrumentExporter();
+    virtual ~QInstrumentExporter();
+
+    ///
+    /// \brief Load a telemetry log and sample it at the frame rate
+    /// \param fname - log file name
+    /// \return 0 on success
+    ///
+    int open(const QString &fname);
+
+    void setFps(double fps)         { m_fps = fps > 0 ? fps : 30; }
+    double getFps(void)             { return m_fps; }
+
+    ///
+    /// \brief Set instrument size
+    /// \param size - disc diameter (in pixel)
+    ///
+    void setSize(int size)          { m_size = size; }
+
+    ///
+    /// \brief Set number of render threads (0: one per core)
+    ///
+    void setThreads(int n)          { m_threads = n; }
+
+    void setAntialiasing(bool aa)   { m_antialiasing = aa; }
+
+    int getFrameCount(void)         { return m_frames.size() / QTelemetryLog::CH_NUM; }
+    QSize getFrameSize(void);
+
+    ///
+    /// \brief Write frames as PNG files
+    /// \param pattern - file name with a printf-style frame number, e.g. "out/%06d.png"
+    ///     (exactly one "%d" / "%0<width>d", "%%" for a literal percent sign)
+    /// \return 0 on success, -1 on an invalid pattern or a write error
+    ///
+    int exportPng(const QString &pattern);
+
+    ///
+    /// \brief Write frames as raw RGBA (8 bit, straight alpha), in order
+    /// \param f - output stream (e.g. stdout)
+    /// \return 0 on success
+    ///
+    int exportRaw(FILE *f);
+
+    ///
+    /// \brief Duration of the last export (in ms)
+    ///
+    qint64 getElapsed(void)         { return m_elapsed; }
+
+protected:
+    friend class QExportWorker;
+
+    ///
+    /// \brief Render one frame with a worker's renderers
+    ///
+    void renderFrame(int i, QADIRenderer &adi, QCompassRenderer &compass, QImage &img);
+
+    ///
+    /// \brief Render all frames on the worker threads
+    /// \return 0 on success
+    ///
+    int run(void);
+
+    ///
+    /// \brief Worker: take the next frame, render & write it, until done
+    ///
+    void workerLoop(void);
+
+    ///
+    /// \brief Write a rendered frame (worker thread)
+    ///
+    bool writeFrame(int i, const QImage &img);
+
+protected:
+    QVector<double>     m_frames;               ///< CH_NUM values per frame
+    double              m_fps;
+    int                 m_size;
+    int                 m_threads;
+    bool                m_antialiasing;
+
+    QString             m_pattern;              ///< PNG file pattern
+    FILE                *m_raw;                 ///< raw output (ordered)
+
+    QAtomicInt          m_next;                 ///< next frame to render
+    QAtomicInt          m_failed;               ///< a frame could not be written
+
+    // raw output: a rendered frame waits until all earlier ones are written
+    QMutex              m_mutex;
+    QWaitCondition      m_cond;
+    int                 m_written;              ///< frames written so far
+
+    qint64              m_elapsed;
+};
+
+#endif // end of __QINSTRUMENTEXPORT_H__
@@ -0,0 +1,593 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <QtCore>
+#include <QtGui>
+#include <QtEndian>
+#include <QtNetwork>
+
+#include "qInstrumentStream.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Split a TCP address ("port" or "host:port")
+/// \return false for a local socket name
+///
+static bool parseTcpAddress(const QString &address, QString *host, quint16 *port)
+{
+    int     i = address.lastIndexOf(':');
+    bool    ok;
+
+    *host = i < 0 ? QString("127.0.0.1") : address.left(i);
+    *port = address.mid(i + 1).toUShort(&ok);
+
+    return ok && *port != 0;
+}
+
+///
+/// \brief Pending output above which a client is skipped (it gets all
+///     tiles again once it caught up)
+///
+static const qint64 g_maxBacklog = 1 << 20;
+
+
+QInstrumentStreamServer::QInstrumentStreamServer(QObject *parent)
+    : QObject(parent)
+{
+    m_tcp   = NULL;
+    m_local = NULL;
+
+    m_size  = 196;
+    m_tile  = 32;
+    m_level = 1;
+
+    for(int i=0; i<5; i++) m_v[i] = m_painted[i] = 0;
+    m_frameValid = false;
+
+    m_cols = m_rows = 0;
+    m_seq  = 0;
+
+    m_frames = m_bytes = 0;
+    m_winFrames = m_winBytes = m_winTiles = 0;
+    m_winEncodeNs = 0;
+    m_bytesPerFrame = m_tilesPerFrame = m_encodeUs = 0;
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(33);
+    connect(m_timer, SIGNAL(timeout(void)), this, SLOT(frame_slot(void)));
+
+    m_statsTimer = new QTimer(this);
+    m_statsTimer->setInterval(1000);
+    connect(m_statsTimer, SIGNAL(timeout(void)), this, SLOT(stats_slot(void)));
+}
+
+QInstrumentStreamServer::~QInstrumentStreamServer()
+{
+    close();
+}
+
+int QInstrumentStreamServer::listen(const QString &address)
+{
+    QString     host;
+    quint16     port;
+
+    close();
+
+    if( parseTcpAddress(address, &host, &port) ) {
+        QHostAddress    addr;
+
+        // "host:port" may name the host, QHostAddress only parses literals
+        if( !addr.setAddress(host) ) {
+            QHostInfo   info = QHostInfo::fromName(host);
+
+            if( info.addresses().isEmpty() ) {
+                qWarning("QInstrumentStreamServer: can not resolve %s: %s",
+                         qPrintable(host), qPrintable(info.errorString()));
+                return -1;
+            }
+            addr = info.addresses().first();
+        }
+
+        m_tcp = new QTcpServer(this);
+        connect(m_tcp, SIGNAL(newConnection(void)), this, SLOT(newConnection_slot(void)));
+
+        if( !m_tcp->listen(addr, port) ) {
+            qWarning("QInstrumentStreamServer: can not listen on %s: %s",
+                     qPrintable(address), qPrintable(m_tcp->errorString()));
+            close();
+            return -1;
+        }
+    } else {
+        m_local = new QLocalServer(this);
+        connect(m_local, SIGNAL(newConnection(void)), this, SLOT(newConnection_slot(void)));
+
+        // a crashed server may have left its socket file behind
+        QLocalServer::removeServer(address);
+
+        if( !m_local->listen(address) ) {
+            qWarning("QInstrumentStreamServer: can not listen on %s: %s",
+                     qPrintable(address), qPrintable(m_local->errorString()));
+            close();
+            return -1;
+        }
+    }
+
+    m_timer->start();
+    m_statsTimer->start();
+
+    return 0;
+}
+
+void QInstrumentStreamServer::close(void)
+{
+    m_timer->stop();
+    m_statsTimer->stop();
+
+    for(int i=0; i<m_clients.size(); i++) {
+        if( !m_clients[i].dev ) continue;
+        m_clients[i].dev->disconnect(this);
+        m_clients[i].dev->deleteLater();
+    }
+    m_clients.clear();
+
+    delete m_tcp;
+    delete m_local;
+    m_tcp   = NULL;
+    m_local = NULL;
+}
+
+void QInstrumentStreamServer::setData(double roll, double pitch, double yaw, double alt, double h)
+{
+    m_v[0] = roll;
+    m_v[1] = pitch;
+    m_v[2] = yaw;
+    m_v[3] = alt;
+    m_v[4] = h;
+}
+
+void QInstrumentStreamServer::setSize(int size)
+{
+    m_size = size;
+    m_frameValid = false;
+    m_prev = QImage();
+}
+
+void QInstrumentStreamServer::setTileSize(int size)
+{
+    m_tile = qBound(8, size, 256);
+    m_frameValid = false;
+    m_prev = QImage();
+}
+
+void QInstrumentStreamServer::setFps(double fps)
+{
+    m_timer->setInterval(qMax(1, qRound(1000.0 / (fps > 0 ? fps : 30))));
+}
+
+void QInstrumentStreamServer::newConnection_slot(void)
+{
+    if( m_tcp ) {
+        while( m_tcp->hasPendingConnections() ) {
+            QTcpSocket *s = m_tcp->nextPendingConnection();
+
+            // small tile messages should not wait for Nagle
+            s->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+            addClient(s);
+        }
+    }
+
+    if( m_local ) {
+        while( m_local->hasPendingConnections() )
+            addClient(m_local->nextPendingConnection());
+    }
+}
+
+void QInstrumentStreamServer::addClient(QIODevice *dev)
+{
+    Client c;
+
+    c.dev     = dev;
+    c.needAll = true;
+
+    connect(dev, SIGNAL(disconnected(void)), this, SLOT(disconnected_slot(void)));
+    m_clients.append(c);
+}
+
+void QInstrumentStreamServer::disconnected_slot(void)
+{
+    QIODevice *dev = qobject_cast<QIODevice*>(sender());
+
+    for(int i=m_clients.size()-1; i>=0; i--) {
+        if( m_clients[i].dev == dev || !m_clients[i].dev ) m_clients.removeAt(i);
+    }
+
+    if( dev ) dev->deleteLater();
+}
+
+void QInstrumentStreamServer::renderFrame(void)
+{
+    int     s = m_size + 4;                     // renderer image size (2 px rim)
+
+    m_adiRenderer.setSize(m_size);
+    m_compassRenderer.setSize(m_size);
+
+    if( m_frame.width() != 2*s || m_frame.height() != s )
+        m_frame = QImage(2*s, s, QImage::Format_ARGB32_Premultiplied);
+
+    m_frame.fill(Qt::transparent);
+
+    QPainter painter(&m_frame);
+
+    painter.translate(s / 2, s / 2);
+    m_adiRenderer.render(painter,
+                         qBound(-180.0, m_v[0], 180.0),
+                         qBound(-90.0,  m_v[1], 90.0));
+
+    painter.resetTransform();
+    painter.translate(s + s / 2, s / 2);
+    m_compassRenderer.render(painter, m_v[2], m_v[3], m_v[4]);
+
+    for(int i=0; i<5; i++) m_painted[i] = m_v[i];
+}
+
+int QInstrumentStreamServer::diffTiles(void)
+{
+    int     w = m_frame.width(), h = m_frame.height();
+    int     cols = (w + m_tile - 1) / m_tile;
+    int     rows = (h + m_tile - 1) / m_tile;
+    bool    all = m_prev.size() != m_frame.size() || cols != m_cols || rows != m_rows;
+
+    if( all ) {
+        m_cols = cols;
+        m_rows = rows;
+        m_tileData.fill(QByteArray(), cols*rows);
+    }
+
+    m_changed.resize(0);
+
+    for(int ty=0; ty<rows; ty++) {
+        int     y0 = ty*m_tile;
+        int     th = qMin(m_tile, h - y0);
+
+        for(int tx=0; tx<cols; tx++) {
+            int     x0 = tx*m_tile;
+            int     tw = qMin(m_tile, w - x0);
+            bool    changed = all;
+
+            for(int y=y0; y<y0+th && !changed; y++)
+                changed = memcmp(m_frame.constScanLine(y) + 4*x0,
+                                 m_prev.constScanLine(y) + 4*x0, 4*tw) != 0;
+
+            if( !changed ) continue;
+
+            // recompress the tile, kept for clients which need all tiles
+            m_raw.resize(4*tw*th);
+            for(int y=0; y<th; y++)
+                memcpy(m_raw.data() + 4*tw*y, m_frame.constScanLine(y0 + y) + 4*x0, 4*tw);
+
+            m_tileData[ty*cols + tx] = qCompress(m_raw, m_level);
+            m_changed.append(ty*cols + tx);
+        }
+    }
+
+    // keep this frame for the next diff (a deep copy, m_frame is painted again)
+    if( m_prev.size() != m_frame.size() ) m_prev = m_frame.copy();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    else memcpy(m_prev.bits(), m_frame.constBits(), m_frame.sizeInBytes());
+#else
+    else memcpy(m_prev.bits(), m_frame.constBits(), m_frame.byteCount());
+#endif
+
+    return m_changed.size();
+}
+
+void QInstrumentStreamServer::buildMessage(QByteArray &msg, bool all)
+{
+    int     n = all ? m_tileData.size() : m_changed.size();
+    int     len = QInstrumentStream::HEADER_SIZE;
+    uchar   *p;
+
+    for(int i=0; i<n; i++)
+        len += QInstrumentStream::TILE_HEADER_SIZE + m_tileData[all ? i : m_changed[i]].size();
+
+    msg.resize(len);
+    p = (uchar*) msg.data();
+
+    qToLittleEndian<quint32>(QInstrumentStream::MAGIC, p);
+    qToLittleEndian<quint32>(len - QInstrumentStream::HEADER_SIZE, p + 4);
+    qToLittleEndian<quint16>(m_frame.width(), p + 8);
+    qToLittleEndian<quint16>(m_frame.height(), p + 10);
+    qToLittleEndian<quint16>(m_tile, p + 12);
+    qToLittleEndian<quint16>(n, p + 14);
+    qToLittleEndian<quint32>(m_seq, p + 16);
+    p += QInstrumentStream::HEADER_SIZE;
+
+    for(int i=0; i<n; i++) {
+        int                 k = all ? i : m_changed[i];
+        const QByteArray    &d = m_tileData[k];
+
+        qToLittleEndian<quint16>(k % m_cols, p);
+        qToLittleEndian<quint16>(k / m_cols, p + 2);
+        qToLittleEndian<quint32>(d.size(), p + 4);
+        memcpy(p + QInstrumentStream::TILE_HEADER_SIZE, d.constData(), d.size());
+
+        p += QInstrumentStream::TILE_HEADER_SIZE + d.size();
+    }
+}
+
+void QInstrumentStreamServer::frame_slot(void)
+{
+    qint64  t0;
+    bool    same = m_frameValid;
+    bool    anyAll = false;
+    int     nChanged;
+
+    if( m_adi ) {
+        m_v[0] = m_adi->getRoll();
+        m_v[1] = m_adi->getPitch();
+    }
+    if( m_compass ) {
+        m_v[2] = m_compass->getYaw();
+        m_v[3] = m_compass->getAlt();
+        m_v[4] = m_compass->getH();
+    }
+
+    for(int i=0; i<m_clients.size(); i++) anyAll |= m_clients[i].needAll;
+    for(int i=0; i<5; i++) same &= m_v[i] == m_painted[i];
+
+    // nothing to send: no clients, or no change and nobody waits for a full frame
+    if( m_clients.isEmpty() || (same && !anyAll) ) return;
+
+    if( !same ) renderFrame();
+
+    t0 = QTelemetryQueue::now();
+
+    nChanged = same ? 0 : diffTiles();
+    m_frameValid = true;
+    m_seq++;
+
+    if( nChanged > 0 ) buildMessage(m_msg, false);
+    if( anyAll ) buildMessage(m_allMsg, true);
+
+    m_winEncodeNs += QTelemetryQueue::now() - t0;
+
+    if( nChanged > 0 ) {
+        m_frames++;
+        m_winFrames++;
+        m_winTiles += nChanged;
+        m_winBytes += m_msg.size();
+    }
+
+    for(int i=0; i<m_clients.size(); i++) {
+        Client  &c = m_clients[i];
+
+        if( !c.dev ) continue;
+
+        // a slow client skips frames and catches up with all tiles later
+        if( c.dev->bytesToWrite() > g_maxBacklog ) {
+            c.needAll = true;
+            continue;
+        }
+
+        if( c.needAll ) {
+            c.dev->write(m_allMsg);
+            m_bytes += m_allMsg.size();
+            c.needAll = false;
+        } else if( nChanged > 0 ) {
+            c.dev->write(m_msg);
+            m_bytes += m_msg.size();
+        }
+    }
+}
+
+void QInstrumentStreamServer::stats_slot(void)
+{
+    m_bytesPerFrame = m_winFrames ? (double) m_winBytes / m_winFrames : 0;
+    m_tilesPerFrame = m_winFrames ? (double) m_winTiles / m_winFrames : 0;
+    m_encodeUs      = m_winFrames ? m_winEncodeNs / 1e3 / m_winFrames : 0;
+
+    m_winFrames = m_winBytes = m_winTiles = 0;
+    m_winEncodeNs = 0;
+
+    if( m_list ) {
+        m_list->setValue("stream clients", m_clients.size());
+        m_list->setValue("stream B/frame", m_bytesPerFrame);
+        m_list->setValue("stream tiles",   m_tilesPerFrame);
+        m_list->setValue("stream enc us",  m_encodeUs);
+    }
+
+    emit statistics(m_bytesPerFrame, m_tilesPerFrame, m_encodeUs);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+QInstrumentStreamViewer::QInstrumentStreamViewer(QWidget *parent)
+    : QWidget(parent)
+{
+    m_dev = NULL;
+
+    m_frames = m_bytes = 0;
+    m_winFrames = m_winBytes = 0;
+
+    setMinimumSize(200, 100);
+
+    m_statsTimer = new QTimer(this);
+    m_statsTimer->setInterval(1000);
+    connect(m_statsTimer, SIGNAL(timeout(void)), this, SLOT(stats_slot(void)));
+
+    QInstrumentScheduler::instance()->registerWidget(this);
+}
+
+QInstrumentStreamViewer::~QInstrumentStreamViewer()
+{
+    if( QInstrumentScheduler::existingInstance() )
+        QInstrumentScheduler::existingInstance()->unregisterWidget(this);
+
+    disconnectFrom();
+}
+
+int QInstrumentStreamViewer::connectTo(const QString &address)
+{
+    QString     host;
+    quint16     port;
+    bool        ok;
+
+    disconnectFrom();
+
+    // the server is local or on the LAN, wait for the connection here
+    if( parseTcpAddress(address, &host, &port) ) {
+        QTcpSocket *s = new QTcpSocket(this);
+
+        s->connectToHost(host, port);
+        ok = s->waitForConnected(3000);
+        if( ok ) s->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        m_dev = s;
+    } else {
+        QLocalSocket *s = new QLocalSocket(this);
+
+        s->connectToServer(address);
+        ok = s->waitForConnected(3000);
+        m_dev = s;
+    }
+
+    if( !ok ) {
+        qWarning("QInstrumentStreamViewer: can not connect to %s: %s",
+                 qPrintable(address), qPrintable(m_dev->errorString()));
+        disconnectFrom();
+        return -1;
+    }
+
+    connect(m_dev, SIGNAL(readyRead(void)), this, SLOT(read_slot(void)));
+    m_statsTimer->start();
+
+    return 0;
+}
+
+void QInstrumentStreamViewer::disconnectFrom(void)
+{
+    m_statsTimer->stop();
+
+    // may be called from the device's readyRead
+    if( m_dev ) {
+        m_dev->disconnect(this);
+        m_dev->deleteLater();
+    }
+    m_dev = NULL;
+
+    m_buf.clear();
+}
+
+void QInstrumentStreamViewer::read_slot(void)
+{
+    QByteArray  in = m_dev->readAll();
+    int         pos = 0;
+
+    m_bytes    += in.size();
+    m_winBytes += in.size();
+    m_buf.append(in);
+
+    // decode every complete frame
+    while( m_buf.size() - pos >= QInstrumentStream::HEADER_SIZE ) {
+        const uchar *p = (const uchar*) m_buf.constData() + pos;
+        quint32     len = qFromLittleEndian<quint32>(p + 4);
+
+        if( qFromLittleEndian<quint32>(p) != QInstrumentStream::MAGIC || len > (1u << 28) ) {
+            qWarning("QInstrumentStreamViewer: bad frame, disconnecting");
+            disconnectFrom();
+            return;
+        }
+
+        if( (quint32) (m_buf.size() - pos) < QInstrumentStream::HEADER_SIZE + len ) break;
+
+        if( decodeFrame(p, QInstrumentStream::HEADER_SIZE + len) != 0 ) {
+            qWarning("QInstrumentStreamViewer: bad tile, disconnecting");
+            disconnectFrom();
+            return;
+        }
+
+        pos += QInstrumentStream::HEADER_SIZE + len;
+    }
+
+    m_buf.remove(0, pos);
+}
+
+int QInstrumentStreamViewer::decodeFrame(const uchar *p, int len)
+{
+    int         w = qFromLittleEndian<quint16>(p + 8);
+    int         h = qFromLittleEndian<quint16>(p + 10);
+    int         t = qFromLittleEndian<quint16>(p + 12);
+    int         n = qFromLittleEndian<quint16>(p + 14);
+    const uchar *end = p + len;
+    QRegion     rgn;
+
+    // the sizes come from the wire, do not allocate whatever they claim
+    if( w == 0 || h == 0 || t == 0 ) return -1;
+    if( w > QInstrumentStream::MAX_FRAME_SIZE || h > QInstrumentStream::MAX_FRAME_SIZE ) return -1;
+    if( t > qMax(w, h) ) return -1;
+
+    if( m_frame.width() != w || m_frame.height() != h ) {
+        m_frame = QImage(w, h, QImage::Format_ARGB32_Premultiplied);
+        m_frame.fill(Qt::transparent);
+        setMinimumSize(w, h);
+        if( width() < w || height() < h ) resize(qMax(w, width()), qMax(h, height()));
+        rgn = QRect(0, 0, w, h);
+    }
+
+    p += QInstrumentStream::HEADER_SIZE;
+
+    for(int i=0; i<n; i++) {
+        if( end - p < QInstrumentStream::TILE_HEADER_SIZE ) return -1;
+
+        // column/row * tile size can overflow an int for a bogus tile
+        qint64  cx = (qint64) qFromLittleEndian<quint16>(p) * t;
+        qint64  cy = (qint64) qFromLittleEndian<quint16>(p + 2) * t;
+        qint64  dl = qFromLittleEndian<quint32>(p + 4);
+
+        p += QInstrumentStream::TILE_HEADER_SIZE;
+        if( end - p < dl || cx >= w || cy >= h ) return -1;
+
+        int         x0 = (int) cx, y0 = (int) cy;
+
+        int         tw = qMin(t, w - x0), th = qMin(t, h - y0);
+        QByteArray  px = qUncompress(p, (int) dl);
+
+        if( px.size() != 4*tw*th ) return -1;
+
+        for(int y=0; y<th; y++)
+            memcpy(m_frame.scanLine(y0 + y) + 4*x0, px.constData() + 4*tw*y, 4*tw);
+
+        rgn += QRect(x0, y0, tw, th);
+        p += dl;
+    }
+
+    m_frames++;
+    m_winFrames++;
+
+    QInstrumentScheduler::instance()->markDirty(this, rgn);
+
+    return 0;
+}
+
+void QInstrumentStreamViewer::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+
+    painter.setClipRegion(event->region());
+    painter.fillRect(rect(), QColor(48, 48, 48));
+    painter.drawImage(0, 0, m_frame);
+}
+
+void QInstrumentStreamViewer::stats_slot(void)
+{
+    setWindowTitle(QString("Instrument stream - %1 frames/s, %2 B/frame")
+                   .arg(m_winFrames)
+                   .arg(m_winFrames ? m_winBytes / m_winFrames : 0));
+
+    m_winFrames = m_winBytes = 0;
+}
@@ -0,0 +1,213 @@
+#ifndef __QINSTRUMENTSTREAM_H__
+#define __QINSTRUMENTSTREAM_H__
+
+#include <QtCore>
+#include <QtGui>
+#include <QtNetwork>
+#include <QWidget>
+
+#include "qFlightInstruments.h"
+
+///
+/// \brief Wire format of the instrument stream (little endian)
+///
+///     frame:  "QFIS", u32 payload bytes (after the header), u16 width,
+///             u16 height, u16 tile size, u16 tiles, u32 frame number
+///     tile:   u16 column, u16 row, u32 bytes, qCompress()ed ARGB32
+///             (premultiplied) pixels of the tile, row by row
+///
+///     A frame only carries the tiles which changed since the previous
+///     frame, a client gets all tiles once after connecting (or after it
+///     fell behind).
+///
+///     Addresses: "port" or "host:port" is TCP, anything else is the name
+///     of a local (Unix domain) socket.
+///
+struct QInstrumentStream
+{
+    enum {
+        MAGIC               = 0x53494651,       ///< "QFIS"
+        HEADER_SIZE         = 20,
+        TILE_HEADER_SIZE    = 8,
+        MAX_FRAME_SIZE      = 4096              ///< largest width/height a viewer accepts
+    };
+};
+
+///
+/// \brief Renders the ADI & compass offscreen and streams changed tiles
+///
+///     Frames hold the ADI (left) and the compass (right) like the exporter.
+///     Every frame is compared with the previous one tile by tile; only the
+///     changed tiles are compressed (once, for all clients) and sent. An
+///     unchanged state costs nothing, an altitude change of the compass
+///     only sends the tiles covering the ALT/H box.
+///
+class QInstrumentStreamServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    QInstrumentStreamServer(QObject *parent = 0);
+    virtual ~QInstrumentStreamServer();
+
+    ///
+    /// \brief Listen for viewers and start the frame clock
+    /// \param address - "port", "host:port" (TCP) or a local socket name
+    /// \return 0 on success
+    ///
+    int listen(const QString &address);
+    void close(void);
+
+    bool isListening(void) { return m_tcp != NULL || m_local != NULL; }
+
+    ///
+    /// \brief Stream the state of these instruments (read once per frame)
+    ///
+    void attach(QADI *adi)                  { m_adi = adi; }
+    void attach(QCompass *compass)          { m_compass = compass; }
+
+    ///
+    /// \brief Publish the stream statistics once per second
+    ///
+    void attach(QKeyValueListView *list)    { m_list = list; }
+
+    ///
+    /// \brief Set the state directly (instruments not attached)
+    ///
+    void setData(double roll, double pitch, double yaw, double alt, double h);
+
+    void setSize(int size);                                 ///< instrument size (default 196)
+    void setTileSize(int size);                             ///< tile edge (default 32 px)
+    void setFps(double fps);                                ///< frame clock (default 30)
+    void setCompression(int level) { m_level = level; }     ///< zlib level (default 1)
+
+    int getClientCount(void) { return m_clients.size(); }
+
+    ///
+    /// \brief Averages of the last second: bytes & tiles per frame, encode time (in us)
+    ///
+    double getBytesPerFrame(void)   { return m_bytesPerFrame; }
+    double getTilesPerFrame(void)   { return m_tilesPerFrame; }
+    double getEncodeTime(void)      { return m_encodeUs; }
+
+    quint64 getFrameCount(void)     { return m_frames; }   ///< frames with changed tiles
+    quint64 getByteCount(void)      { return m_bytes; }    ///< bytes sent to all clients
+
+signals:
+    ///
+    /// \brief Emitted once per second with the averages of that second
+    ///
+    void statistics(double bytesPerFrame, double tilesPerFrame, double encodeUs);
+
+protected slots:
+    void newConnection_slot(void);
+    void disconnected_slot(void);
+    void frame_slot(void);
+    void stats_slot(void);
+
+protected:
+    void addClient(QIODevice *dev);
+
+    ///
+    /// \brief Render the current state into m_frame
+    ///
+    void renderFrame(void);
+
+    ///
+    /// \brief Compare m_frame with m_prev, recompress the changed tiles
+    /// \return number of changed tiles (m_changed)
+    ///
+    int diffTiles(void);
+
+    ///
+    /// \brief Build a frame message of the changed tiles, or of all tiles
+    ///
+    void buildMessage(QByteArray &msg, bool all);
+
+protected:
+    QTcpServer              *m_tcp;
+    QLocalServer            *m_local;
+    QTimer                  *m_timer;           ///< frame clock
+    QTimer                  *m_statsTimer;
+
+    struct Client {
+        QPointer<QIODevice> dev;
+        bool                needAll;            ///< send every tile next frame
+    };
+    QList<Client>           m_clients;
+
+    QPointer<QADI>          m_adi;
+    QPointer<QCompass>      m_compass;
+    QPointer<QKeyValueListView> m_list;
+    double                  m_v[5];             ///< roll, pitch, yaw, alt, h
+    double                  m_painted[5];       ///< state of m_frame
+    bool                    m_frameValid;
+
+    QADIRenderer            m_adiRenderer;
+    QCompassRenderer        m_compassRenderer;
+    int                     m_size;
+    int                     m_tile;
+    int                     m_level;
+
+    QImage                  m_frame, m_prev;
+    int                     m_cols, m_rows;
+    QVector<QByteArray>     m_tileData;         ///< compressed tiles of m_frame
+    QVector<int>            m_changed;          ///< changed tiles of the last diff
+    QByteArray              m_raw;              ///< tile pixels (reused)
+    QByteArray              m_msg, m_allMsg;    ///< messages (reused)
+    quint32                 m_seq;
+
+    quint64                 m_frames, m_bytes;
+    quint64                 m_winFrames, m_winBytes, m_winTiles;   ///< stats window
+    qint64                  m_winEncodeNs;
+    double                  m_bytesPerFrame, m_tilesPerFrame, m_encodeUs;
+};
+
+///
+/// \brief Viewer of an instrument stream
+///
+///     Applies the received tiles to its frame and repaints only them.
+///
+class QInstrumentStreamViewer : public QWidget
+{
+    Q_OBJECT
+
+public:
+    QInstrumentStreamViewer(QWidget *parent = 0);
+    virtual ~QInstrumentStreamViewer();
+
+    ///
+    /// \brief Connect to a server
+    /// \param address - "port", "host:port" (TCP) or a local socket name
+    /// \return 0 on success (connecting is asynchronous)
+    ///
+    int connectTo(const QString &address);
+    void disconnectFrom(void);
+
+    quint64 getFrameCount(void) { return m_frames; }
+    quint64 getByteCount(void)  { return m_bytes; }
+
+protected slots:
+    void read_slot(void);
+    void stats_slot(void);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+
+    ///
+    /// \brief Apply one frame message
+    /// \return 0 on success, -1 on a malformed message
+    ///
+    int decodeFrame(const uchar *p, int len);
+
+protected:
+    QIODevice               *m_dev;
+    QByteArray              m_buf;              ///< received, not yet decoded
+    QImage                  m_frame;
+    QTimer                  *m_statsTimer;
+
+    quint64                 m_frames, m_bytes;
+    quint64                 m_winFrames, m_winBytes;
+};
+
+#endif // end of __QINSTRUMENTSTREAM_H__
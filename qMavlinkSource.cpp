@@ -0,0 +1,478 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <QtCore>
+#include <QtEndian>
+
+#if defined(Q_OS_UNIX)
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#define MAVLINK_HAVE_SOCKETS 1
+#endif
+
+#include "qMavlinkSource.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Known messages, CRC_EXTRA from the MAVLink common dialect
+///
+struct MavlinkMsgInfo
+{
+    quint32     msgid;
+    quint8      crcExtra;
+    int         minLen;
+};
+
+static const MavlinkMsgInfo g_msgInfo[] = {
+    { QMavlinkMessage::HEARTBEAT,            50,  9 },
+    { QMavlinkMessage::SYS_STATUS,          124, 31 },
+    { QMavlinkMessage::GPS_RAW_INT,          24, 30 },
+    { QMavlinkMessage::ATTITUDE,             39, 28 },
+    { QMavlinkMessage::GLOBAL_POSITION_INT, 104, 28 },
+    { QMavlinkMessage::VFR_HUD,              20, 20 },
+};
+
+///
+/// \brief CRC-16/MCRF4XX (X.25) as used by MAVLink
+///
+static inline quint16 crcAccumulate(quint16 crc, quint8 b)
+{
+    quint8 t = b ^ (quint8) (crc & 0xff);
+    t ^= (t << 4);
+    return (crc >> 8) ^ ((quint16) t << 8) ^ ((quint16) t << 3) ^ (t >> 4);
+}
+
+static quint16 crcCalculate(const uchar *p, int len, quint8 crcExtra)
+{
+    quint16 crc = 0xffff;
+
+    for(int i=0; i<len; i++) crc = crcAccumulate(crc, p[i]);
+
+    return crcAccumulate(crc, crcExtra);
+}
+
+
+bool QMavlinkParser::msgInfo(quint32 msgid, quint8 &crcExtra, int &minLen)
+{
+    for(size_t i=0; i<sizeof(g_msgInfo)/sizeof(g_msgInfo[0]); i++) {
+        if( g_msgInfo[i].msgid == msgid ) {
+            crcExtra = g_msgInfo[i].crcExtra;
+            minLen   = g_msgInfo[i].minLen;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int QMavlinkParser::parse(const uchar *buf, int len, Handler *h)
+{
+    const uchar     *p = buf, *end = buf + len;
+    int             n = 0;
+
+    while( p < end ) {
+        QMavlinkMessage msg;
+        int             hdr, pktLen;
+
+        if( p[0] == 0xFE ) {
+            // v1
+            if( end - p < 8 ) { m_errorCount++; break; }
+
+            hdr        = 6;
+            pktLen     = hdr + p[1] + 2;
+            msg.sysid  = p[3];
+            msg.compid = p[4];
+            msg.msgid  = p[5];
+        } else if( p[0] == 0xFD ) {
+            // v2, signature follows the crc if flagged
+            if( end - p < 12 ) { m_errorCount++; break; }
+
+            hdr        = 10;
+            pktLen     = hdr + p[1] + 2 + ((p[2] & 0x01) ? 13 : 0);
+            msg.sysid  = p[5];
+            msg.compid = p[6];
+            msg.msgid  = p[7] | (p[8] << 8) | (p[9] << 16);
+        } else {
+            // not a packet start, resync
+            p++;
+            continue;
+        }
+
+        if( pktLen > end - p ) { m_errorCount++; break; }
+
+        msg.payload = p + hdr;
+        msg.len     = p[1];
+
+        quint8  crcExtra;
+        int     minLen;
+
+        if( !msgInfo(msg.msgid, crcExtra, minLen) ) {
+            m_unknownCount++;
+            p += pktLen;
+            continue;
+        }
+
+        quint16 crc = crcCalculate(p + 1, hdr - 1 + msg.len, crcExtra);
+        if( crc != qFromLittleEndian<quint16>(p + hdr + msg.len) ) {
+            // corrupted, resync at the next byte
+            m_errorCount++;
+            p++;
+            continue;
+        }
+
+        h->handleMessage(msg);
+        m_msgCount++;
+        n++;
+
+        p += pktLen;
+    }
+
+    return n;
+}
+
+int QMavlinkParser::pack(uchar *buf, quint32 msgid, const uchar *payload, int len,
+                         quint8 seq, quint8 sysid, quint8 compid)
+{
+    quint8  crcExtra;
+    int     minLen;
+
+    if( !msgInfo(msgid, crcExtra, minLen) ) return 0;
+
+    // v2 drops trailing zero bytes, keeps at least one
+    while( len > 1 && payload[len-1] == 0 ) len--;
+
+    buf[0] = 0xFD;
+    buf[1] = len;
+    buf[2] = 0;
+    buf[3] = 0;
+    buf[4] = seq;
+    buf[5] = sysid;
+    buf[6] = compid;
+    buf[7] = msgid & 0xff;
+    buf[8] = (msgid >> 8) & 0xff;
+    buf[9] = (msgid >> 16) & 0xff;
+    memcpy(buf + 10, payload, len);
+
+    qToLittleEndian<quint16>(crcCalculate(buf + 1, 9 + len, crcExtra), buf + 10 + len);
+
+    return 10 + len + 2;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Receive thread of QMavlinkSource
+///
+class QMavlinkThread : public QThread
+{
+public:
+    QMavlinkThread(QMavlinkSource *src) : m_src(src) {}
+
+protected:
+    void run(void) { m_src->receiveLoop(); }
+
+    QMavlinkSource  *m_src;
+};
+
+static const char *g_keyNames[QMavlinkSource::KEY_NUM] = {
+    "airspeed",
+    "groundspeed",
+    "climb",
+    "alt",
+    "throttle",
+    "heading",
+    "lat",
+    "lon",
+    "batt V",
+    "batt A",
+    "batt %",
+    "gps fix",
+    "gps sats",
+    "armed"
+};
+
+// keys shown as integers
+static const quint32 g_intKeys = (1u << QMavlinkSource::KEY_THROTTLE) |
+                                 (1u << QMavlinkSource::KEY_HEADING) |
+                                 (1u << QMavlinkSource::KEY_BATT_PCT) |
+                                 (1u << QMavlinkSource::KEY_GPS_FIX) |
+                                 (1u << QMavlinkSource::KEY_GPS_SATS) |
+                                 (1u << QMavlinkSource::KEY_ARMED);
+
+
+QMavlinkSource::QMavlinkSource(QObject *parent)
+    : QObject(parent)
+{
+    m_thread = NULL;
+    m_fd = -1;
+    m_port = 0;
+    m_rxTime = 0;
+
+    m_kvLocalMask = 0;
+    m_kvMask = 0;
+    for(int i=0; i<KEY_NUM; i++) m_kvLocal[i] = m_kv[i] = 0;
+
+    m_rateCount = 0;
+    m_msgRate = 0;
+
+    m_queue = new QTelemetryQueue(this);
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(qRound(1000.0/QInstrumentScheduler::instance()->getTargetRate()));
+    connect(m_timer, SIGNAL(timeout(void)), this, SLOT(publish_slot(void)));
+}
+
+QMavlinkSource::~QMavlinkSource()
+{
+    close();
+}
+
+int QMavlinkSource::open(quint16 port)
+{
+    close();
+
+#ifdef MAVLINK_HAVE_SOCKETS
+    struct sockaddr_in  addr;
+    socklen_t           alen = sizeof(addr);
+    int                 rcvbuf = 4*1024*1024;
+
+    m_fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if( m_fd < 0 ) {
+        qWarning("QMavlinkSource: can not create socket");
+        return -1;
+    }
+
+    // room for bursts while the receive thread is descheduled
+    setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons(port);
+
+    if( ::bind(m_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ) {
+        qWarning("QMavlinkSource: can not bind UDP port %d", port);
+        ::close(m_fd);
+        m_fd = -1;
+        return -2;
+    }
+
+    getsockname(m_fd, (struct sockaddr*) &addr, &alen);
+    m_port = ntohs(addr.sin_port);
+
+    atomicStore(m_stop, 0);
+    m_thread = new QMavlinkThread(this);
+    m_thread->start(QThread::HighPriority);
+
+    m_rateCount = atomicLoad(m_msgCount);
+    m_rateClock.start();
+    m_timer->start();
+
+    return 0;
+#else
+    Q_UNUSED(port);
+    qWarning("QMavlinkSource: UDP sockets are not supported on this platform");
+    return -1;
+#endif
+}
+
+void QMavlinkSource::close(void)
+{
+    if( !m_thread ) return;
+
+    atomicStore(m_stop, 1);
+    m_thread->wait();
+    delete m_thread;
+    m_thread = NULL;
+
+#ifdef MAVLINK_HAVE_SOCKETS
+    ::close(m_fd);
+#endif
+    m_fd = -1;
+
+    m_timer->stop();
+    publish_slot();
+}
+
+void QMavlinkSource::receiveLoop(void)
+{
+#ifdef MAVLINK_HAVE_SOCKETS
+    enum {
+        BATCH       = 32,                       ///< datagrams per receive call
+        DGRAM_SIZE  = 2048                      ///< max datagram size
+    };
+
+    QVector<uchar>  buf(BATCH*DGRAM_SIZE);
+    int             lens[BATCH];
+
+#ifdef Q_OS_LINUX
+    struct mmsghdr  msgs[BATCH];
+    struct iovec    iov[BATCH];
+
+    memset(msgs, 0, sizeof(msgs));
+    for(int i=0; i<BATCH; i++) {
+        iov[i].iov_base = buf.data() + i*DGRAM_SIZE;
+        iov[i].iov_len  = DGRAM_SIZE;
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+
+    while( !atomicLoad(m_stop) ) {
+        struct pollfd   pfd = { m_fd, POLLIN, 0 };
+        int             n = 0;
+
+        // wake up now and then to check the stop flag
+        if( poll(&pfd, 1, 100) <= 0 ) continue;
+
+#ifdef Q_OS_LINUX
+        n = recvmmsg(m_fd, msgs, BATCH, MSG_DONTWAIT, NULL);
+        for(int i=0; i<n; i++) lens[i] = msgs[i].msg_len;
+#else
+        while( n < BATCH ) {
+            ssize_t r = recv(m_fd, buf.data() + n*DGRAM_SIZE, DGRAM_SIZE, MSG_DONTWAIT);
+            if( r < 0 ) break;
+            lens[n++] = r;
+        }
+#endif
+        if( n <= 0 ) continue;
+
+        m_rxTime = QTelemetryQueue::now();
+
+        for(int i=0; i<n; i++)
+            m_parser.parse(buf.constData() + i*DGRAM_SIZE, lens[i], this);
+
+        m_packetCount.fetchAndAddRelaxed(n);
+        atomicStore(m_msgCount, m_parser.getMsgCount());
+        atomicStore(m_errorCount, m_parser.getErrorCount());
+
+        // hand over key-value changes once per batch
+        if( m_kvLocalMask ) {
+            QMutexLocker locker(&m_kvMutex);
+
+            for(int k=0; k<KEY_NUM; k++)
+                if( m_kvLocalMask & (1u << k) ) m_kv[k] = m_kvLocal[k];
+
+            m_kvMask |= m_kvLocalMask;
+            m_kvLocalMask = 0;
+        }
+    }
+#endif
+}
+
+void QMavlinkSource::handleMessage(const QMavlinkMessage &msg)
+{
+    const double    r2d = 180.0/M_PI;
+    QTelemetrySample s;
+
+    s.t = m_rxTime;
+
+    switch( msg.msgid ) {
+    case QMavlinkMessage::HEARTBEAT:
+        // base_mode bit 7: safety armed
+        setKey(KEY_ARMED, (msg.get<quint8>(6) & 0x80) ? 1 : 0);
+        break;
+
+    case QMavlinkMessage::SYS_STATUS:
+        setKey(KEY_BATT_V,   msg.get<quint16>(14) / 1000.0);
+        setKey(KEY_BATT_A,   msg.get<qint16>(16) / 100.0);
+        setKey(KEY_BATT_PCT, msg.get<qint8>(30));
+        break;
+
+    case QMavlinkMessage::GPS_RAW_INT:
+        setKey(KEY_GPS_FIX,  msg.get<quint8>(28));
+        setKey(KEY_GPS_SATS, msg.get<quint8>(29));
+        break;
+
+    case QMavlinkMessage::ATTITUDE: {
+        double yaw = fmod(msg.getFloat(12)*r2d + 360.0, 360.0);
+
+        s.type = QTelemetrySample::ATTITUDE;
+        s.v[0] = msg.getFloat(4)*r2d;
+        s.v[1] = msg.getFloat(8)*r2d;
+        m_queue->push(s);
+
+        s.type = QTelemetrySample::HEADING;
+        s.v[0] = yaw;
+        s.v[1] = 0;
+        m_queue->push(s);
+        break;
+    }
+
+    case QMavlinkMessage::GLOBAL_POSITION_INT:
+        s.type = QTelemetrySample::ALTITUDE;
+        s.v[0] = msg.get<qint32>(12) / 1000.0;
+        s.v[1] = msg.get<qint32>(16) / 1000.0;
+        m_queue->push(s);
+
+        setKey(KEY_LAT, msg.get<qint32>(4) / 1e7);
+        setKey(KEY_LON, msg.get<qint32>(8) / 1e7);
+        break;
+
+    case QMavlinkMessage::VFR_HUD:
+        setKey(KEY_AIRSPEED,    msg.getFloat(0));
+        setKey(KEY_GROUNDSPEED, msg.getFloat(4));
+        setKey(KEY_ALT,         msg.getFloat(8));
+        setKey(KEY_CLIMB,       msg.getFloat(12));
+        setKey(KEY_HEADING,     msg.get<qint16>(16));
+        setKey(KEY_THROTTLE,    msg.get<quint16>(18));
+        break;
+    }
+}
+
+void QMavlinkSource::publish_slot(void)
+{
+    double      kv[KEY_NUM];
+    quint32     mask;
+
+    {
+        QMutexLocker locker(&m_kvMutex);
+
+        mask = m_kvMask;
+        m_kvMask = 0;
+        memcpy(kv, m_kv, sizeof(kv));
+    }
+
+    if( m_list ) {
+        for(int k=0; k<KEY_NUM; k++) {
+            if( !(mask & (1u << k)) ) continue;
+
+            if( g_intKeys & (1u << k) )
+                m_list->setValue(g_keyNames[k], (int) kv[k]);
+            else
+                m_list->setValue(g_keyNames[k], kv[k]);
+        }
+    }
+
+    if( mask && !m_tapes.isEmpty() ) {
+        qint64 t = QTelemetryQueue::now();
+
+        for(int i=0; i<m_tapes.size(); i++) {
+            if( m_tapes[i].tape && (mask & (1u << m_tapes[i].key)) )
+                m_tapes[i].tape->addSample(t, kv[m_tapes[i].key]);
+        }
+    }
+
+    // message rate, once per second
+    if( m_rateClock.isValid() && m_rateClock.elapsed() >= 1000 ) {
+        quint64 c = atomicLoad(m_msgCount);
+
+        m_msgRate = (c - m_rateCount) * 1000.0 / m_rateClock.restart();
+        m_rateCount = c;
+
+        if( m_list ) m_list->setValue("mavlink msg/s", m_msgRate);
+
+        emit statistics(m_msgRate);
+    }
+}
@@ -0,0 +1,255 @@
+#ifndef __QMAVLINKSOURCE_H__
+#define __QMAVLINKSOURCE_H__
+
+#include <string.h>
+
+#include <QtCore>
+#include <QtEndian>
+
+#include "qFlightInstruments.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// MAVLink (v1 & v2) over UDP
+///
+///     v1 packet : 0xFE, len, seq, sysid, compid, msgid, payload, crc16
+///     v2 packet : 0xFD, len, incompat, compat, seq, sysid, compid,
+///                 msgid (24 bit), payload, crc16, [signature (13 bytes)]
+///
+/// A datagram may hold several packets. Packets are decoded in place, a
+/// QMavlinkMessage only points into the receive buffer.
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief One decoded MAVLink message (points into the receive buffer)
+///
+struct QMavlinkMessage
+{
+    enum MsgId {
+        HEARTBEAT           = 0,
+        SYS_STATUS          = 1,
+        GPS_RAW_INT         = 24,
+        ATTITUDE            = 30,
+        GLOBAL_POSITION_INT = 33,
+        VFR_HUD             = 74
+    };
+
+    quint32         msgid;
+    quint8          sysid;
+    quint8          compid;
+    const uchar     *payload;                   ///< payload in the receive buffer
+    int             len;                        ///< payload length
+
+    ///
+    /// \brief Read a little-endian field at a payload offset
+    ///
+    ///     MAVLink v2 strips trailing zero bytes of the payload, fields past
+    ///     the received length read as 0.
+    ///
+    template<typename T> T get(int off) const {
+        T       v;
+
+        if( off + (int) sizeof(T) <= len ) {
+            v = qFromLittleEndian<T>(payload + off);
+        } else {
+            uchar   b[sizeof(T)] = { 0 };
+            if( off < len ) memcpy(b, payload + off, len - off);
+            v = qFromLittleEndian<T>(b);
+        }
+
+        return v;
+    }
+
+    float getFloat(int off) const {
+        quint32 u = get<quint32>(off);
+        float   f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+};
+
+///
+/// \brief MAVLink packet parser & packer
+///
+class QMavlinkParser
+{
+public:
+    ///
+    /// \brief Message handler
+    ///
+    class Handler
+    {
+    public:
+        virtual ~Handler() {}
+        virtual void handleMessage(const QMavlinkMessage &msg) = 0;
+    };
+
+    QMavlinkParser() : m_msgCount(0), m_errorCount(0), m_unknownCount(0) {}
+
+    ///
+    /// \brief Parse all packets of a datagram
+    /// \param buf - datagram
+    /// \param len - datagram length
+    /// \param h   - handler called for every known message with a valid crc
+    /// \return number of messages handled
+    ///
+    int parse(const uchar *buf, int len, Handler *h);
+
+    ///
+    /// \brief Pack a message (MAVLink v2) into buf
+    /// \param buf     - output buffer (at least len + 12 bytes)
+    /// \param msgid   - message id
+    /// \param payload - payload
+    /// \param len     - payload length
+    /// \return packet length, 0 for an unknown message id
+    ///
+    static int pack(uchar *buf, quint32 msgid, const uchar *payload, int len,
+                    quint8 seq = 0, quint8 sysid = 1, quint8 compid = 1);
+
+    ///
+    /// \brief CRC_EXTRA seed & minimal payload length of a message
+    /// \return false if the message is not known
+    ///
+    static bool msgInfo(quint32 msgid, quint8 &crcExtra, int &minLen);
+
+    quint64 getMsgCount(void)       { return m_msgCount; }
+    quint64 getErrorCount(void)     { return m_errorCount; }
+    quint64 getUnknownCount(void)   { return m_unknownCount; }
+
+protected:
+    quint64         m_msgCount;                 ///< handled messages
+    quint64         m_errorCount;               ///< bad crc / truncated packets
+    quint64         m_unknownCount;             ///< messages without CRC_EXTRA
+};
+
+
+///
+/// \brief MAVLink UDP data source
+///
+///     A receive thread reads datagrams in batches (recvmmsg on Linux),
+///     decodes them in place and pushes attitude, heading & altitude into a
+///     QTelemetryQueue. Other values (speeds, position, battery, GPS) are
+///     published to the attached QKeyValueListView once per display frame.
+///
+class QMavlinkSource : public QObject, protected QMavlinkParser::Handler
+{
+    Q_OBJECT
+
+public:
+    QMavlinkSource(QObject *parent = 0);
+    virtual ~QMavlinkSource();
+
+    ///
+    /// \brief Bind a UDP port and start the receive thread
+    /// \param port - UDP port (0: any free port, see getPort())
+    /// \return 0 on success
+    ///
+    int open(quint16 port = 14550);
+    void close(void);
+
+    bool isOpen(void) { return m_thread != NULL; }
+
+    ///
+    /// \brief Bound UDP port
+    ///
+    quint16 getPort(void) { return m_port; }
+
+    ///
+    /// \brief Attach instruments to be fed (GUI thread)
+    ///
+    void attach(QADI *adi)                  { m_queue->attach(adi); }
+    void attach(QCompass *compass)          { m_queue->attach(compass); }
+    void attach(QKeyValueListView *list)    { m_list = list; }
+
+    ///
+    /// \brief Received messages per second (updated once per second)
+    ///
+    double getMsgRate(void) { return m_msgRate; }
+
+    quint64 getMsgCount(void)       { return atomicLoad(m_msgCount); }
+    quint64 getPacketCount(void)    { return atomicLoad(m_packetCount); }
+    quint64 getErrorCount(void)     { return atomicLoad(m_errorCount); }
+    int getOverrunCount(void)       { return m_queue->getOverrunCount(); }
+
+    ///
+    /// \brief Keys published to the key-value list
+    ///
+    enum Key {
+        KEY_AIRSPEED = 0,
+        KEY_GROUNDSPEED,
+        KEY_CLIMB,
+        KEY_ALT,
+        KEY_THROTTLE,
+        KEY_HEADING,
+        KEY_LAT,
+        KEY_LON,
+        KEY_BATT_V,
+        KEY_BATT_A,
+        KEY_BATT_PCT,
+        KEY_GPS_FIX,
+        KEY_GPS_SATS,
+        KEY_ARMED,
+        KEY_NUM
+    };
+
+    ///
+    /// \brief Feed a tape from a key, e.g. KEY_AIRSPEED, KEY_ALT or KEY_CLIMB (GUI thread)
+    ///
+    void attach(QTape *tape, Key k) {
+        TapeFeed f;
+        f.tape = tape;
+        f.key  = k;
+        m_tapes.append(f);
+    }
+
+signals:
+    ///
+    /// \brief Emitted once per second with the received message rate
+    ///
+    void statistics(double msgRate);
+
+protected slots:
+    void publish_slot(void);
+
+protected:
+    friend class QMavlinkThread;
+
+    void receiveLoop(void);
+    void handleMessage(const QMavlinkMessage &msg);
+
+    void setKey(int k, double v) { m_kvLocal[k] = v; m_kvLocalMask |= 1u << k; }
+
+protected:
+    QThread                 *m_thread;          ///< receive thread
+    int                     m_fd;               ///< socket
+    quint16                 m_port;
+    QAtomicInt              m_stop;
+
+    QMavlinkParser          m_parser;           ///< receive thread only
+    QTelemetryQueue         *m_queue;           ///< instrument feed
+    qint64                  m_rxTime;           ///< receive time of current batch
+
+    QAtomicInteger<quint64> m_msgCount;         ///< handled messages
+    QAtomicInteger<quint64> m_packetCount;      ///< received datagrams
+    QAtomicInteger<quint64> m_errorCount;       ///< bad crc / truncated packets
+
+    double                  m_kvLocal[KEY_NUM]; ///< receive thread values
+    quint32                 m_kvLocalMask;
+    QMutex                  m_kvMutex;          ///< guards m_kv, m_kvMask
+    double                  m_kv[KEY_NUM];      ///< values to publish
+    quint32                 m_kvMask;           ///< changed keys
+
+    QPointer<QKeyValueListView> m_list;
+
+    struct TapeFeed {
+        QPointer<QTape>     tape;
+        int                 key;
+    };
+    QList<TapeFeed>         m_tapes;            ///< tapes fed from keys
+    QTimer                  *m_timer;           ///< per-frame publish timer
+
+    QElapsedTimer           m_rateClock;
+    quint64                 m_rateCount;        ///< m_msgCount at m_rateClock start
+    double                  m_msgRate;
+};
+
+#endif // end of __QMAVLINKSOURCE_H__
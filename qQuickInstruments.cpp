@@ -0,0 +1,651 @@
+#include <math.h>
+
+#include <QtCore>
+#include <QtGui>
+#include <QtQml>
+#include <QQuickWindow>
+#include <QSGNode>
+#include <QSGTexture>
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+#include <QSGImageNode>
+#include <QSGRectangleNode>
+#else
+#include <QSGSimpleTextureNode>
+#include <QSGSimpleRectNode>
+#endif
+
+#include "qQuickInstruments.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// scene-graph nodes
+///     image, rectangle & transform nodes only, the software backend (and
+///     the 2D renderer of Qt < 5.8) cannot draw custom geometry. Qt 5.8+
+///     creates image & rectangle nodes through the window so every backend
+///     gets its own implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+typedef QSGImageNode            QuickImageNode;
+typedef QSGRectangleNode        QuickRectNode;
+#else
+typedef QSGSimpleTextureNode    QuickImageNode;
+typedef QSGSimpleRectNode       QuickRectNode;
+#endif
+
+static QuickRectNode* newRectNode(QQuickWindow *win, const QColor &color)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    QuickRectNode *n = win->createRectangleNode();
+#else
+    Q_UNUSED(win);
+    QuickRectNode *n = new QuickRectNode();
+#endif
+
+    n->setColor(color);
+
+    return n;
+}
+
+///
+/// \brief Root of an instrument's node tree, owns the textures
+///
+class QQuickArtNode : public QSGTransformNode
+{
+public:
+    QQuickArtNode() : version(-1) {}
+    ~QQuickArtNode() { qDeleteAll(textures); }
+
+    ///
+    /// \brief Upload an image, the texture lives as long as this node
+    ///
+    QSGTexture* texture(QQuickWindow *win, const QImage &img) {
+        QSGTexture *t = win->createTextureFromImage(img);
+
+        textures.append(t);
+
+        return t;
+    }
+
+    ///
+    /// \brief Add a textured quad below parent
+    /// \param rc - quad rectangle (logical, relative to parent)
+    ///
+    QuickImageNode* addImage(QQuickWindow *win, QSGNode *parent, QSGTexture *tex,
+                             const QRectF &rc) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+        QuickImageNode *n = win->createImageNode();
+#else
+        QuickImageNode *n = new QuickImageNode();
+#endif
+
+        n->setTexture(tex);
+        n->setFiltering(QSGTexture::Linear);
+        n->setRect(rc);
+        n->setSourceRect(QRectF(QPointF(0, 0), tex->textureSize()));
+        parent->appendChildNode(n);
+
+        return n;
+    }
+
+    int                 version;                ///< art version of the textures
+    QList<QSGTexture*>  textures;
+};
+
+class QQuickADINode : public QQuickArtNode
+{
+public:
+    QSGTransformNode    *rollT;                 ///< roll frame
+    QuickImageNode      *ground;                ///< ground part of the disc
+    QuickRectNode       *line;                  ///< horizon line
+    QuickImageNode      *ladder;                ///< visible band of the ladder strip
+};
+
+class QQuickCompassNode : public QQuickArtNode
+{
+public:
+    QSGTransformNode    *yawT;                  ///< yaw marker frame
+    QuickImageNode      *quads[2][QQuickGlyphAtlas::MAX_QUADS];    ///< ALT & H readouts
+};
+
+///
+/// \brief Create a transparent image of w x h logical pixels
+///
+static QImage makeImage(int w, int h, qreal dpr)
+{
+    QImage img(qCeil(w*dpr), qCeil(h*dpr), QImage::Format_ARGB32_Premultiplied);
+    img.setDevicePixelRatio(dpr);
+    img.fill(Qt::transparent);
+
+    return img;
+}
+
+///
+/// \brief Device pixel ratio of the window an item is shown in
+///
+static qreal itemDpr(const QQuickItem *item)
+{
+    return item->window() ? item->window()->devicePixelRatio() : 1.0;
+}
+
+static int glyphSlot(char c)
+{
+    if( c >= '0' && c <= '9' ) return c - '0';
+    if( c == '.' ) return 10;
+    if( c == '-' ) return 11;
+    return 12;
+}
+
+void registerQuickInstruments(const char *uri)
+{
+    qmlRegisterType<QQuickADI>(uri, 1, 0, "ADI");
+    qmlRegisterType<QQuickCompass>(uri, 1, 0, "Compass");
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+void QQuickGlyphAtlas::build(const QInstrumentResources *res, qreal dpr)
+{
+    const QStaticText   *st[SLOT_NUM];
+    qreal               x = 1, h = 0;
+
+    for(int i=0; i<13; i++) st[i] = &res->glyphs[i];
+    st[SLOT_ALT]  = &res->altPrefix;
+    st[SLOT_H]    = &res->hPrefix;
+    st[SLOT_UNIT] = &res->unitSuffix;
+
+    for(int i=0; i<SLOT_NUM; i++) h = qMax(h, st[i]->size().height());
+
+    // one row, 2 px apart so bilinear filtering does not bleed
+    for(int i=0; i<SLOT_NUM; i++) {
+        slots[i] = QRectF(x, 1, st[i]->size().width(), h);
+        x += ceil(slots[i].width()) + 2;
+    }
+
+    image = makeImage(qCeil(x), qCeil(h) + 2, dpr);
+
+    QPainter painter(&image);
+
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setFont(res->altFont);
+    painter.setPen(res->bluePen);
+
+    for(int i=0; i<SLOT_NUM; i++)
+        painter.drawStaticText(slots[i].topLeft(), *st[i]);
+
+    glyphWidth = res->glyphWidth;
+    this->dpr  = dpr;
+}
+
+int QQuickGlyphAtlas::layout(int prefix, double v, const QRectF &rc,
+                             QRectF *rect, int *slot) const
+{
+    char    buf[32];
+    int     n = QInstrumentResources::formatFixed(buf, v, 6, 1);
+    int     k = 0;
+    qreal   adv[13];
+    qreal   w, x, y;
+
+    // same metrics as QInstrumentResources::drawReadout()
+    for(int i=0; i<13; i++)
+        adv[i] = (i == 10 || i == 11) ? slots[i].width() : glyphWidth;
+
+    n = qMin(n, (int) MAX_QUADS - 2);
+
+    w = slots[prefix].width() + 2*glyphWidth + slots[SLOT_UNIT].width();
+    for(int i=0; i<n; i++)
+        w += adv[glyphSlot(buf[i])];
+
+    x = rc.center().x() - w/2;
+    y = rc.center().y() - slots[prefix].height()/2;
+
+    rect[k] = QRectF(x, y, slots[prefix].width(), slots[prefix].height());
+    slot[k++] = prefix;
+    x += slots[prefix].width() + glyphWidth;
+
+    for(int i=0; i<n; i++) {
+        int g = glyphSlot(buf[i]);
+
+        if( g != 12 ) {
+            rect[k] = QRectF(x + (adv[g] - slots[g].width())/2, y,
+                             slots[g].width(), slots[g].height());
+            slot[k++] = g;
+        }
+        x += adv[g];
+    }
+
+    x += glyphWidth;
+    rect[k] = QRectF(x, y, slots[SLOT_UNIT].width(), slots[SLOT_UNIT].height());
+    slot[k++] = SLOT_UNIT;
+
+    return k;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+QQuickADI::QQuickADI(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    m_roll  = 0;
+    m_pitch = 0;
+
+    m_size       = 0;
+    m_dpr        = 0;
+    m_aa         = true;
+    m_artVersion = 0;
+
+    setFlag(ItemHasContents, true);
+    setAntialiasing(true);
+
+    connect(this, SIGNAL(antialiasingChanged(bool)), this, SLOT(art_slot(void)));
+}
+
+QQuickADI::~QQuickADI()
+{
+
+}
+
+void QQuickADI::setData(double r, double p)
+{
+    setRoll(r);
+    setPitch(p);
+}
+
+void QQuickADI::setRoll(double val)
+{
+    val = qBound(-180.0, val, 180.0);
+    if( val == m_roll ) return;
+
+    m_roll = val;
+    emit rollChanged();
+    update();
+}
+
+void QQuickADI::setPitch(double val)
+{
+    val = qBound(-90.0, val, 90.0);
+    if( val == m_pitch ) return;
+
+    m_pitch = val;
+    emit pitchChanged();
+    update();
+}
+
+void QQuickADI::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+
+    polish();
+    update();
+}
+
+void QQuickADI::itemChange(ItemChange change, const ItemChangeData &value)
+{
+    QQuickItem::itemChange(change, value);
+
+    if( change == ItemSceneChange ) polish();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    if( change == ItemDevicePixelRatioHasChanged ) polish();
+#endif
+}
+
+void QQuickADI::updatePolish(void)
+{
+    // the renderer keeps a 2 px rim around the disc
+    int     size = (int) qMin(width(), height()) - 4;
+    qreal   dpr  = itemDpr(this);
+
+    if( size == m_size && dpr == m_dpr && antialiasing() == m_aa ) return;
+
+    m_size = size;
+    m_dpr  = dpr;
+    m_aa   = antialiasing();
+
+    if( m_size > 0 ) buildArt();
+
+    update();
+}
+
+void QQuickADI::buildArt(void)
+{
+    m_renderer.setSize(m_size, m_dpr);
+    m_renderer.setAntialiasing(m_aa);
+
+    const QInstrumentResources *res = m_renderer.getResources();
+
+    int     ls = m_renderer.getImageSize();
+    int     r  = m_size/2;
+
+    m_ladderImg = m_renderer.getLadderLayer();
+    m_rollImg   = m_renderer.getRollLayer();
+
+    // sky & ground discs, the ground quad shows the part below the horizon
+    m_skyImg    = makeImage(ls, ls, m_dpr);
+    m_groundImg = makeImage(ls, ls, m_dpr);
+    {
+        QPainter painter(&m_skyImg);
+
+        painter.setRenderHint(QPainter::Antialiasing, m_aa);
+        painter.translate(ls/2.0, ls/2.0);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(res->skyBrush);
+        painter.drawEllipse(QPointF(0, 0), r, r);
+    }
+    {
+        QPainter painter(&m_groundImg);
+
+        painter.setRenderHint(QPainter::Antialiasing, m_aa);
+        painter.translate(ls/2.0, ls/2.0);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(res->groundBrush);
+        painter.drawEllipse(QPointF(0, 0), r, r);
+    }
+
+    // aircraft markers (drawn in the roll frame, like QADIRenderer::render)
+    m_markerImg = makeImage(ls, ls, m_dpr);
+    {
+        QPainter painter(&m_markerImg);
+
+        painter.setRenderHint(QPainter::Antialiasing, m_aa);
+        painter.translate(ls/2.0, ls/2.0);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(res->redBrush);
+        painter.drawPolygon(res->adiMarkerR);
+        painter.drawPolygon(res->adiMarkerL);
+    }
+
+    m_rollMarkerImg = makeImage(ls, ls, m_dpr);
+    {
+        QPainter painter(&m_rollMarkerImg);
+
+        painter.setRenderHint(QPainter::Antialiasing, m_aa);
+        painter.translate(ls/2.0, ls/2.0);
+        painter.setPen(res->blackPen1);
+        painter.setBrush(res->blackBrush);
+        painter.drawPolygon(res->rollMarker);
+    }
+
+    m_artVersion++;
+}
+
+QSGNode* QQuickADI::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    QQuickADINode   *node = static_cast<QQuickADINode*>(oldNode);
+    QQuickWindow    *win = window();
+
+    if( node && (node->version != m_artVersion || m_size <= 0) ) {
+        delete node;
+        node = NULL;
+    }
+
+    if( m_size <= 0 || m_artVersion == 0 ) return NULL;
+
+    int     ls = m_size + 4;
+    int     r  = m_size/2;
+    QRectF  full(-ls/2.0, -ls/2.0, ls, ls);
+
+    // textures are uploaded once per art version
+    if( !node ) {
+        node = new QQuickADINode;
+        node->version = m_artVersion;
+
+        node->rollT = new QSGTransformNode;
+        node->appendChildNode(node->rollT);
+
+        node->addImage(win, node->rollT, node->texture(win, m_skyImg), full);
+        node->ground = node->addImage(win, node->rollT, node->texture(win, m_groundImg), QRectF());
+        node->line   = newRectNode(win, m_renderer.getResources()->blackPen.color());
+        node->rollT->appendChildNode(node->line);
+        node->ladder = node->addImage(win, node->rollT, node->texture(win, m_ladderImg), QRectF());
+        node->addImage(win, node->rollT, node->texture(win, m_rollImg), full);
+        node->addImage(win, node->rollT, node->texture(win, m_markerImg), full);
+
+        node->addImage(win, node, node->texture(win, m_rollMarkerImg), full);
+    }
+
+    // per frame: two matrices & three quads
+    QMatrix4x4  center, roll;
+
+    center.translate(width()/2, height()/2);
+    node->setMatrix(center);
+
+    roll.rotate(m_roll, 0, 0, 1);
+    node->rollT->setMatrix(roll);
+
+    double  d    = m_dpr;
+    double  ymax = r*40.0/45.0;
+    double  y    = qBound(-ymax, r*m_pitch/45.0, ymax);
+    double  lw   = m_renderer.getResources()->blackPen.widthF();
+    double  hw   = sqrt(r*r - y*y);
+
+    // ground: the disc below the horizon, cut by the source rect
+    node->ground->setRect(QRectF(-r, y, 2*r, r - y));
+    node->ground->setSourceRect(QRectF((ls/2.0 - r)*d, (ls/2.0 + y)*d, 2*r*d, (r - y)*d));
+
+    node->line->setRect(QRectF(-hw, y - lw/2, 2*hw, lw));
+
+    // ladder: strip rows within 0.8 radius of the center, so the lines
+    //  stay inside the disc without a (non-rectangular) clip node; it
+    //  follows the unclamped pitch like QADIRenderer::render()
+    {
+        double  y0  = r*m_pitch/45.0 - 3*m_size/2;
+        double  lim = 0.8*r;
+        double  ly0 = qBound(0.0, -lim - y0, 3.0*m_size);
+        double  ly1 = qBound(ly0, lim - y0, 3.0*m_size);
+
+        node->ladder->setRect(QRectF(-r, y0 + ly0, m_size, ly1 - ly0));
+        node->ladder->setSourceRect(QRectF(0, ly0*d, m_size*d, (ly1 - ly0)*d));
+    }
+
+    return node;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+QQuickCompass::QQuickCompass(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    m_yaw = 0;
+    m_alt = 0;
+    m_h   = 0;
+
+    m_readoutDirty = true;
+
+    m_size       = 0;
+    m_dpr        = 0;
+    m_aa         = true;
+    m_artVersion = 0;
+
+    setFlag(ItemHasContents, true);
+    setAntialiasing(true);
+
+    connect(this, SIGNAL(antialiasingChanged(bool)), this, SLOT(art_slot(void)));
+}
+
+QQuickCompass::~QQuickCompass()
+{
+
+}
+
+void QQuickCompass::setData(double y, double a, double h)
+{
+    setYaw(y);
+    setAlt(a);
+    setH(h);
+}
+
+void QQuickCompass::setYaw(double val)
+{
+    if( val < 0   ) val = 360 + val;
+    if( val > 360 ) val = val - 360;
+    if( val == m_yaw ) return;
+
+    m_yaw = val;
+    emit yawChanged();
+    update();
+}
+
+void QQuickCompass::setAlt(double val)
+{
+    if( val == m_alt ) return;
+
+    m_alt = val;
+    m_readoutDirty = true;
+    emit altChanged();
+    update();
+}
+
+void QQuickCompass::setH(double val)
+{
+    if( val == m_h ) return;
+
+    m_h = val;
+    m_readoutDirty = true;
+    emit hChanged();
+    update();
+}
+
+void QQuickCompass::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+
+    polish();
+    update();
+}
+
+void QQuickCompass::itemChange(ItemChange change, const ItemChangeData &value)
+{
+    QQuickItem::itemChange(change, value);
+
+    if( change == ItemSceneChange ) polish();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    if( change == ItemDevicePixelRatioHasChanged ) polish();
+#endif
+}
+
+void QQuickCompass::updatePolish(void)
+{
+    // the renderer keeps a 2 px rim around the dial
+    int     size = (int) qMin(width(), height()) - 4;
+    qreal   dpr  = itemDpr(this);
+
+    if( size == m_size && dpr == m_dpr && antialiasing() == m_aa ) return;
+
+    m_size = size;
+    m_dpr  = dpr;
+    m_aa   = antialiasing();
+
+    if( m_size > 0 ) buildArt();
+
+    update();
+}
+
+void QQuickCompass::buildArt(void)
+{
+    m_renderer.setSize(m_size, m_dpr);
+    m_renderer.setAntialiasing(m_aa);
+
+    const QInstrumentResources *res = m_renderer.getResources();
+
+    int     ls = m_renderer.getImageSize();
+
+    m_dialImg = m_renderer.getDialLayer();
+
+    m_markerImg = makeImage(ls, ls, m_dpr);
+    {
+        QPainter painter(&m_markerImg);
+
+        painter.setRenderHint(QPainter::Antialiasing, m_aa);
+        painter.translate(ls/2.0, ls/2.0);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(res->yawMarkerBrush);
+        painter.drawPolygon(res->yawMarker);
+    }
+
+    m_atlas.build(res, m_dpr);
+    m_altRect = res->altRect;
+    m_hRect   = res->hRect;
+
+    m_artVersion++;
+}
+
+QSGNode* QQuickCompass::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    QQuickCompassNode   *node = static_cast<QQuickCompassNode*>(oldNode);
+    QQuickWindow        *win = window();
+
+    if( node && (node->version != m_artVersion || m_size <= 0) ) {
+        delete node;
+        node = NULL;
+    }
+
+    if( m_size <= 0 || m_artVersion == 0 ) return NULL;
+
+    int     ls = m_size + 4;
+    QRectF  full(-ls/2.0, -ls/2.0, ls, ls);
+
+    if( !node ) {
+        QSGTexture *atlas;
+
+        node = new QQuickCompassNode;
+        node->version = m_artVersion;
+
+        node->addImage(win, node, node->texture(win, m_dialImg), full);
+
+        node->yawT = new QSGTransformNode;
+        node->appendChildNode(node->yawT);
+        node->addImage(win, node->yawT, node->texture(win, m_markerImg), full);
+
+        // readout quads, placed below
+        atlas = node->texture(win, m_atlas.image);
+        for(int j=0; j<2; j++)
+            for(int i=0; i<QQuickGlyphAtlas::MAX_QUADS; i++)
+                node->quads[j][i] = node->addImage(win, node, atlas, QRectF());
+
+        m_readoutDirty = true;
+    }
+
+    QMatrix4x4  center, yaw;
+
+    center.translate(width()/2, height()/2);
+    node->setMatrix(center);
+
+    yaw.rotate(-m_yaw, 0, 0, 1);
+    node->yawT->setMatrix(yaw);
+
+    // readouts: only the quads' rectangles change
+    if( m_readoutDirty ) {
+        QRectF  rect[QQuickGlyphAtlas::MAX_QUADS];
+        int     slot[QQuickGlyphAtlas::MAX_QUADS];
+        qreal   d = m_atlas.dpr;
+
+        for(int j=0; j<2; j++) {
+            int n = j == 0 ? m_atlas.layout(QQuickGlyphAtlas::SLOT_ALT, m_alt, m_altRect, rect, slot)
+                           : m_atlas.layout(QQuickGlyphAtlas::SLOT_H,   m_h,   m_hRect,   rect, slot);
+
+            for(int i=0; i<QQuickGlyphAtlas::MAX_QUADS; i++) {
+                QuickImageNode *q = node->quads[j][i];
+
+                if( i < n ) {
+                    const QRectF &s = m_atlas.slots[slot[i]];
+
+                    q->setRect(rect[i]);
+                    q->setSourceRect(QRectF(s.x()*d, s.y()*d, s.width()*d, s.height()*d));
+                } else {
+                    q->setRect(QRectF());
+                }
+            }
+        }
+
+        m_readoutDirty = false;
+    }
+
+    return node;
+}
@@ -0,0 +1,188 @@
+#ifndef __QQUICKINSTRUMENTS_H__
+#define __QQUICKINSTRUMENTS_H__
+
+#include <QtCore>
+#include <QtGui>
+#include <QQuickItem>
+
+#include "qFlightInstruments.h"
+
+///
+/// \brief Register ADI & Compass as QML types ("import FlightInstruments 1.0")
+///
+void registerQuickInstruments(const char *uri = "FlightInstruments");
+
+///
+/// \brief Readout glyphs of the compass in one texture
+///
+///     Holds "0".."9", ".", "-", " " (slot 0-12), the ALT/H prefixes and the
+///     unit suffix. A readout is a row of quads into this image, so a value
+///     change only moves source rectangles.
+///
+class QQuickGlyphAtlas
+{
+public:
+    enum {
+        SLOT_ALT = 13,                          ///< "ALT: "
+        SLOT_H,                                 ///< "H: "
+        SLOT_UNIT,                              ///< unit suffix
+        SLOT_NUM,
+
+        MAX_QUADS = 16                          ///< quads of one readout
+    };
+
+    ///
+    /// \brief Paint the glyphs (GUI thread)
+    ///
+    void build(const QInstrumentResources *res, qreal dpr);
+
+    ///
+    /// \brief Lay out "<prefix>%6.1f<unit>" centered in rc, like drawReadout()
+    /// \param rect - out: quad rectangles (MAX_QUADS)
+    /// \param slot - out: atlas slots
+    /// \return number of quads
+    ///
+    int layout(int prefix, double v, const QRectF &rc, QRectF *rect, int *slot) const;
+
+    QImage      image;
+    QRectF      slots[SLOT_NUM];                ///< glyph rectangles in image (logical)
+    qreal       glyphWidth;                     ///< tabular advance of the digits
+    qreal       dpr;
+};
+
+///
+/// \brief Attitude indicator as a Qt Quick item
+///
+///     The artwork (disc, ladder strip, roll ring, markers) is painted into
+///     static textures once per size. An attitude change only updates the
+///     roll transform and the source rectangles of the ground & ladder quads,
+///     nothing is rasterized per frame. Uses image, rectangle & transform
+///     nodes only, so it also renders with the software backend.
+///
+class QQuickADI : public QQuickItem
+{
+    Q_OBJECT
+
+    Q_PROPERTY(double roll READ getRoll WRITE setRoll NOTIFY rollChanged)
+    Q_PROPERTY(double pitch READ getPitch WRITE setPitch NOTIFY pitchChanged)
+
+public:
+    QQuickADI(QQuickItem *parent = 0);
+    ~QQuickADI();
+
+    ///
+    /// \brief Set roll & pitch (in degree)
+    ///
+    void setData(double r, double p);
+
+    void setRoll(double val);
+    double getRoll() {return m_roll;}
+
+    void setPitch(double val);
+    double getPitch(){return m_pitch;}
+
+signals:
+    void rollChanged(void);
+    void pitchChanged(void);
+
+protected slots:
+    void art_slot(void) { polish(); }
+
+protected:
+    QSGNode* updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data);
+    void updatePolish(void);
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry);
+    void itemChange(ItemChange change, const ItemChangeData &value);
+
+    ///
+    /// \brief Repaint the artwork for the current size (GUI thread)
+    ///
+    void buildArt(void);
+
+protected:
+    double          m_roll;                     ///< roll angle (in degree)
+    double          m_pitch;                    ///< pitch angle (in degree)
+
+    QADIRenderer    m_renderer;                 ///< ladder & roll ring layers
+    int             m_size;                     ///< disc diameter of the artwork
+    qreal           m_dpr;                      ///< device pixel ratio of the artwork
+    bool            m_aa;                       ///< antialiasing of the artwork
+    int             m_artVersion;               ///< bumped by buildArt()
+
+    QImage          m_skyImg, m_groundImg;      ///< full disc in sky / ground color
+    QImage          m_ladderImg, m_rollImg;
+    QImage          m_markerImg;                ///< aircraft markers (roll frame)
+    QImage          m_rollMarkerImg;            ///< roll marker (fixed)
+};
+
+///
+/// \brief Compass as a Qt Quick item
+///
+///     The dial and the yaw marker are static textures, a yaw change only
+///     updates the marker's transform. The ALT/H readouts are rows of glyph
+///     quads from one atlas texture.
+///
+class QQuickCompass : public QQuickItem
+{
+    Q_OBJECT
+
+    Q_PROPERTY(double yaw READ getYaw WRITE setYaw NOTIFY yawChanged)
+    Q_PROPERTY(double alt READ getAlt WRITE setAlt NOTIFY altChanged)
+    Q_PROPERTY(double h READ getH WRITE setH NOTIFY hChanged)
+
+public:
+    QQuickCompass(QQuickItem *parent = 0);
+    ~QQuickCompass();
+
+    ///
+    /// \brief Set yaw (in degree), altitude & height from ground (in m)
+    ///
+    void setData(double y, double a, double h);
+
+    void setYaw(double val);
+    double getYaw() {return m_yaw;}
+
+    void setAlt(double val);
+    double getAlt() {return m_alt;}
+
+    void setH(double val);
+    double getH()   {return m_h;}
+
+signals:
+    void yawChanged(void);
+    void altChanged(void);
+    void hChanged(void);
+
+protected slots:
+    void art_slot(void) { polish(); }
+
+protected:
+    QSGNode* updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data);
+    void updatePolish(void);
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry);
+    void itemChange(ItemChange change, const ItemChangeData &value);
+
+    ///
+    /// \brief Repaint the artwork for the current size (GUI thread)
+    ///
+    void buildArt(void);
+
+protected:
+    double              m_yaw;                  ///< yaw angle (in degree)
+    double              m_alt;                  ///< altitude (in m)
+    double              m_h;                    ///< height from ground (in m)
+    bool                m_readoutDirty;         ///< alt/h changed since the last sync
+
+    QCompassRenderer    m_renderer;             ///< dial layer
+    int                 m_size;                 ///< dial diameter of the artwork
+    qreal               m_dpr;                  ///< device pixel ratio of the artwork
+    bool                m_aa;                   ///< antialiasing of the artwork
+    int                 m_artVersion;           ///< bumped by buildArt()
+
+    QImage              m_dialImg;
+    QImage              m_markerImg;            ///< yaw marker (north)
+    QQuickGlyphAtlas    m_atlas;                ///< readout glyphs
+    QRectF              m_altRect, m_hRect;     ///< readout lines (centered)
+};
+
+#endif // end of __QQUICKINSTRUMENTS_H__
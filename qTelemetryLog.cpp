@@ -0,0 +1,539 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <QtCore>
+#include <QtEndian>
+
+#include "qTelemetryLog.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+static void putU32(char *p, quint32 v)
+{
+    qToLittleEndian<quint32>(v, (uchar*) p);
+}
+
+static void putI64(char *p, qint64 v)
+{
+    qToLittleEndian<qint64>(v, (uchar*) p);
+}
+
+static void putF64(char *p, double v)
+{
+    quint64 u;
+    memcpy(&u, &v, sizeof(u));
+    qToLittleEndian<quint64>(u, (uchar*) p);
+}
+
+static quint32 getU32(const uchar *p)
+{
+    return qFromLittleEndian<quint32>(p);
+}
+
+static qint64 getI64(const uchar *p)
+{
+    return qFromLittleEndian<qint64>(p);
+}
+
+static double getF64(const uchar *p)
+{
+    quint64 u = qFromLittleEndian<quint64>(p);
+    double  v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QTelemetryRecorder::QTelemetryRecorder()
+{
+    m_offset = 0;
+    m_t0 = 0;
+    m_lastT = 0;
+
+    m_keyframeInterval = 1000000000LL;
+    m_lastKeyframe = 0;
+    m_writeError = false;
+
+    for(int i=0; i<QTelemetryLog::CH_NUM; i++) m_values[i] = 0;
+}
+
+QTelemetryRecorder::~QTelemetryRecorder()
+{
+    close();
+}
+
+int QTelemetryRecorder::open(const QString &fname)
+{
+    char    hdr[QTelemetryLog::headerSize];
+
+    close();
+
+    m_file.setFileName(fname);
+    if( !m_file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        qWarning("QTelemetryRecorder: can not create file: %s", qPrintable(fname));
+        return -1;
+    }
+
+    memcpy(hdr, "QFTL", 4);
+    putU32(hdr+4, QTelemetryLog::version);
+    putI64(hdr+8, QDateTime::currentMSecsSinceEpoch());
+
+    m_buf.clear();
+    m_buf.reserve(1 << 16);
+    m_buf.append(hdr, sizeof(hdr));
+    m_offset = 0;
+
+    m_index.clear();
+    m_t0    = QTelemetryQueue::now();
+    m_lastT = 0;
+
+    // a new log starts from an empty state, not from the previous session's
+    for(int i=0; i<QTelemetryLog::CH_NUM; i++) m_values[i] = 0;
+    m_keyValues.clear();
+    m_lastKeyframe = 0;
+    m_writeError   = false;
+
+    // initial state, so playback can always start at a keyframe
+    writeKeyframe(0);
+
+    return 0;
+}
+
+int QTelemetryRecorder::close(void)
+{
+    if( !m_file.isOpen() ) return 0;
+
+    // seek index & footer
+    {
+        qint64      idxOff = m_offset + m_buf.size();
+        QByteArray  payload(m_index.size()*8, 0);
+        char        ftr[QTelemetryLog::headerSize];
+
+        for(int i=0; i<m_index.size(); i++)
+            putI64(payload.data() + i*8, m_index[i]);
+
+        writeRecord(QTelemetryLog::REC_INDEX, 0, m_lastT,
+                    payload.constData(), payload.size());
+
+        memcpy(ftr, "QFIX", 4);
+        putU32(ftr+4, 0);
+        putI64(ftr+8, idxOff);
+        m_buf.append(ftr, sizeof(ftr));
+    }
+
+    flush();
+    m_file.close();
+
+    return m_writeError ? -1 : 0;
+}
+
+void QTelemetryRecorder::flush(void)
+{
+    if( m_buf.isEmpty() ) return;
+
+    // report the first failure (disk full, ...), the log is incomplete from here
+    if( m_file.write(m_buf) != m_buf.size() && !m_writeError ) {
+        qWarning("QTelemetryRecorder: write error on %s: %s",
+                 qPrintable(m_file.fileName()), qPrintable(m_file.errorString()));
+        m_writeError = true;
+    }
+
+    m_offset += m_buf.size();
+    m_buf.resize(0);
+}
+
+void QTelemetryRecorder::writeRecord(int type, int arg, qint64 t,
+                                     const char *payload, int len)
+{
+    char hdr[QTelemetryLog::recordHeaderSize];
+
+    hdr[0] = type;
+    hdr[1] = arg;
+    hdr[2] = 0;
+    hdr[3] = 0;
+    putU32(hdr+4, len);
+    putI64(hdr+8, t);
+
+    m_buf.append(hdr, sizeof(hdr));
+    if( len > 0 ) m_buf.append(payload, len);
+
+    if( m_buf.size() >= (1 << 16) ) flush();
+}
+
+void QTelemetryRecorder::writeKeyframe(qint64 t)
+{
+    char    payload[QTelemetryLog::CH_NUM*8];
+
+    m_index.append(t);
+    m_index.append(m_offset + m_buf.size());
+
+    for(int i=0; i<QTelemetryLog::CH_NUM; i++) putF64(payload + i*8, m_values[i]);
+    writeRecord(QTelemetryLog::REC_KEYFRAME, 0, t, payload, sizeof(payload));
+
+    // snapshot of the key-value list (arg 1)
+    QHash<QString, QString>::const_iterator it;
+    for(it=m_keyValues.constBegin(); it!=m_keyValues.constEnd(); ++it) {
+        QByteArray  k = it.key().toUtf8(), v = it.value().toUtf8();
+        QByteArray  p(2, 0);
+
+        qToLittleEndian<quint16>(k.size(), (uchar*) p.data());
+        p += k;
+        p += v;
+        writeRecord(QTelemetryLog::REC_KEYVALUE, 1, t, p.constData(), p.size());
+    }
+
+    m_lastKeyframe = t;
+}
+
+void QTelemetryRecorder::recordValue(int ch, double v, qint64 t)
+{
+    char payload[8];
+
+    if( !m_file.isOpen() || ch < 0 || ch >= QTelemetryLog::CH_NUM ) return;
+
+    // time since start, kept monotonic
+    if( t < 0 ) t = QTelemetryQueue::now();
+    t -= m_t0;
+    if( t < m_lastT ) t = m_lastT;
+    m_lastT = t;
+
+    if( t - m_lastKeyframe >= m_keyframeInterval ) writeKeyframe(t);
+
+    putF64(payload, v);
+    writeRecord(QTelemetryLog::REC_VALUE, ch, t, payload, sizeof(payload));
+
+    m_values[ch] = v;
+}
+
+void QTelemetryRecorder::record(const QTelemetrySample &s)
+{
+    switch( s.type ) {
+    case QTelemetrySample::ATTITUDE:
+        recordValue(QTelemetryLog::CH_ROLL,  s.v[0], s.t);
+        recordValue(QTelemetryLog::CH_PITCH, s.v[1], s.t);
+        break;
+    case QTelemetrySample::HEADING:
+        recordValue(QTelemetryLog::CH_YAW,   s.v[0], s.t);
+        break;
+    case QTelemetrySample::ALTITUDE:
+        recordValue(QTelemetryLog::CH_ALT,   s.v[0], s.t);
+        recordValue(QTelemetryLog::CH_H,     s.v[1], s.t);
+        break;
+    }
+}
+
+void QTelemetryRecorder::recordKeyValue(const QString &key, const QString &value, qint64 t)
+{
+    if( !m_file.isOpen() ) return;
+
+    QByteArray  k = key.toUtf8(), v = value.toUtf8();
+
+    // the key length is a u16 on disk
+    if( k.size() > 0xFFFF ) {
+        qWarning("QTelemetryRecorder: key longer than 65535 bytes ignored");
+        return;
+    }
+
+    if( t < 0 ) t = QTelemetryQueue::now();
+    t -= m_t0;
+    if( t < m_lastT ) t = m_lastT;
+    m_lastT = t;
+
+    if( t - m_lastKeyframe >= m_keyframeInterval ) writeKeyframe(t);
+
+    QByteArray  p(2, 0);
+
+    qToLittleEndian<quint16>(k.size(), (uchar*) p.data());
+    p += k;
+    p += v;
+    writeRecord(QTelemetryLog::REC_KEYVALUE, 0, t, p.constData(), p.size());
+
+    m_keyValues[key] = value;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+QTelemetryReplayer::QTelemetryReplayer(QObject *parent)
+    : QObject(parent)
+{
+    m_data     = NULL;
+    m_size     = 0;
+    m_cursor   = 0;
+    m_pos      = 0;
+    m_duration = 0;
+
+    m_speed    = 1.0;
+    m_clockPos = 0;
+
+    for(int i=0; i<QTelemetryLog::CH_NUM; i++) m_values[i] = 0;
+
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, SIGNAL(timeout(void)), this, SLOT(tick_slot(void)));
+}
+
+QTelemetryReplayer::~QTelemetryReplayer()
+{
+    close();
+}
+
+int QTelemetryReplayer::open(const QString &fname)
+{
+    qint64  fsize;
+
+    close();
+
+    m_file.setFileName(fname);
+    if( !m_file.open(QIODevice::ReadOnly) ) {
+        qWarning("QTelemetryReplayer: can not open file: %s", qPrintable(fname));
+        return -1;
+    }
+
+    fsize = m_file.size();
+    if( fsize < QTelemetryLog::headerSize ||
+        (m_data = m_file.map(0, fsize)) == NULL ||
+        memcmp(m_data, "QFTL", 4) != 0 ||
+        getU32(m_data+4) != QTelemetryLog::version ) {
+        qWarning("QTelemetryReplayer: not a telemetry log: %s", qPrintable(fname));
+        close();
+        return -2;
+    }
+
+    m_size = fsize;
+
+    // load seek index from the footer, rebuild it if the log was not closed
+    m_index.clear();
+    if( fsize >= 2*QTelemetryLog::headerSize &&
+        memcmp(m_data + fsize - QTelemetryLog::headerSize, "QFIX", 4) == 0 ) {
+        qint64  idxOff = getI64(m_data + fsize - 8);
+        int     type, arg;
+        qint64  t, len;
+
+        m_size = fsize - QTelemetryLog::headerSize;
+
+        if( readRecord(idxOff, type, arg, t, len) && type == QTelemetryLog::REC_INDEX ) {
+            const uchar *p = m_data + idxOff + QTelemetryLog::recordHeaderSize;
+
+            m_index.resize(len / 8);
+            for(int i=0; i<m_index.size(); i++) m_index[i] = getI64(p + i*8);
+
+            m_size     = idxOff;
+            m_duration = t;
+        } else {
+            m_size = fsize;
+        }
+    }
+
+    if( m_index.isEmpty() ) buildIndex();
+
+    m_cursor   = QTelemetryLog::headerSize;
+    m_pos      = 0;
+    m_clockPos = 0;
+
+    for(int i=0; i<QTelemetryLog::CH_NUM; i++) m_values[i] = 0;
+
+    return 0;
+}
+
+void QTelemetryReplayer::close(void)
+{
+    pause();
+
+    if( m_data ) m_file.unmap(m_data);
+    m_data = NULL;
+
+    if( m_file.isOpen() ) m_file.close();
+
+    m_index.clear();
+    m_size     = 0;
+    m_cursor   = 0;
+    m_pos      = 0;
+    m_duration = 0;
+}
+
+void QTelemetryReplayer::buildIndex(void)
+{
+    qint64  off = QTelemetryLog::headerSize;
+    int     type, arg;
+    qint64  t, len;
+
+    m_index.clear();
+    m_duration = 0;
+
+    while( readRecord(off, type, arg, t, len) ) {
+        if( type == QTelemetryLog::REC_INDEX ) break;
+
+        if( type == QTelemetryLog::REC_KEYFRAME ) {
+            m_index.append(t);
+            m_index.append(off);
+        }
+
+        m_duration = t;
+        off += QTelemetryLog::recordHeaderSize + len;
+    }
+
+    // drop a truncated tail
+    m_size = off;
+}
+
+bool QTelemetryReplayer::readRecord(qint64 off, int &type, int &arg, qint64 &t, qint64 &len)
+{
+    if( m_data == NULL || off < QTelemetryLog::headerSize ||
+        off + QTelemetryLog::recordHeaderSize > m_size )
+        return false;
+
+    const uchar *p = m_data + off;
+
+    type = p[0];
+    arg  = p[1];
+    len  = getU32(p+4);
+    t    = getI64(p+8);
+
+    return off + QTelemetryLog::recordHeaderSize + len <= m_size;
+}
+
+void QTelemetryReplayer::apply(int type, int arg, const uchar *payload, qint64 len)
+{
+    switch( type ) {
+    case QTelemetryLog::REC_VALUE:
+        if( len < 8 ) break;
+
+        if( arg < QTelemetryLog::CH_NUM ) m_values[arg] = getF64(payload);
+
+        switch( arg ) {
+        case QTelemetryLog::CH_ROLL:  if( m_adi )     m_adi->setRoll(getF64(payload));    break;
+        case QTelemetryLog::CH_PITCH: if( m_adi )     m_adi->setPitch(getF64(payload));   break;
+        case QTelemetryLog::CH_YAW:   if( m_compass ) m_compass->setYaw(getF64(payload)); break;
+        case QTelemetryLog::CH_ALT:   if( m_compass ) m_compass->setAlt(getF64(payload)); break;
+        case QTelemetryLog::CH_H:     if( m_compass ) m_compass->setH(getF64(payload));   break;
+        }
+        break;
+
+    case QTelemetryLog::REC_KEYFRAME:
+        if( len < QTelemetryLog::CH_NUM*8 ) break;
+
+        for(int i=0; i<QTelemetryLog::CH_NUM; i++) m_values[i] = getF64(payload + i*8);
+
+        if( m_adi )
+            m_adi->setData(getF64(payload + QTelemetryLog::CH_ROLL*8),
+                           getF64(payload + QTelemetryLog::CH_PITCH*8));
+        if( m_compass )
+            m_compass->setData(getF64(payload + QTelemetryLog::CH_YAW*8),
+                               getF64(payload + QTelemetryLog::CH_ALT*8),
+                               getF64(payload + QTelemetryLog::CH_H*8));
+        break;
+
+    case QTelemetryLog::REC_KEYVALUE:
+    {
+        if( len < 2 || !m_list ) break;
+
+        int kl = qFromLittleEndian<quint16>(payload);
+        if( 2 + kl > len ) break;
+
+        m_list->setValue(QString::fromUtf8((const char*) payload + 2, kl),
+                         QString::fromUtf8((const char*) payload + 2 + kl, len - 2 - kl));
+        break;
+    }
+    }
+}
+
+void QTelemetryReplayer::playUntil(qint64 t, qint64 maxNs)
+{
+    QElapsedTimer   clock;
+    int             type, arg, n = 0;
+    qint64          rt, len;
+
+    if( maxNs >= 0 ) clock.start();
+
+    while( readRecord(m_cursor, type, arg, rt, len) ) {
+        if( rt > t || type == QTelemetryLog::REC_INDEX ) break;
+
+        apply(type, arg, m_data + m_cursor + QTelemetryLog::recordHeaderSize, len);
+
+        m_cursor += QTelemetryLog::recordHeaderSize + len;
+        m_pos = rt;
+
+        // keep the GUI responsive when playing as fast as possible
+        if( maxNs >= 0 && (++n & 0xFF) == 0 && clock.nsecsElapsed() > maxNs ) return;
+    }
+
+    if( t > m_pos ) m_pos = qMin(t, m_duration);
+}
+
+void QTelemetryReplayer::setSpeed(double s)
+{
+    if( s < 0 ) s = 0;
+
+    m_speed    = s;
+    m_clockPos = m_pos;
+    m_clock.start();
+
+    if( m_speed == 0 ) m_timer->setInterval(0);
+    else m_timer->setInterval(qRound(1000.0/QInstrumentScheduler::instance()->getTargetRate()));
+}
+
+void QTelemetryReplayer::play(void)
+{
+    if( m_data == NULL ) return;
+
+    setSpeed(m_speed);
+    m_timer->start();
+}
+
+void QTelemetryReplayer::pause(void)
+{
+    m_timer->stop();
+}
+
+void QTelemetryReplayer::seek(qint64 t)
+{
+    int     lo = 0, hi = m_index.size()/2;
+
+    if( m_data == NULL ) return;
+
+    // last keyframe at or before t
+    while( lo < hi ) {
+        int mid = (lo + hi) / 2;
+        if( m_index[mid*2] <= t ) lo = mid + 1;
+        else                      hi = mid;
+    }
+
+    if( lo > 0 ) {
+        m_cursor = m_index[(lo-1)*2 + 1];
+        m_pos    = m_index[(lo-1)*2];
+    } else {
+        m_cursor = QTelemetryLog::headerSize;
+        m_pos    = 0;
+    }
+
+    playUntil(t);
+
+    m_clockPos = m_pos;
+    m_clock.start();
+}
+
+void QTelemetryReplayer::tick_slot(void)
+{
+    int     type, arg;
+    qint64  t, len;
+
+    if( m_speed == 0 )
+        playUntil(m_duration, 8000000);
+    else
+        playUntil(m_clockPos + (qint64) (m_clock.nsecsElapsed()*m_speed));
+
+    if( !readRecord(m_cursor, type, arg, t, len) || type == QTelemetryLog::REC_INDEX ) {
+        pause();
+        emit finished();
+    }
+}
@@ -0,0 +1,229 @@
+#ifndef __QTELEMETRYLOG_H__
+#define __QTELEMETRYLOG_H__
+
+#include <QtCore>
+
+#include "qFlightInstruments.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// Telemetry log file format (all values little-endian)
+///
+///     file header (16 bytes) : "QFTL", u32 version, i64 start time (ms since epoch)
+///     records                : u8 type, u8 arg, u16 0, u32 payload len,
+///                              i64 time (ns since start), payload
+///     index record           : n x (i64 time, i64 offset of a keyframe)
+///     footer (16 bytes)      : "QFIX", u32 0, i64 offset of the index record
+///
+/// A keyframe holds all channel values and is followed by a snapshot of the
+/// key-value list, so playback can start at any keyframe.
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Telemetry log record types & channels
+///
+struct QTelemetryLog
+{
+    enum RecordType {
+        REC_VALUE       = 1,                    ///< arg: channel, payload: double
+        REC_KEYVALUE    = 2,                    ///< payload: u16 key len, key, value (utf8)
+        REC_KEYFRAME    = 3,                    ///< payload: CH_NUM doubles
+        REC_INDEX       = 4                     ///< payload: (i64 time, i64 offset) pairs
+    };
+
+    enum Channel {
+        CH_ROLL = 0,
+        CH_PITCH,
+        CH_YAW,
+        CH_ALT,
+        CH_H,
+        CH_NUM
+    };
+
+    static const int    headerSize = 16;        ///< file header & footer size
+    static const int    recordHeaderSize = 16;  ///< record header size
+    static const quint32 version = 1;
+};
+
+
+///
+/// \brief Binary telemetry recorder
+///
+class QTelemetryRecorder
+{
+public:
+    QTelemetryRecorder();
+    virtual ~QTelemetryRecorder();
+
+    ///
+    /// \brief Create a log file, recording starts from an empty state
+    /// \param fname - file name
+    /// \return 0 on success
+    ///
+    int open(const QString &fname);
+
+    ///
+    /// \brief Write the seek index and close the file
+    /// \return 0 on success, -1 if a write failed (the log is incomplete)
+    ///
+    int close(void);
+
+    bool isOpen(void) {return m_file.isOpen();}
+    bool hasWriteError(void) {return m_writeError;}
+
+    ///
+    /// \brief Set keyframe (seek index) interval
+    /// \param ms - interval (in ms, default 1000)
+    ///
+    void setKeyframeInterval(int ms) {m_keyframeInterval = (qint64) ms*1000000;}
+
+    ///
+    /// \brief Record a channel value, timestamp is taken now if t < 0
+    /// \param ch - channel (QTelemetryLog::Channel)
+    /// \param v  - value
+    /// \param t  - steady clock time (in ns, QTelemetryQueue::now())
+    ///
+    void recordValue(int ch, double v, qint64 t = -1);
+
+    void recordRoll(double v)   {recordValue(QTelemetryLog::CH_ROLL,  v);}
+    void recordPitch(double v)  {recordValue(QTelemetryLog::CH_PITCH, v);}
+    void recordYaw(double v)    {recordValue(QTelemetryLog::CH_YAW,   v);}
+    void recordAlt(double v)    {recordValue(QTelemetryLog::CH_ALT,   v);}
+    void recordH(double v)      {recordValue(QTelemetryLog::CH_H,     v);}
+
+    ///
+    /// \brief Record a telemetry queue sample
+    ///
+    void record(const QTelemetrySample &s);
+
+    ///
+    /// \brief Record a key-value list update (keys up to 65535 bytes of UTF-8)
+    ///
+    void recordKeyValue(const QString &key, const QString &value, qint64 t = -1);
+
+protected:
+    void writeRecord(int type, int arg, qint64 t, const char *payload, int len);
+    void writeKeyframe(qint64 t);
+    void flush(void);
+
+protected:
+    QFile                   m_file;
+    QByteArray              m_buf;              ///< write buffer
+    qint64                  m_offset;           ///< file offset of m_buf[0]
+    qint64                  m_t0;               ///< steady clock time of file start
+    qint64                  m_lastT;            ///< time of last record
+
+    qint64                  m_keyframeInterval; ///< (in ns)
+    qint64                  m_lastKeyframe;     ///< time of last keyframe
+    QVector<qint64>         m_index;            ///< (time, offset) pairs
+
+    double                  m_values[QTelemetryLog::CH_NUM];
+    QHash<QString, QString> m_keyValues;        ///< current key-value list
+    bool                    m_writeError;       ///< a write failed since open()
+};
+
+
+///
+/// \brief Memory-mapped telemetry log replayer
+///
+///     The log is mapped, not read, so files of any size open instantly;
+///     the seek index is loaded from the footer (or rebuilt by a scan for
+///     logs that were not closed).
+///
+class QTelemetryReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    QTelemetryReplayer(QObject *parent = 0);
+    virtual ~QTelemetryReplayer();
+
+    ///
+    /// \brief Open a log file
+    /// \param fname - file name
+    /// \return 0 on success
+    ///
+    int open(const QString &fname);
+    void close(void);
+
+    ///
+    /// \brief Attach instruments to be fed
+    ///
+    void attach(QADI *adi)                  {m_adi = adi;}
+    void attach(QCompass *compass)          {m_compass = compass;}
+    void attach(QKeyValueListView *list)    {m_list = list;}
+
+    ///
+    /// \brief Set playback speed
+    /// \param s - 1 real time, N N-times faster, 0 as fast as possible
+    ///
+    void setSpeed(double s);
+    double getSpeed(void) {return m_speed;}
+
+    void play(void);
+    void pause(void);
+    bool isPlaying(void) {return m_timer->isActive();}
+
+    ///
+    /// \brief Seek to a time
+    /// \param t - time since start of log (in ns)
+    ///
+    void seek(qint64 t);
+
+    ///
+    /// \brief Apply records up to a later time, without seeking
+    /// \param t - time since start of log (in ns)
+    ///
+    void advance(qint64 t) {playUntil(t);}
+
+    ///
+    /// \brief Current value of a channel
+    /// \param ch - channel (QTelemetryLog::Channel)
+    ///
+    double getValue(int ch) {return m_values[ch];}
+
+    qint64 getPosition(void) {return m_pos;}    ///< current time (in ns)
+    qint64 getDuration(void) {return m_duration;} ///< log duration (in ns)
+
+signals:
+    void finished(void);
+
+protected slots:
+    void tick_slot(void);
+
+protected:
+    ///
+    /// \brief Read record header at offset
+    /// \return false at end of log or on a truncated record
+    ///
+    bool readRecord(qint64 off, int &type, int &arg, qint64 &t, qint64 &len);
+
+    ///
+    /// \brief Apply records until time t
+    ///
+    void playUntil(qint64 t, qint64 maxNs = -1);
+
+    void apply(int type, int arg, const uchar *payload, qint64 len);
+    void buildIndex(void);
+
+protected:
+    QFile                   m_file;
+    uchar                   *m_data;            ///< mapped log
+    qint64                  m_size;             ///< size of records area end
+    qint64                  m_cursor;           ///< offset of next record
+    qint64                  m_pos;              ///< current time (in ns)
+    qint64                  m_duration;
+
+    QVector<qint64>         m_index;            ///< (time, offset) pairs
+    double                  m_values[QTelemetryLog::CH_NUM]; ///< current values
+
+    double                  m_speed;
+    QTimer                  *m_timer;
+    QElapsedTimer           m_clock;            ///< wall clock of playback
+    qint64                  m_clockPos;         ///< log time at m_clock start
+
+    QPointer<QADI>              m_adi;
+    QPointer<QCompass>          m_compass;
+    QPointer<QKeyValueListView> m_list;
+};
+
+#endif // end of __QTELEMETRYLOG_H__